@@ -0,0 +1,257 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredEconomyJournal.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "PredItemLibrary.h"
+#include "PredItemService.h"
+#include "PredLoggingLibrary.h"
+
+FPredEconomyJournal::FPredEconomyJournal()
+{
+    for (uint32 i = 0; i < Capacity; i++)
+    {
+        Cells[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+    FlushBuffer.Reserve(Capacity);
+}
+
+FPredEconomyJournal::~FPredEconomyJournal()
+{
+    Close();
+}
+
+bool FPredEconomyJournal::Open(const FString& InFilename)
+{
+    check(!FileHandle.IsValid());
+
+    Filename = InFilename;
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+    FileHandle.Reset(PlatformFile.OpenWrite(*Filename));
+    if (!FileHandle.IsValid())
+    {
+        TRACESTATIC(PredItemLog, Warning, "Could not open economy journal %s, events will not be saved.", *Filename);
+        return false;
+    }
+
+    FPredEconomyJournalHeader Header;
+    Header.StartTicks = FDateTime::UtcNow().GetTicks();
+    FileHandle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+    return true;
+}
+
+void FPredEconomyJournal::Close()
+{
+    // Wait out the background flush, then take the flush over ourselves for whatever is left.
+    bool bExpected = false;
+    while (!bFlushing.compare_exchange_weak(bExpected, true))
+    {
+        bExpected = false;
+        FPlatformProcess::Sleep(0.0f);
+    }
+
+    FlushToFile();
+    FileHandle.Reset();
+    bFlushing.store(false);
+}
+
+bool FPredEconomyJournal::Record(const FPredEconomyEvent& Event)
+{
+    FCell* Cell = nullptr;
+    uint32 Position = EnqueuePosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell = &Cells[Position & Mask];
+        const uint32 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+        const int32 Difference = (int32)(Sequence - Position);
+        if (Difference == 0)
+        {
+            // Free cell, claim it.
+            if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (Difference < 0)
+        {
+            // A lap ahead of the reader, we're full.
+            NumDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            // Another producer took it first.
+            Position = EnqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    Cell->Event = Event;
+    Cell->Sequence.store(Position + 1, std::memory_order_release);
+    return true;
+}
+
+bool FPredEconomyJournal::Dequeue(FPredEconomyEvent& OutEvent)
+{
+    FCell* Cell = nullptr;
+    uint32 Position = DequeuePosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell = &Cells[Position & Mask];
+        const uint32 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+        const int32 Difference = (int32)(Sequence - (Position + 1));
+        if (Difference == 0)
+        {
+            if (DequeuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (Difference < 0)
+        {
+            // Nothing written here yet, we're empty.
+            return false;
+        }
+        else
+        {
+            Position = DequeuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    OutEvent = Cell->Event;
+
+    // Hand the cell back to the producers for their next lap.
+    Cell->Sequence.store(Position + Mask + 1, std::memory_order_release);
+    return true;
+}
+
+void FPredEconomyJournal::FlushAsync()
+{
+    bool bExpected = false;
+    if (!bFlushing.compare_exchange_strong(bExpected, true))
+    {
+        return;
+    }
+
+    // The task keeps us alive until it's done, even if the service lets go of us in the meantime.
+    TSharedRef<FPredEconomyJournal, ESPMode::ThreadSafe> SharedThis = AsShared();
+    Async(EAsyncExecution::ThreadPool, [SharedThis]()
+    {
+        SharedThis->FlushToFile();
+        SharedThis->bFlushing.store(false);
+    });
+}
+
+void FPredEconomyJournal::FlushToFile()
+{
+    FlushBuffer.Reset();
+
+    FPredEconomyEvent Event;
+    while (Dequeue(Event))
+    {
+        FlushBuffer.Add(Event);
+    }
+
+    if (FlushBuffer.Num() > 0 && FileHandle.IsValid())
+    {
+        FileHandle->Write(reinterpret_cast<const uint8*>(FlushBuffer.GetData()), FlushBuffer.Num() * sizeof(FPredEconomyEvent));
+        FileHandle->Flush();
+        NumWrittenEvents.fetch_add(FlushBuffer.Num(), std::memory_order_relaxed);
+    }
+}
+
+bool FPredEconomyJournal::ReadJournalFile(const FString& InFilename, FPredEconomyJournalHeader& OutHeader, TArray<FPredEconomyEvent>& OutEvents)
+{
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *InFilename) || Bytes.Num() < (int32)sizeof(FPredEconomyJournalHeader))
+    {
+        return false;
+    }
+
+    FMemory::Memcpy(&OutHeader, Bytes.GetData(), sizeof(FPredEconomyJournalHeader));
+    if (OutHeader.Magic != FPredEconomyJournalHeader::ExpectedMagic || OutHeader.EventSize != sizeof(FPredEconomyEvent))
+    {
+        return false;
+    }
+
+    // A trailing partial event means the server went down mid-write, drop it.
+    const int32 NumEvents = (Bytes.Num() - sizeof(FPredEconomyJournalHeader)) / sizeof(FPredEconomyEvent);
+    OutEvents.SetNumUninitialized(NumEvents);
+    FMemory::Memcpy(OutEvents.GetData(), Bytes.GetData() + sizeof(FPredEconomyJournalHeader), NumEvents * sizeof(FPredEconomyEvent));
+    return true;
+}
+
+/**
+ * PredItem.ReadJournal <File> [NumEventsToPrint]
+ * Summarizes a journal: events and gold per type, and the most bought items. Item names are resolved if the world has an item service.
+ */
+static void ReadEconomyJournal(const TArray<FString>& Args, UWorld* World)
+{
+    if (Args.Num() < 1)
+    {
+        TRACESTATIC(PredItemLog, Log, "Usage: PredItem.ReadJournal <File> [NumEventsToPrint]");
+        return;
+    }
+
+    FPredEconomyJournalHeader Header;
+    TArray<FPredEconomyEvent> Events;
+    if (!FPredEconomyJournal::ReadJournalFile(Args[0], Header, Events))
+    {
+        TRACESTATIC(PredItemLog, Warning, "%s is not an economy journal.", *Args[0]);
+        return;
+    }
+
+    APredItemService* ItemService = World ? UPredItemLibrary::GetItemService(World) : nullptr;
+    auto GetItemName = [ItemService](int32 ItemIndex) -> FString
+    {
+        if (ItemService && ItemService->GetCatalog().Items.IsValidIndex(ItemIndex))
+        {
+            return GetNameSafe(ItemService->GetCatalog().Items[ItemIndex]);
+        }
+        return FString::Printf(TEXT("#%d"), ItemIndex);
+    };
+
+    const int32 NumEventsToPrint = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0;
+    int32 NumByType[4] = {};
+    double GoldByType[4] = {};
+    TMap<int32, int32> PurchasesByItem;
+
+    for (int32 i = 0; i < Events.Num(); i++)
+    {
+        const FPredEconomyEvent& Event = Events[i];
+        const int32 TypeIdx = FMath::Clamp((int32)Event.Type, 0, 3);
+        NumByType[TypeIdx]++;
+        GoldByType[TypeIdx] += Event.GoldDelta;
+        if (Event.Type == EPredEconomyEventType::Buy)
+        {
+            PurchasesByItem.FindOrAdd(Event.ItemIndex) += Event.Count;
+        }
+
+        if (i < NumEventsToPrint)
+        {
+            TRACESTATIC(PredItemLog, Log, "%10.3fs owner %u type %d item %s x%d gold %+.1f", Event.TimeMs / 1000.0f, Event.OwnerID, TypeIdx, *GetItemName(Event.ItemIndex), Event.Count, Event.GoldDelta);
+        }
+    }
+
+    TRACESTATIC(PredItemLog, Log, "%s: %d events, started %s UTC.", *Args[0], Events.Num(), *FDateTime(Header.StartTicks).ToString());
+    TRACESTATIC(PredItemLog, Log, "Buys %d (%.0f gold), sells %d (%.0f gold), consumed %d, gold changes %d (%.0f gold).",
+        NumByType[0], GoldByType[0], NumByType[1], GoldByType[1], NumByType[2], NumByType[3], GoldByType[3]);
+
+    PurchasesByItem.ValueSort(TGreater<int32>());
+    int32 NumListed = 0;
+    for (const TPair<int32, int32>& Purchases : PurchasesByItem)
+    {
+        if (NumListed++ >= 10) { break; }
+        TRACESTATIC(PredItemLog, Log, "  %s bought %d times", *GetItemName(Purchases.Key), Purchases.Value);
+    }
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ReadEconomyJournalCommand(
+    TEXT("PredItem.ReadJournal"),
+    TEXT("Summarizes an economy journal. Usage: PredItem.ReadJournal <File> [NumEventsToPrint]"),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReadEconomyJournal));
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+
+#include <atomic>
+
+class IFileHandle;
+
+/**
+ * What an FPredEconomyEvent records. Stored on disk, only ever append new values.
+ */
+enum class EPredEconomyEventType : uint8
+{
+    /** An item was bought. GoldDelta is minus what it cost. */
+    Buy,
+    /** An item was sold. GoldDelta is what it sold for. */
+    Sell,
+    /** A required item was used up by a purchase. No longer written, the purchase's Buy event covers its parts. Kept so later values don't shift. */
+    Consume,
+    /** Any change to an owner's gold, whatever caused it */
+    GoldDelta,
+};
+
+/**
+ * A single economy event, written to disk as is. 16 bytes, little endian.
+ */
+struct FPredEconomyEvent
+{
+    /** World time of the event, in milliseconds */
+    uint32 TimeMs = 0;
+
+    /** Identifies the inventory owner within the match (UObject unique ID of the owner) */
+    uint32 OwnerID = 0;
+
+    float GoldDelta = 0.0f;
+
+    /** UPredItem::ItemIndex of the item involved, INDEX_NONE for gold changes */
+    int16 ItemIndex = INDEX_NONE;
+
+    EPredEconomyEventType Type = EPredEconomyEventType::GoldDelta;
+
+    uint8 Count = 0;
+};
+static_assert(sizeof(FPredEconomyEvent) == 16, "FPredEconomyEvent is written to disk as is, keep it packed");
+
+/**
+ * Header at the start of every journal file. The rest of the file is FPredEconomyEvents, back to back.
+ */
+struct FPredEconomyJournalHeader
+{
+    static constexpr uint32 ExpectedMagic = 0x314A4550; // "PEJ1"
+    static constexpr uint32 CurrentVersion = 1;
+
+    uint32 Magic = ExpectedMagic;
+    uint32 Version = CurrentVersion;
+    uint32 EventSize = sizeof(FPredEconomyEvent);
+    uint32 Reserved = 0;
+
+    /** FDateTime ticks (UTC) of when the journal was opened */
+    int64 StartTicks = 0;
+};
+static_assert(sizeof(FPredEconomyJournalHeader) == 24, "FPredEconomyJournalHeader is written to disk as is, keep it packed");
+
+/**
+ * Records economy events into a fixed-size lock-free ring buffer, and flushes them to a binary file from a background task.
+ *
+ * Recording never blocks and never allocates: it is a couple of atomics and a 16 byte copy, safe from any thread.
+ * If the buffer is full, because the flush fell behind, the event is dropped and counted in GetNumDroppedEvents.
+ * Only one flush runs at a time, and the flush is the only thing that touches the file.
+ *
+ * Read journals back with the PredItem.ReadJournal console command (or ReadJournalFile).
+ */
+class PREDECESSOR_API FPredEconomyJournal : public TSharedFromThis<FPredEconomyJournal, ESPMode::ThreadSafe>
+{
+public:
+
+    /** Events the ring buffer holds. Must be a power of two. */
+    static constexpr uint32 Capacity = 8192;
+
+    FPredEconomyJournal();
+    ~FPredEconomyJournal();
+
+    /** Creates @Filename and writes the header. Returns false if the file couldn't be opened, in which case events are still buffered but never written. */
+    bool Open(const FString& Filename);
+
+    /** Waits for any flush in progress, writes everything left in the buffer and closes the file. */
+    void Close();
+
+    /** Queues @Event. Returns false if the buffer was full and it was dropped. */
+    bool Record(const FPredEconomyEvent& Event);
+
+    /** Starts a background flush, unless one is already running */
+    void FlushAsync();
+
+    /** True once the buffer is at least half full, meaning a flush should be started without waiting for the next scheduled one */
+    bool ShouldFlush() const { return (EnqueuePosition.load(std::memory_order_relaxed) - DequeuePosition.load(std::memory_order_relaxed)) >= Capacity / 2; }
+
+    uint64 GetNumDroppedEvents() const { return NumDroppedEvents.load(std::memory_order_relaxed); }
+    uint64 GetNumWrittenEvents() const { return NumWrittenEvents.load(std::memory_order_relaxed); }
+
+    const FString& GetFilename() const { return Filename; }
+
+    /** Reads the journal file @InFilename back. Returns false if it doesn't exist or isn't a journal. */
+    static bool ReadJournalFile(const FString& InFilename, FPredEconomyJournalHeader& OutHeader, TArray<FPredEconomyEvent>& OutEvents);
+
+private:
+
+    /** Takes the oldest event out of the buffer. Returns false if it is empty. */
+    bool Dequeue(FPredEconomyEvent& OutEvent);
+
+    /** Drains the buffer to the file. Only ever ran by whoever set bFlushing. */
+    void FlushToFile();
+
+    /**
+     * Bounded MPMC queue cell. Sequence says whose turn it is: equal to the enqueue position when free for a producer,
+     * one past it once written and waiting for a consumer.
+     */
+    struct FCell
+    {
+        std::atomic<uint32> Sequence;
+        FPredEconomyEvent Event;
+    };
+
+    static constexpr uint32 Mask = Capacity - 1;
+    static_assert((Capacity & Mask) == 0, "Capacity must be a power of two");
+
+    FCell Cells[Capacity];
+
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> EnqueuePosition{ 0 };
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> DequeuePosition{ 0 };
+
+    std::atomic<bool> bFlushing{ false };
+    std::atomic<uint64> NumDroppedEvents{ 0 };
+    std::atomic<uint64> NumWrittenEvents{ 0 };
+
+    /** Only touched by the flush, or on the game thread while no flush can be running (Open, Close) */
+    TUniquePtr<IFileHandle> FileHandle;
+    TArray<FPredEconomyEvent> FlushBuffer;
+
+    FString Filename;
+};
@@ -8,30 +8,66 @@
 
 #include "PredAbilityLibrary.h"
 #include "BaseAttributeSet.h"
+#include "BaseGameplayAbility.h"
 #include "PredItemLibrary.h"
+#include "PredItemLoadout.h"
 #include "PredCharacter.h"
 #include "PredLoggingLibrary.h"
 #include "PredGameplayTagLibrary.h"
 #include "PredBlueprintFunctionLibrary.h"
 #include "Kismet/GameplayStatics.h"
 #include "PredAbilitySystemGlobals.h"
-
+#include "PredItemService.h"
+#include "PredItemStats.h"
+#include "PredEconomyJournal.h"
+#include "PredInventoryRecorder.h"
+#include "PredInventorySnapshot.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "TimerManager.h"
+#include "Algo/AnyOf.h"
+#include "Algo/BinarySearch.h"
+
+DECLARE_MEMORY_STAT(TEXT("Inventory Memory"), STAT_PredInventoryMemory, STATGROUP_PredItem);
 
 // Sets default values for this component's properties
 UPredInventoryComponent::UPredInventoryComponent()
 {
     // Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
     // off to improve performance if you don't need them.
-    PrimaryComponentTick.bCanEverTick = false;
+    // Only ticks while a slot key press is buffered.
+    PrimaryComponentTick.bCanEverTick = true;
+    PrimaryComponentTick.bStartWithTickEnabled = false;
     SetIsReplicatedByDefault(true);
     // ...
 }
 
+void UPredInventoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    // Retry the buffered key press every frame until it goes through or runs out.
+    if (BufferedInputSlot != INDEX_NONE && GetWorld()->GetTimeSeconds() <= BufferedInputExpireTime && !TryActivateInventorySlot(BufferedInputSlot))
+    {
+        return;
+    }
+
+    BufferedInputSlot = INDEX_NONE;
+    SetComponentTickEnabled(false);
+}
+
 // Called when the game starts
 void UPredInventoryComponent::BeginPlay()
 {
     Super::BeginPlay();
 
+    // Stat-only inventories have no gold, no input and no slots, and there is nothing for clients to see.
+    if (IsStatOnly())
+    {
+        SetIsReplicated(false);
+        return;
+    }
+
     // @TODO move this elsewhere, initial gold
     UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
     UGameplayEffect* ItemStaticModifierGE = NewObject<UGameplayEffect>();
@@ -43,6 +79,8 @@ void UPredInventoryComponent::BeginPlay()
     ItemStaticModifierGE->Modifiers.Add(GameplayModInfo);
     OwnerASC->ApplyGameplayEffectToSelf(ItemStaticModifierGE, 1.0f, OwnerASC->MakeEffectContext());
 
+    StartTrackingGold();
+
     APredCharacter* OwnerAsPredCharacter = Cast<APredCharacter>(GetOwner());
     if (OwnerAsPredCharacter)
     {
@@ -51,6 +89,309 @@ void UPredInventoryComponent::BeginPlay()
 
 
     SetupInventorySlots();
+
+    if (GetOwner()->HasAuthority())
+    {
+        RecordInventoryOp(EPredInventoryOpType::Begin, nullptr, INDEX_NONE, NumInventorySlots, true, SellModifier);
+
+        // A freshly spawned pawn is only possessed after it begins play, so whoever we belong to is only known next tick.
+        APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+        if (ItemService && ItemService->HasSavedInventorySnapshots())
+        {
+            GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]() { RestoreSavedInventory(); }));
+        }
+    }
+}
+
+void UPredInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (EndPlayReason == EEndPlayReason::Destroyed)
+    {
+        SaveInventoryIfDisconnecting();
+    }
+
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    if (OwnerASC && GoldChangedDelegateHandle.IsValid())
+    {
+        OwnerASC->GetGameplayAttributeValueChangeDelegate(UBaseAttributeSet::GetGoldAttribute()).Remove(GoldChangedDelegateHandle);
+    }
+    GoldChangedDelegateHandle.Reset();
+
+    APredItemService* ItemService = bTrackingGold ? UPredItemLibrary::GetItemService(this) : nullptr;
+    if (ItemService)
+    {
+        ItemService->OnItemsLoaded.RemoveDynamic(this, &UPredInventoryComponent::OnCatalogLoaded);
+        ItemService->UnregisterInventory(this);
+    }
+    bTrackingGold = false;
+
+    DEC_MEMORY_STAT_BY(STAT_PredInventoryMemory, ReportedMemoryBytes);
+    ReportedMemoryBytes = 0;
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void UPredInventoryComponent::StartTrackingGold()
+{
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    if (!OwnerASC) { return; }
+
+    CachedGold = OwnerASC->GetNumericAttribute(UBaseAttributeSet::GetGoldAttribute());
+    GoldChangedDelegateHandle = OwnerASC->GetGameplayAttributeValueChangeDelegate(UBaseAttributeSet::GetGoldAttribute()).AddUObject(this, &UPredInventoryComponent::OnGoldChanged);
+    bTrackingGold = true;
+
+    // Prices depend on the catalog as well as on us, rebuild once it's (re)loaded.
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (ItemService)
+    {
+        ItemService->OnItemsLoaded.AddDynamic(this, &UPredInventoryComponent::OnCatalogLoaded);
+        if (GetOwner()->HasAuthority())
+        {
+            ItemService->RegisterInventory(this);
+        }
+    }
+
+    MarkPersonalizedPricesDirty();
+}
+
+void UPredInventoryComponent::OnCatalogLoaded()
+{
+    MarkPersonalizedPricesDirty();
+
+    // A summary that came in ahead of the catalog couldn't be mirrored yet.
+    if (!GetOwner()->HasAuthority() && PublicSummary.NumSlots() > 0)
+    {
+        ApplyPublicSummary();
+    }
+}
+
+void UPredInventoryComponent::OnGoldChanged(const FOnAttributeChangeData& ChangeData)
+{
+    const float OldGold = CachedGold;
+    CachedGold = ChangeData.NewValue;
+
+    if (GetOwner()->HasAuthority())
+    {
+        RecordEconomyEvent(EPredEconomyEventType::GoldDelta, nullptr, 0, ChangeData.NewValue - ChangeData.OldValue);
+        MarkTimelineDirty();
+
+        // Gold a recorded op spends or earns is part of that op, the replay only needs to be told about the rest.
+        if (InventoryOpDepth == 0)
+        {
+            RecordInventoryOp(EPredInventoryOpType::GoldDelta, nullptr, INDEX_NONE, 0, true, ChangeData.NewValue - ChangeData.OldValue);
+        }
+    }
+
+    // Prices are stale, the rebuild compares against the new gold anyway.
+    if (bPersonalizedPricesDirty)
+    {
+        RefreshPersonalizedPrices();
+        return;
+    }
+
+    // Only the items priced between the old and new gold can have flipped.
+    // An item is affordable while its price is <= our gold, so everything past the upper bound of a gold value is out of reach.
+    const int32 OldBound = Algo::UpperBoundBy(PersonalizedPrices.SortedPrices, OldGold, &FPredPersonalizedItemPrice::Price);
+    const int32 NewBound = Algo::UpperBoundBy(PersonalizedPrices.SortedPrices, CachedGold, &FPredPersonalizedItemPrice::Price);
+    if (NewBound > OldBound)
+    {
+        BroadcastAffordabilityRange(OldBound, NewBound, true);
+    }
+    else if (NewBound < OldBound)
+    {
+        BroadcastAffordabilityRange(NewBound, OldBound, false);
+    }
+}
+
+void UPredInventoryComponent::MarkPersonalizedPricesDirty()
+{
+    bPersonalizedPricesDirty = true;
+
+    if (!bTrackingGold || bPersonalizedPriceRefreshPending) { return; }
+    bPersonalizedPriceRefreshPending = true;
+
+    // The server reprices every inventory that changed this frame in one parallel batch.
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (ItemService && GetOwner()->HasAuthority())
+    {
+        ItemService->RequestAffordabilityRefresh(this);
+        return;
+    }
+
+    UWorld* World = GetWorld();
+    if (World)
+    {
+        World->GetTimerManager().SetTimerForNextTick(this, &UPredInventoryComponent::RefreshPersonalizedPrices);
+    }
+}
+
+void UPredInventoryComponent::RefreshPersonalizedPrices()
+{
+    bPersonalizedPriceRefreshPending = false;
+    if (!bPersonalizedPricesDirty || !bTrackingGold) { return; }
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (!ItemService) { return; }
+
+    FPredPersonalizedPrices NewPrices;
+    NewPrices.Build(ItemService->GetCatalog(), GetOwnedItemCounts(), CachedGold, ItemService->GetStats());
+    ApplyPersonalizedPrices(MoveTemp(NewPrices));
+}
+
+void UPredInventoryComponent::ApplyPersonalizedPrices(FPredPersonalizedPrices&& NewPrices)
+{
+    bPersonalizedPricesDirty = false;
+    bPersonalizedPriceRefreshPending = false;
+
+    // The prices may have been built against older gold, settle affordability against what we have now.
+    for (const FPredPersonalizedItemPrice& PersonalizedPrice : NewPrices.SortedPrices)
+    {
+        NewPrices.AffordableItemBits[PersonalizedPrice.Item->ItemIndex] = PersonalizedPrice.Price <= CachedGold;
+    }
+
+    // Work out which items flipped against what we last broadcast.
+    TArray<UPredItem*> NowAffordable;
+    TArray<UPredItem*> NoLongerAffordable;
+    for (const FPredPersonalizedItemPrice& PersonalizedPrice : NewPrices.SortedPrices)
+    {
+        const int32 ItemIndex = PersonalizedPrice.Item->ItemIndex;
+        const bool bAffordable = NewPrices.AffordableItemBits[ItemIndex];
+        const bool bWasAffordable = PersonalizedPrices.AffordableItemBits.IsValidIndex(ItemIndex) && PersonalizedPrices.AffordableItemBits[ItemIndex];
+
+        if (bAffordable != bWasAffordable)
+        {
+            (bAffordable ? NowAffordable : NoLongerAffordable).Add(PersonalizedPrice.Item);
+        }
+    }
+    PersonalizedPrices = MoveTemp(NewPrices);
+
+    if (NowAffordable.Num() > 0)
+    {
+        OnItemAffordabilityChanged.Broadcast(NowAffordable, true);
+    }
+    if (NoLongerAffordable.Num() > 0)
+    {
+        OnItemAffordabilityChanged.Broadcast(NoLongerAffordable, false);
+    }
+}
+
+void UPredInventoryComponent::BroadcastAffordabilityRange(int32 StartIdx, int32 EndIdx, bool bAffordable)
+{
+    TArray<UPredItem*> FlippedItems;
+    FlippedItems.Reserve(EndIdx - StartIdx);
+    for (int32 i = StartIdx; i < EndIdx; i++)
+    {
+        UPredItem* Item = PersonalizedPrices.SortedPrices[i].Item;
+        PersonalizedPrices.AffordableItemBits[Item->ItemIndex] = bAffordable;
+        FlippedItems.Add(Item);
+    }
+
+    OnItemAffordabilityChanged.Broadcast(FlippedItems, bAffordable);
+}
+
+bool UPredInventoryComponent::BuildStatPreview(FPredStatPreview& OutPreview) const
+{
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (!OwnerASC || !ItemService || ItemService->GetCatalog().Num() == 0) { return false; }
+
+    const FPredItemCatalog& Catalog = ItemService->GetCatalog();
+    check(OutPreview.NumAttributes() == Catalog.ModifiedAttributes.Num());
+
+    OutPreview.Slots.Reset();
+    const TArrayView<const uint16> OwnedItemCounts = GetOwnedItemCounts();
+    OutPreview.OwnedItemCounts.Reset(OwnedItemCounts.Num());
+    OutPreview.OwnedItemCounts.Append(OwnedItemCounts.GetData(), OwnedItemCounts.Num());
+
+    // Unique providers are only tracked where the effects are applied. Elsewhere, hand them out in slot order like the server would have.
+    const bool bTracksUniqueProviders = GetOwner()->HasAuthority();
+    FPredUniqueIdentifierMask ClaimedIdentifiers;
+
+    for (const FPredInventorySlot& InventorySlot : Inventory)
+    {
+        FPredStatPreviewSlot& PreviewSlot = OutPreview.Slots.AddDefaulted_GetRef();
+        const FPredActiveItem& SlottedItem = InventorySlot.SlottedItem;
+        if (InventorySlot.IsEmpty() || SlottedItem.Item->ItemIndex == INDEX_NONE) { continue; }
+
+        PreviewSlot.ItemIndex = SlottedItem.Item->ItemIndex;
+        PreviewSlot.StackCount = SlottedItem.GetStackCount();
+
+        if (bTracksUniqueProviders)
+        {
+            PreviewSlot.ProvidedUniqueIdentifiers = EconomyInventory.GetProvidedUniqueIdentifiers(SlottedItem.UniqueItemID, SlottedItem.Item->UniqueIdentifierMask);
+        }
+        else
+        {
+            PreviewSlot.ProvidedUniqueIdentifiers = SlottedItem.Item->UniqueIdentifierMask.Without(ClaimedIdentifiers);
+            ClaimedIdentifiers.Append(PreviewSlot.ProvidedUniqueIdentifiers);
+        }
+    }
+
+    TArray<float, TInlineAllocator<32>> CurrentBaseValues;
+    CurrentBaseValues.SetNumUninitialized(Catalog.ModifiedAttributes.Num());
+    for (int32 AttributeSlot = 0; AttributeSlot < Catalog.ModifiedAttributes.Num(); AttributeSlot++)
+    {
+        CurrentBaseValues[AttributeSlot] = OwnerASC->GetNumericAttributeBase(Catalog.ModifiedAttributes[AttributeSlot]);
+    }
+    OutPreview.SetCurrentBaseValues(CurrentBaseValues);
+
+    return true;
+}
+
+float UPredInventoryComponent::PreviewAttributeAfterPurchase(UPredItem* Item, FGameplayAttribute Attribute) const
+{
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (!OwnerASC) { return 0.0f; }
+
+    const int32 AttributeSlot = ItemService ? ItemService->GetCatalog().GetAttributeSlot(Attribute) : INDEX_NONE;
+    if (!Item || Item->ItemIndex == INDEX_NONE || AttributeSlot == INDEX_NONE)
+    {
+        return OwnerASC->GetNumericAttribute(Attribute);
+    }
+
+    FPredStatPreview Preview(ItemService->GetCatalog(), ItemService->GetStats());
+    if (!BuildStatPreview(Preview))
+    {
+        return OwnerASC->GetNumericAttribute(Attribute);
+    }
+
+    TArray<float, TInlineAllocator<32>> PreviewValues;
+    PreviewValues.SetNumUninitialized(Preview.NumAttributes());
+    Preview.EvaluatePurchase(Item->ItemIndex, PreviewValues);
+
+    return PreviewValues[AttributeSlot];
+}
+
+float UPredInventoryComponent::GetPersonalizedItemCost(const UPredItem* Item)
+{
+    if (bPersonalizedPricesDirty)
+    {
+        RefreshPersonalizedPrices();
+    }
+
+    if (Item && bTrackingGold && !bPersonalizedPricesDirty && PersonalizedPrices.PriceByIndex.IsValidIndex(Item->ItemIndex))
+    {
+        return PersonalizedPrices.PriceByIndex[Item->ItemIndex];
+    }
+
+    return Item ? const_cast<UPredItem*>(Item)->GetItemCostFor(this) : 0.0f;
+}
+
+bool UPredInventoryComponent::GetCachedAffordability(const UPredItem* Item, bool& bOutAffordable)
+{
+    if (bPersonalizedPricesDirty)
+    {
+        RefreshPersonalizedPrices();
+    }
+
+    if (!Item || !bTrackingGold || bPersonalizedPricesDirty || !PersonalizedPrices.AffordableItemBits.IsValidIndex(Item->ItemIndex))
+    {
+        return false;
+    }
+
+    bOutAffordable = PersonalizedPrices.AffordableItemBits[Item->ItemIndex];
+    return true;
 }
 
 void UPredInventoryComponent::SetupInventorySlots()
@@ -63,7 +404,52 @@ void UPredInventoryComponent::SetupInventorySlots()
             NewSlot.SlotID = i;
             Inventory.Add(NewSlot);
         }
+        RebuildItemOwnership();
+        UpdateMemoryStats();
+    }
+}
+
+void UPredInventoryComponent::RebuildItemOwnership()
+{
+    // Unique identifiers are left alone, they follow the effects applied rather than the slots.
+    EconomyInventory.ResetSlots(Inventory.Num(), 0);
+
+    for (int32 i = 0; i < Inventory.Num(); i++)
+    {
+        if (!Inventory[i].IsEmpty())
+        {
+            SyncEconomySlot(i);
+        }
     }
+
+    MarkPublicSummaryDirty();
+    MarkTimelineDirty();
+}
+
+void UPredInventoryComponent::TrackItemOwnership(const UPredItem* Item, int32 Delta)
+{
+    // Items which haven't gone through the item service have no index, GetItemCount falls back to scanning for those.
+    const int32 ItemIndex = Item ? Item->ItemIndex : INDEX_NONE;
+    if (ItemIndex == INDEX_NONE) { return; }
+
+    EconomyInventory.AdjustOwnedCount(ItemIndex, Delta);
+
+    // What we own decides what everything else costs us.
+    MarkPersonalizedPricesDirty();
+}
+
+void UPredInventoryComponent::SyncEconomySlot(int32 Slot)
+{
+    const FPredActiveItem& SlottedItem = Inventory[Slot].SlottedItem;
+
+    // Unindexed items are left out of the economy, same as they are left out of the counts.
+    const int32 ItemIndex = SlottedItem.Item ? SlottedItem.Item->ItemIndex : INDEX_NONE;
+    EconomyInventory.SetSlot(Slot, ItemIndex, SlottedItem.GetStackCount(), SlottedItem.UniqueItemID);
+
+    // What we own decides what everything else costs us.
+    MarkPersonalizedPricesDirty();
+    MarkPublicSummaryDirty();
+    MarkTimelineDirty();
 }
 
 void UPredInventoryComponent::SetupInventoryInput(UInputComponent* InputComponent)
@@ -76,11 +462,63 @@ void UPredInventoryComponent::SetupInventoryInput(UInputComponent* InputComponen
     InputComponent->BindAction<FUseInventorySlot>("UseInventorySlotSix", IE_Pressed, this, &UPredInventoryComponent::TryUseInventorySlot, 5);
 }
 
+void UPredInventoryComponent::ApplyLoadout(UPredItemLoadout* Loadout)
+{
+    if (!GetOwner()->HasAuthority()) { return; }
+
+    if (!IsStatOnly()) { TRACE(PredItemLog, Error, "Tried to apply loadout %s to %s, but loadouts are only for stat-only inventories.", *GetNameSafe(Loadout), *GetNameSafe(GetOwner())); return; }
+
+    ClearLoadout();
+
+    if (!Loadout) { return; }
+
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    if (!OwnerASC) { TRACE(PredItemLog, Error, "Tried to apply loadout %s to %s, but could not find AbilitySystemComponent", *GetNameSafe(Loadout), *GetNameSafe(GetOwner())); return; }
+
+    LoadoutEffectHandle = OwnerASC->ApplyGameplayEffectToSelf(Loadout->GetAggregatedStatEffect(), 1.0f, OwnerASC->MakeEffectContext());
+
+    // Same multiplicative effect as items equipped one by one, so a loadout's multipliers stack the same way theirs do.
+    FGameplayEffectSpecHandle MultiplicativeEffectSpec = Loadout->MakeMultiplicativeEffectSpec(OwnerASC->MakeEffectContext());
+    if (MultiplicativeEffectSpec.IsValid())
+    {
+        LoadoutMultiplicativeEffectHandle = OwnerASC->BP_ApplyGameplayEffectSpecToSelf(MultiplicativeEffectSpec);
+    }
+    ActiveLoadout = Loadout;
+
+    // Still answer HasItem/GetItemCount for the loadout's items.
+    for (const UPredItem* Item : Loadout->Items)
+    {
+        TrackItemOwnership(Item, 1);
+    }
+}
+
+void UPredInventoryComponent::ClearLoadout()
+{
+    if (!GetOwner()->HasAuthority() || !ActiveLoadout) { return; }
+
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    if (OwnerASC)
+    {
+        OwnerASC->RemoveActiveGameplayEffect(LoadoutEffectHandle);
+        OwnerASC->RemoveActiveGameplayEffect(LoadoutMultiplicativeEffectHandle);
+    }
+
+    for (const UPredItem* Item : ActiveLoadout->Items)
+    {
+        TrackItemOwnership(Item, -1);
+    }
+
+    LoadoutEffectHandle = FActiveGameplayEffectHandle();
+    LoadoutMultiplicativeEffectHandle = FActiveGameplayEffectHandle();
+    ActiveLoadout = nullptr;
+}
+
 void UPredInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
     Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-    DOREPLIFETIME(UPredInventoryComponent, Inventory);
+    DOREPLIFETIME_CONDITION(UPredInventoryComponent, Inventory, COND_OwnerOnly);
+    DOREPLIFETIME_CONDITION(UPredInventoryComponent, PublicSummary, COND_SkipOwner);
 
 }
 
@@ -104,6 +542,13 @@ bool UPredInventoryComponent::HasRoomForItem(const UPredItem* Item)
         return false;
     }
 
+    // Indexed items are answered by the economy, from the counts and slots we keep in step with the inventory.
+    APredItemService* ItemService = Item->ItemIndex != INDEX_NONE ? UPredItemLibrary::GetItemService(this) : nullptr;
+    if (ItemService && ItemService->GetCatalog().Economy.IsValidItem(Item->ItemIndex))
+    {
+        return ItemService->GetCatalog().Economy.HasRoomForItem(EconomyInventory, Item->ItemIndex);
+    }
+
     // If we have a child item, we can replace it when we are purchased.
     // Also checking recursively against our children's children. All we need is one descendant to exist, as we can take
     // that spot after buying (we will be removing at least one instance of any given child).
@@ -115,8 +560,33 @@ bool UPredInventoryComponent::HasRoomForItem(const UPredItem* Item)
         }
     }
 
-    int32 ThrowAwayEmptySlotIdx = -1;
-    return FindEmptySlot(ThrowAwayEmptySlotIdx);
+    // A stack of this item with room left can take us as well.
+    int32 ThrowAwaySlotIdx = -1;
+    if (FindStackWithRoom(Item, ThrowAwaySlotIdx))
+    {
+        return true;
+    }
+
+    return FindEmptySlot(ThrowAwaySlotIdx);
+}
+
+bool UPredInventoryComponent::FindStackWithRoom(const UPredItem* Item, int32& OutSlot) const
+{
+    if (!Item || !Item->IsStackable())
+    {
+        return false;
+    }
+
+    for (int32 i = 0; i < Inventory.Num(); i++)
+    {
+        const FPredActiveItem& SlottedItem = Inventory[i].SlottedItem;
+        if (SlottedItem.Item == Item && SlottedItem.GetStackCount() < Item->MaxStackSize)
+        {
+            OutSlot = i;
+            return true;
+        }
+    }
+    return false;
 }
 
 bool UPredInventoryComponent::FindEmptySlot(int32& OutEmptySlot)
@@ -159,10 +629,32 @@ void UPredInventoryComponent::EquipItem(UPredItem* Item, int32 Count)
 {
     if (!GetOwner()->HasAuthority()) { return; }
 
+    if (!Item) { TRACE(PredItemLog, Error, "Item was NULL when attempting to equip"); return; }
+
+    const bool bRecordOp = InventoryOpDepth == 0;
+    TGuardValue<int32> OpDepthGuard(InventoryOpDepth, InventoryOpDepth + 1);
+
+    int32 RemainingCount = FMath::Max(Count, 1);
     int32 SlotToPlaceAt = -1;
-    if (FindEmptySlot(SlotToPlaceAt))
+
+    // Top up the stacks we already have before taking up new slots.
+    while (RemainingCount > 0 && FindStackWithRoom(Item, SlotToPlaceAt))
+    {
+        const int32 CountToAdd = FMath::Min(RemainingCount, Item->MaxStackSize - Inventory[SlotToPlaceAt].SlottedItem.GetStackCount());
+        EquipItemAtSlot(Item, CountToAdd, SlotToPlaceAt);
+        RemainingCount -= CountToAdd;
+    }
+
+    while (RemainingCount > 0 && FindEmptySlot(SlotToPlaceAt))
     {
-        EquipItemAtSlot(Item, Count, SlotToPlaceAt);
+        const int32 CountToAdd = FMath::Min(RemainingCount, Item->MaxStackSize);
+        EquipItemAtSlot(Item, CountToAdd, SlotToPlaceAt);
+        RemainingCount -= CountToAdd;
+    }
+
+    if (bRecordOp)
+    {
+        RecordInventoryOp(EPredInventoryOpType::Equip, Item, INDEX_NONE, Count, RemainingCount == 0, 0.0f);
     }
 }
 
@@ -170,11 +662,24 @@ void UPredInventoryComponent::RemoveItem(const UPredItem* Item, int32 Count)
 {
     if (!GetOwner()->HasAuthority()) { return; }
 
+    const bool bRecordOp = InventoryOpDepth == 0;
+    TGuardValue<int32> OpDepthGuard(InventoryOpDepth, InventoryOpDepth + 1);
+
+    int32 RemainingCount = FMath::Max(Count, 1);
     FPredInventorySlot Slot;
     int32 ItemSlot = FindSlotFromItem(Item, Slot);
-    if (ItemSlot != -1)
+    while (RemainingCount > 0 && ItemSlot != -1)
+    {
+        const int32 CountToRemove = FMath::Min(RemainingCount, Inventory[ItemSlot].SlottedItem.GetStackCount());
+        RemoveItemAtSlot(CountToRemove, ItemSlot);
+        RemainingCount -= CountToRemove;
+
+        ItemSlot = FindSlotFromItem(Item, Slot);
+    }
+
+    if (bRecordOp)
     {
-        RemoveItemAtSlot(1, ItemSlot);
+        RecordInventoryOp(EPredInventoryOpType::Remove, Item, INDEX_NONE, Count, RemainingCount == 0, 0.0f);
     }
 }
 
@@ -184,12 +689,38 @@ void UPredInventoryComponent::EquipItemAtSlot(UPredItem* Item, int32 Count, int3
 
     if (!Item) { TRACE(PredItemLog, Error, "Item was NULL when attempting to equip at slot %d", Slot); return; }
 
+    // Adding to an existing stack, the stack's effects are re-applied once at the new count.
+    FPredActiveItem& SlottedItem = Inventory[Slot].SlottedItem;
+    if (SlottedItem.Item == Item && Item->IsStackable())
+    {
+        const int32 OldStackCount = SlottedItem.GetStackCount();
+        const int32 NewStackCount = FMath::Min(OldStackCount + FMath::Max(Count, 1), Item->MaxStackSize);
+        SetStackCountAtSlot(Slot, NewStackCount);
+        SyncEconomySlot(Slot);
+        OnItemSlotUpdated.Broadcast(Inventory[Slot]);
+
+        TRACE(PredItemLog, Log, "Item %s stacked to %d on %s", *GetNameSafe(Item), NewStackCount, *GetNameSafe(GetOwner()));
+        return;
+    }
+
     FPredActiveItem NewItem;
     NewItem.Item = Item;
+    NewItem.UniqueItemID = ++LastUniqueItemID;
+    NewItem.StackCount = (uint8)FMath::Clamp(Count, 1, Item->MaxStackSize);
+
+    // Equipping over an occupied slot replaces whatever was there, its ability goes first so ours can be granted in its place.
+    if (!Inventory[Slot].IsEmpty())
+    {
+        RevokeItemAbility(Inventory[Slot].SlottedItem);
+    }
 
     ApplyItemEffectsToOwner(NewItem);
-   
-    Inventory[Slot].SlottedItem = NewItem;
+    GrantItemAbility(NewItem);
+
+    // Syncing the slot takes whatever it replaced out of the ownership counts.
+    Inventory[Slot].SlottedItem = MoveTemp(NewItem);
+    SyncEconomySlot(Slot);
+    UpdateMemoryStats();
     OnItemSlotUpdated.Broadcast(Inventory[Slot]);
 
     TRACE(PredItemLog, Log, "Item %s added to %s", *GetNameSafe(Item), *GetNameSafe(GetOwner()));
@@ -199,104 +730,215 @@ void UPredInventoryComponent::RemoveItemAtSlot(int32 Count, int32 Slot)
 {
     if (!GetOwner()->HasAuthority()) { return; }
 
-    FPredActiveItem ActiveItem = Inventory[Slot].SlottedItem;
+    if (TakeItemsFromSlot(Count, Slot))
+    {
+        RegenerateInventoryEffectsPostItemRemoval();
+    }
+}
+
+bool UPredInventoryComponent::TakeItemsFromSlot(int32 Count, int32 Slot)
+{
+    // Only part of the stack is going, the rest stays in the slot with its effects re-applied at the new count.
+    const int32 OldStackCount = Inventory[Slot].SlottedItem.GetStackCount();
+    if (Count > 0 && Count < OldStackCount)
+    {
+        SetStackCountAtSlot(Slot, OldStackCount - Count);
+        SyncEconomySlot(Slot);
+        OnItemSlotUpdated.Broadcast(Inventory[Slot]);
+
+        TRACE(PredItemLog, Log, "Item %s unstacked to %d on %s", *GetNameSafe(Inventory[Slot].SlottedItem.Item), OldStackCount - Count, *GetNameSafe(GetOwner()));
+        return false;
+    }
+
+    // The slot is being emptied, take its state rather than copying it.
+    FPredActiveItem ActiveItem = MoveTemp(Inventory[Slot].SlottedItem);
     const UPredItem* Item = ActiveItem.Item;
 
     RemoveItemEffectsFromOwner(ActiveItem);
 
-    FPredActiveItem EmptyItem;
-    Inventory[Slot].SlottedItem = EmptyItem;
+    Inventory[Slot].SlottedItem = FPredActiveItem();
+    RevokeItemAbility(ActiveItem);
+    SyncEconomySlot(Slot);
+    UpdateMemoryStats();
     OnItemSlotUpdated.Broadcast(Inventory[Slot]);
 
-    RegenerateInventoryEffectsPostItemRemoval();
-
     TRACE(PredItemLog, Log, "Item %s removed from %s", *GetNameSafe(Item), *GetNameSafe(GetOwner()));
+    return true;
 }
 
 void UPredInventoryComponent::ApplyItemEffectsToOwner(FPredActiveItem& ItemToApply)
 {
+    PRED_ITEM_SCOPE(ApplyEffects, FPredItemStats::Get(this));
+
     UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
     if (!OwnerASC) { return; }
 
     const UPredItem* Item = ItemToApply.Item;
-    
-    FGameplayEffectSpecHandle MultiplicativeEffectSpec = UPredAbilityLibrary::MakeOutgoingMultiplicativeEffectSpec(OwnerASC->MakeEffectContext());
+    const int32 StackCount = ItemToApply.GetStackCount();
+
+    // Items are compiled by the item service before anything can be bought, the spec template and tags below depend on it.
+    if (!ensureMsgf(Item->AttributeModifierSetByCallerTags.Num() == Item->AttributeModifiers.Num(), TEXT("Applying %s before the item catalog was compiled"), *Item->GetIdentifierString()))
+    {
+        return;
+    }
+
+    // Starts out with the item's non-unique multipliers already assigned for a single copy.
+    FGameplayEffectSpecHandle MultiplicativeEffectSpec = Item->MakeMultiplicativeEffectSpec(OwnerASC->MakeEffectContext());
     bool bHasMultiplicative = false;
 
     // Apply item's static mods.
-    for (const FPredUniqueItemAttributeModifier& UniqueAttributeModifier : Item->AttributeModifiers)
+    for (int32 ModIdx = 0; ModIdx < Item->AttributeModifiers.Num(); ModIdx++)
     {
-        // We already have this unique effect applied, skip.
-        if (UniqueAttributeModifier.UniqueIdentifier != FGameplayTag::EmptyTag && IsUniqueIdentifierApplied(UniqueAttributeModifier.UniqueIdentifier))
+        const int32 UniqueBit = Item->GetAttributeModifierUniqueBit(ModIdx);
+
+        // Another item already applies this unique effect, skip. It can already be ours when restoring, see RestoreInventorySnapshot.
+        if (UniqueBit != INDEX_NONE && IsUniqueIdentifierApplied(UniqueBit) && !IsProviderOfUniqueEffect(ItemToApply, UniqueBit))
         {
             continue;
         }
 
-        if (UniqueAttributeModifier.UniqueIdentifier != FGameplayTag::EmptyTag)
+        if (UniqueBit != INDEX_NONE)
         {
-            UniqueProviders.Add(UniqueAttributeModifier.UniqueIdentifier, ItemToApply);
+            ClaimUniqueIdentifier(ItemToApply, UniqueBit);
         }
 
-        FPredItemAttributeModifier ItemAttributeModifier = UniqueAttributeModifier.AttributeModifier;
+        // Unique modifiers are applied once no matter how many copies we hold, the rest scale with the stack.
+        const int32 ModifierStackCount = UniqueBit != INDEX_NONE ? 1 : StackCount;
+
+        const FPredItemAttributeModifier& ItemAttributeModifier = Item->AttributeModifiers[ModIdx].AttributeModifier;
         if (ItemAttributeModifier.AttributeModType == EPredItemAttributeModType::Multiply)
         {
             bHasMultiplicative = true;
-            UAbilitySystemBlueprintLibrary::AssignTagSetByCallerMagnitude(MultiplicativeEffectSpec, UPredAbilityLibrary::GetSetByCallerTagForAttribute(ItemAttributeModifier.Attribute), ItemAttributeModifier.GetMagnitude());
+
+            // A single copy of a non-unique multiplier is already in the template.
+            if (MultiplicativeEffectSpec.IsValid() && (UniqueBit != INDEX_NONE || ModifierStackCount > 1))
+            {
+                const float StackedMagnitude = GameplayEffectUtilities::ComputeStackedModifierMagnitude(ItemAttributeModifier.GetMagnitude(), ModifierStackCount, EGameplayModOp::Multiplicitive);
+                MultiplicativeEffectSpec.Data->SetSetByCallerMagnitude(Item->AttributeModifierSetByCallerTags[ModIdx], StackedMagnitude);
+            }
+        }
+        else if (BatchedAdditiveMods)
+        {
+            BatchedAdditiveMods->FindOrAdd(ItemAttributeModifier.Attribute) += ItemAttributeModifier.GetMagnitude() * ModifierStackCount;
         }
         else
         {
-            OwnerASC->ApplyModToAttribute(ItemAttributeModifier.Attribute, EGameplayModOp::Additive, ItemAttributeModifier.GetMagnitude());
+            OwnerASC->ApplyModToAttribute(ItemAttributeModifier.Attribute, EGameplayModOp::Additive, ItemAttributeModifier.GetMagnitude() * ModifierStackCount);
         }
     }
-    if (bHasMultiplicative)
+    if (bHasMultiplicative && MultiplicativeEffectSpec.IsValid())
     {
         FActiveGameplayEffectHandle MultiplicativeStatsHandle = OwnerASC->BP_ApplyGameplayEffectSpecToSelf(MultiplicativeEffectSpec);
         ItemToApply.ActiveEffects.Add(MultiplicativeStatsHandle);
     }
     
     // Item effects
-    for (const FPredUniqueItemEffect& UniqueItemEffect : Item->ItemEffects)
+    for (int32 EffectIdx = 0; EffectIdx < Item->ItemEffects.Num(); EffectIdx++)
     {
-        // We already have this effect identifier applied.
-        if (UniqueItemEffect.UniqueIdentifier != FGameplayTag::EmptyTag && IsUniqueIdentifierApplied(UniqueItemEffect.UniqueIdentifier))
+        const int32 UniqueBit = Item->GetItemEffectUniqueBit(EffectIdx);
+
+        // Another item already applies this effect identifier.
+        if (UniqueBit != INDEX_NONE && IsUniqueIdentifierApplied(UniqueBit) && !IsProviderOfUniqueEffect(ItemToApply, UniqueBit))
         {
             continue;
         }
 
-        if (UniqueItemEffect.UniqueIdentifier != FGameplayTag::EmptyTag)
+        if (UniqueBit != INDEX_NONE)
         {
-            UniqueProviders.Add(UniqueItemEffect.UniqueIdentifier, ItemToApply);
+            ClaimUniqueIdentifier(ItemToApply, UniqueBit);
         }
 
-        FActiveGameplayEffectHandle ItemEffectHandle = OwnerASC->BP_ApplyGameplayEffectToSelf(UniqueItemEffect.UniqueEffect, 1.0f, OwnerASC->MakeEffectContext());
+        // One application for the whole stack, the spec's stack count scales its modifiers.
+        FGameplayEffectSpecHandle ItemEffectSpec = OwnerASC->MakeOutgoingSpec(Item->ItemEffects[EffectIdx].UniqueEffect, 1.0f, OwnerASC->MakeEffectContext());
+        if (ItemEffectSpec.IsValid() && UniqueBit == INDEX_NONE)
+        {
+            ItemEffectSpec.Data->SetStackCount(StackCount);
+        }
+
+        FActiveGameplayEffectHandle ItemEffectHandle = OwnerASC->BP_ApplyGameplayEffectSpecToSelf(ItemEffectSpec);
         ItemToApply.ActiveEffects.Add(ItemEffectHandle);
     }
+
+    // Periodic modifiers are pulsed by the item service, along with everyone else's.
+    APredItemService* ItemService = Item->PeriodicModifiers.Num() > 0 ? UPredItemLibrary::GetItemService(this) : nullptr;
+    if (ItemService)
+    {
+        const double CurrentTime = GetWorld()->GetTimeSeconds();
+        for (int32 PassiveIdx = 0; PassiveIdx < Item->PeriodicModifiers.Num(); PassiveIdx++)
+        {
+            const FPredItemPeriodicModifier& PeriodicModifier = Item->PeriodicModifiers[PassiveIdx];
+            const float StackedMagnitude = PeriodicModifier.Magnitude.GetMagnitude() * StackCount;
+
+            // Passives carried over from before a stack count change keep their schedule, only how much they pulse changes.
+            if (ItemToApply.ActivePassives.IsValidIndex(PassiveIdx) && ItemService->GetPassiveTicker().SetPassiveMagnitude(ItemToApply.ActivePassives[PassiveIdx], StackedMagnitude))
+            {
+                continue;
+            }
+
+            const FPredItemPassiveHandle PassiveHandle = ItemService->GetPassiveTicker().AddPassive(OwnerASC, PeriodicModifier.Attribute, StackedMagnitude, PeriodicModifier.Period, CurrentTime);
+            if (ItemToApply.ActivePassives.IsValidIndex(PassiveIdx))
+            {
+                ItemToApply.ActivePassives[PassiveIdx] = PassiveHandle;
+            }
+            else
+            {
+                ItemToApply.ActivePassives.Add(PassiveHandle);
+            }
+        }
+    }
 }
 
 void UPredInventoryComponent::RemoveItemEffectsFromOwner(FPredActiveItem& ActiveItemToRemove)
 {
+    PRED_ITEM_SCOPE(RemoveEffects, FPredItemStats::Get(this));
+
     UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
     if (!OwnerASC) { return; }
 
     const UPredItem* Item = ActiveItemToRemove.Item;
-    for (const FPredUniqueItemAttributeModifier& UniqueAttributeModifier : Item->AttributeModifiers)
+    const int32 StackCount = ActiveItemToRemove.GetStackCount();
+    for (int32 ModIdx = 0; ModIdx < Item->AttributeModifiers.Num(); ModIdx++)
     {
+        const int32 UniqueBit = Item->GetAttributeModifierUniqueBit(ModIdx);
+
         // If we are a uniquely specified attribute mod, and this item isn't applying that mod, continue.
-        if (UniqueAttributeModifier.UniqueIdentifier != FGameplayTag::EmptyTag && !IsProviderOfUniqueEffect(ActiveItemToRemove,UniqueAttributeModifier.UniqueIdentifier))
+        if (UniqueBit != INDEX_NONE && !IsProviderOfUniqueEffect(ActiveItemToRemove, UniqueBit))
         {
             continue;
         }
 
-        if (UniqueAttributeModifier.UniqueIdentifier != FGameplayTag::EmptyTag)
+        if (UniqueBit != INDEX_NONE)
         {
-            UniqueProviders.Remove(UniqueAttributeModifier.UniqueIdentifier);
+            ReleaseUniqueIdentifier(UniqueBit);
         }
 
-        FPredItemAttributeModifier AttributeMod = UniqueAttributeModifier.AttributeModifier;
+        const FPredItemAttributeModifier& AttributeMod = Item->AttributeModifiers[ModIdx].AttributeModifier;
 
         if (AttributeMod.AttributeModType == EPredItemAttributeModType::Add)
         {
-            OwnerASC->ApplyModToAttribute(AttributeMod.Attribute, EGameplayModOp::Additive, (-1 * AttributeMod.GetMagnitude()));
+            const int32 ModifierStackCount = UniqueBit != INDEX_NONE ? 1 : StackCount;
+            OwnerASC->ApplyModToAttribute(AttributeMod.Attribute, EGameplayModOp::Additive, (-1 * AttributeMod.GetMagnitude() * ModifierStackCount));
+        }
+    }
+
+    // Give up any unique effects we were providing so another item (or a re-application of this one) can take them.
+    for (int32 EffectIdx = 0; EffectIdx < Item->ItemEffects.Num(); EffectIdx++)
+    {
+        const int32 UniqueBit = Item->GetItemEffectUniqueBit(EffectIdx);
+        if (UniqueBit != INDEX_NONE && IsProviderOfUniqueEffect(ActiveItemToRemove, UniqueBit))
+        {
+            ReleaseUniqueIdentifier(UniqueBit);
+        }
+    }
+
+    if (ActiveItemToRemove.ActivePassives.Num() > 0)
+    {
+        if (APredItemService* ItemService = UPredItemLibrary::GetItemService(this))
+        {
+            for (const FPredItemPassiveHandle& PassiveHandle : ActiveItemToRemove.ActivePassives)
+            {
+                ItemService->GetPassiveTicker().RemovePassive(PassiveHandle);
+            }
         }
     }
 
@@ -305,11 +947,96 @@ void UPredInventoryComponent::RemoveItemEffectsFromOwner(FPredActiveItem& Active
     {
         OwnerASC->RemoveActiveGameplayEffect(ActiveItemEffect);
     }
+
+    // Unique effects picked up while regenerating are tracked separately.
+    for (FPredActiveUniqueEffect& ActiveUniqueEffect : ActiveItemToRemove.ActiveUniqueEffects)
+    {
+        OwnerASC->RemoveActiveGameplayEffect(ActiveUniqueEffect.ActiveEffectHandle);
+    }
+
+    ActiveItemToRemove.ActiveEffects.Reset();
+    ActiveItemToRemove.ActiveUniqueEffects.Reset();
+    ActiveItemToRemove.ActivePassives.Reset();
+}
+
+void UPredInventoryComponent::ClaimUniqueIdentifier(const FPredActiveItem& Item, int32 UniqueBit)
+{
+    EconomyInventory.ClaimUniqueIdentifier(Item.UniqueItemID, UniqueBit);
+}
+
+void UPredInventoryComponent::ReleaseUniqueIdentifier(int32 UniqueBit)
+{
+    EconomyInventory.ReleaseUniqueIdentifier(UniqueBit);
+}
+
+void UPredInventoryComponent::SetStackCountAtSlot(int32 Slot, int32 NewStackCount)
+{
+    FPredActiveItem& SlottedItem = Inventory[Slot].SlottedItem;
+
+    // Periodic modifiers stay registered through the re-application, so they keep pulsing on the phase they started on.
+    TArray<FPredItemPassiveHandle> ActivePassives = MoveTemp(SlottedItem.ActivePassives);
+    SlottedItem.ActivePassives.Reset();
+
+    // Still the same provider of any unique effects, so those are handed straight back when re-applying.
+    RemoveItemEffectsFromOwner(SlottedItem);
+    SlottedItem.StackCount = (uint8)FMath::Clamp(NewStackCount, 1, (int32)MAX_uint8);
+    SlottedItem.ActivePassives = MoveTemp(ActivePassives);
+    ApplyItemEffectsToOwner(SlottedItem);
+}
+
+bool UPredInventoryComponent::RemoveEffectsOfItems(const TBitArray<>& ChangedItemBits)
+{
+    if (!GetOwner()->HasAuthority()) { return false; }
+
+    bool bRemovedAny = false;
+    for (FPredInventorySlot& InventorySlot : Inventory)
+    {
+        if (InventorySlot.IsEmpty() || !ChangedItemBits.IsValidIndex(InventorySlot.SlottedItem.Item->ItemIndex)) { continue; }
+
+        // Removing has to see the magnitudes that were applied, so this runs before the items change.
+        if (ChangedItemBits[InventorySlot.SlottedItem.Item->ItemIndex])
+        {
+            RemoveItemEffectsFromOwner(InventorySlot.SlottedItem);
+            bRemovedAny = true;
+        }
+    }
+    return bRemovedAny;
+}
+
+void UPredInventoryComponent::ReapplyEffectsOfItems(const TBitArray<>& ChangedItemBits)
+{
+    if (!GetOwner()->HasAuthority()) { return; }
+
+    // Same as a stack count change: still the same provider of any unique effects, so those are handed straight back.
+    for (FPredInventorySlot& InventorySlot : Inventory)
+    {
+        if (InventorySlot.IsEmpty() || !ChangedItemBits.IsValidIndex(InventorySlot.SlottedItem.Item->ItemIndex)) { continue; }
+
+        if (ChangedItemBits[InventorySlot.SlottedItem.Item->ItemIndex])
+        {
+            ApplyItemEffectsToOwner(InventorySlot.SlottedItem);
+        }
+    }
+
+    const bool bLoadoutChanged = ActiveLoadout && Algo::AnyOf(ActiveLoadout->Items, [&ChangedItemBits](const UPredItem* Item)
+    {
+        return Item && ChangedItemBits.IsValidIndex(Item->ItemIndex) && ChangedItemBits[Item->ItemIndex];
+    });
+    if (bLoadoutChanged)
+    {
+        ApplyLoadout(ActiveLoadout);
+    }
 }
 
 void UPredInventoryComponent::RegenerateInventoryEffectsPostItemRemoval()
 {
+    PRED_ITEM_SCOPE(RegenerateEffects, FPredItemStats::Get(this));
+
     UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (!OwnerASC || !ItemService) { return; }
+
+    const FPredItemCatalog& Catalog = ItemService->GetCatalog();
 
     for (FPredInventorySlot& InventorySlot : Inventory)
     {
@@ -318,25 +1045,31 @@ void UPredInventoryComponent::RegenerateInventoryEffectsPostItemRemoval()
         FPredActiveItem& ActiveItem = InventorySlot.SlottedItem;
         const UPredItem* ItemDef = ActiveItem.Item;
 
-        FGameplayEffectSpecHandle MultiplicativeEffectSpec = UPredAbilityLibrary::MakeOutgoingMultiplicativeEffectSpec(OwnerASC->MakeEffectContext());
+        // Only unique mods and effects get regenerated. If every identifier this item uses is already applied, there's nothing to do here.
+        if (ItemDef->UniqueIdentifierMask.IsSubsetOf(EconomyInventory.AppliedUniqueIdentifiers))
+        {
+            continue;
+        }
+
+        // Only unique multipliers are regenerated, so start from an empty spec rather than the item's template.
+        FGameplayEffectSpecHandle MultiplicativeEffectSpec = Catalog.MakeMultiplicativeEffectSpec(OwnerASC->MakeEffectContext());
         bool bHasMultiplicative = false;
 
         // Static mods
-        for (const FPredUniqueItemAttributeModifier& UniqueAttributeModifier : ItemDef->AttributeModifiers)
+        for (int32 ModIdx = 0; ModIdx < ItemDef->AttributeModifiers.Num(); ModIdx++)
         {
+            const int32 UniqueBit = ItemDef->GetAttributeModifierUniqueBit(ModIdx);
+
             // If we aren't a unique attribute, or we already have an instance of this unique identifier applied, continue.
             // These were applied when we equipped the item (or some other item).
-            if (UniqueAttributeModifier.UniqueIdentifier == FGameplayTag::EmptyTag || IsUniqueIdentifierApplied(UniqueAttributeModifier.UniqueIdentifier))
+            if (UniqueBit == INDEX_NONE || IsUniqueIdentifierApplied(UniqueBit))
             {
                 continue;
             }
 
-            if (UniqueAttributeModifier.UniqueIdentifier != FGameplayTag::EmptyTag)
-            {
-                UniqueProviders.Add(UniqueAttributeModifier.UniqueIdentifier, ActiveItem);
-            }
+            ClaimUniqueIdentifier(ActiveItem, UniqueBit);
 
-            FPredItemAttributeModifier AttributeModifier = UniqueAttributeModifier.AttributeModifier;
+            const FPredItemAttributeModifier& AttributeModifier = ItemDef->AttributeModifiers[ModIdx].AttributeModifier;
             if (AttributeModifier.AttributeModType == EPredItemAttributeModType::Add)
             {
                 OwnerASC->ApplyModToAttribute(AttributeModifier.Attribute, EGameplayModOp::Additive, (AttributeModifier.GetMagnitude()));
@@ -344,7 +1077,7 @@ void UPredInventoryComponent::RegenerateInventoryEffectsPostItemRemoval()
             if (AttributeModifier.AttributeModType == EPredItemAttributeModType::Multiply)
             {
                 bHasMultiplicative = true;
-                UAbilitySystemBlueprintLibrary::AssignTagSetByCallerMagnitude(MultiplicativeEffectSpec, UPredAbilityLibrary::GetSetByCallerTagForAttribute(AttributeModifier.Attribute), AttributeModifier.GetMagnitude());
+                MultiplicativeEffectSpec.Data->SetSetByCallerMagnitude(ItemDef->AttributeModifierSetByCallerTags[ModIdx], AttributeModifier.GetMagnitude());
             }
         }
         if (bHasMultiplicative)
@@ -354,23 +1087,20 @@ void UPredInventoryComponent::RegenerateInventoryEffectsPostItemRemoval()
         }
 
         // Item Effects
-        for (const FPredUniqueItemEffect& UniqueItemEffect : ItemDef->ItemEffects)
+        for (int32 EffectIdx = 0; EffectIdx < ItemDef->ItemEffects.Num(); EffectIdx++)
         {
-            if (UniqueItemEffect.UniqueIdentifier == FGameplayTag::EmptyTag || IsUniqueIdentifierApplied(UniqueItemEffect.UniqueIdentifier))
+            const int32 UniqueBit = ItemDef->GetItemEffectUniqueBit(EffectIdx);
+            if (UniqueBit == INDEX_NONE || IsUniqueIdentifierApplied(UniqueBit))
             {
                 continue;
             }
 
-            if (UniqueItemEffect.UniqueIdentifier != FGameplayTag::EmptyTag)
-            {
-                UniqueProviders.Add(UniqueItemEffect.UniqueIdentifier, ActiveItem);
-            }
+            const FPredUniqueItemEffect& UniqueItemEffect = ItemDef->ItemEffects[EffectIdx];
+            ClaimUniqueIdentifier(ActiveItem, UniqueBit);
 
             FGameplayEffectSpecHandle ItemEffectSpecHande = OwnerASC->MakeOutgoingSpec(UniqueItemEffect.UniqueEffect, 1.0f, OwnerASC->MakeEffectContext());
             FActiveGameplayEffectHandle ActiveItemEffectHandle = OwnerASC->BP_ApplyGameplayEffectSpecToSelf(ItemEffectSpecHande);
             ActiveItem.ActiveUniqueEffects.Add(FPredActiveUniqueEffect(UniqueItemEffect.UniqueIdentifier, ActiveItemEffectHandle));
-            UniqueProviders.Add(UniqueItemEffect.UniqueIdentifier, ActiveItem);
-
         }
     }
 }
@@ -393,23 +1123,16 @@ void UPredInventoryComponent::GetAllInventorySlots(TArray<FPredInventorySlot>& S
 
 float UPredInventoryComponent::CalculateItemCost(UPredItem* Item)
 {
-    return Item->GetItemCostFor(this);
+    return GetPersonalizedItemCost(Item);
 }
 
 float UPredInventoryComponent::GetItemSellPrice(const UPredItem* Item)
 {
-    // Selling for a fraction of the cost.
-    return Item->GetTotalItemCost() * SellModifier;
-}
-
-bool UPredInventoryComponent::IsProviderOfUniqueEffect(const FPredActiveItem& Item, FGameplayTag UniqueEffectIdentifier)
-{
-    return IsUniqueIdentifierApplied(UniqueEffectIdentifier) && UniqueProviders[UniqueEffectIdentifier].UniqueItemID == Item.UniqueItemID;
-}
-
-bool UPredInventoryComponent::IsUniqueIdentifierApplied(const FGameplayTag& EffectIdentifier)
-{
-    return UniqueProviders.Contains(EffectIdentifier);
+    // Selling for a fraction of the cost. Indexed items go by the catalog, the same prices buying them went by.
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    const FPredItemCatalog& Catalog = ItemService ? ItemService->GetCatalog() : FPredItemCatalog::GetEmpty();
+    const float TotalItemCost = Catalog.Contains(Item) ? Catalog.Economy.GetTotalItemCost(Item->ItemIndex) : Item->GetTotalItemCost();
+    return TotalItemCost * SellModifier;
 }
 
 bool UPredInventoryComponent::CanSellAtInventorySlot(int32 SlotID)
@@ -426,8 +1149,14 @@ float UPredInventoryComponent::GetItemPriceAtInventorySlot(int32 SlotID)
 
 int32 UPredInventoryComponent::GetItemCount(const UPredItem* Item)
 {
+    if (Item && Item->ItemIndex != INDEX_NONE)
+    {
+        return EconomyInventory.GetOwnedCount(Item->ItemIndex);
+    }
+
+    // Item was never indexed by the item service, nothing tracks it so count it the slow way.
     int32 ReturnedCount = 0;
-    for (FPredInventorySlot& ItemSlot : Inventory)
+    for (const FPredInventorySlot& ItemSlot : Inventory)
     {
         if (ItemSlot.SlottedItem.Item == Item)
         {
@@ -439,6 +1168,11 @@ int32 UPredInventoryComponent::GetItemCount(const UPredItem* Item)
 
 bool UPredInventoryComponent::HasItem(const UPredItem* Item)
 {
+    if (Item && Item->ItemIndex != INDEX_NONE)
+    {
+        return EconomyInventory.OwnsItem(Item->ItemIndex);
+    }
+
     return GetItemCount(Item) > 0;
 }
 
@@ -446,21 +1180,316 @@ void UPredInventoryComponent::TryUseInventorySlot(int32 Idx)
 {
     if (!Inventory.IsValidIndex(Idx))
     {
-        TRACE(PredItemLog, Error, "Tried to use item at %d, but %d was not a valid inventory index.", Idx);
+        TRACE(PredItemLog, Error, "Tried to use item at %d, but %d was not a valid inventory index.", Idx, Idx);
         return;
     }
 
-    if (Inventory[Idx].IsEmpty() || !Inventory[Idx].SlottedItem.ActiveAbility.IsValid())
+    if (TryActivateInventorySlot(Idx))
     {
+        BufferedInputSlot = INDEX_NONE;
+        SetComponentTickEnabled(false);
         return;
     }
 
-    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
-    if (OwnerASC)
+    // Couldn't go through yet. Hold on to the press, the newest press replaces any older one.
+    BufferedInputSlot = Idx;
+    BufferedInputExpireTime = GetWorld()->GetTimeSeconds() + InputBufferWindow;
+    SetComponentTickEnabled(true);
+}
+
+bool UPredInventoryComponent::TryActivateInventorySlot(int32 Slot)
+{
+    if (!Inventory.IsValidIndex(Slot)) { return false; }
+
+    const FGameplayAbilitySpecHandle& AbilityHandle = Inventory[Slot].SlottedItem.ActiveAbility;
+    if (Inventory[Slot].IsEmpty() || !AbilityHandle.IsValid())
+    {
+        return false;
+    }
+
+    UAbilitySystemComponent* OwnerASC = GetOwnerAbilitySystem();
+    return OwnerASC && OwnerASC->TryActivateAbility(AbilityHandle);
+}
+
+void UPredInventoryComponent::RecordEconomyEvent(EPredEconomyEventType Type, const UPredItem* Item, int32 Count, float GoldDelta)
+{
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    FPredEconomyJournal* Journal = ItemService ? ItemService->GetEconomyJournal() : nullptr;
+    if (!Journal) { return; }
+
+    FPredEconomyEvent Event;
+    Event.TimeMs = (uint32)(GetWorld()->GetTimeSeconds() * 1000.0f);
+    Event.OwnerID = GetOwner()->GetUniqueID();
+    Event.GoldDelta = GoldDelta;
+    Event.ItemIndex = Item ? (int16)Item->ItemIndex : (int16)INDEX_NONE;
+    Event.Type = Type;
+    Event.Count = (uint8)FMath::Clamp(Count, 0, (int32)MAX_uint8);
+    Journal->Record(Event);
+}
+
+void UPredInventoryComponent::RecordInventoryOp(EPredInventoryOpType Type, const UPredItem* Item, int32 Slot, int32 Count, bool bSucceeded, float Value)
+{
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    FPredInventoryRecorder* Recorder = ItemService ? ItemService->GetInventoryRecorder() : nullptr;
+    if (!Recorder) { return; }
+
+    UAbilitySystemComponent* OwnerASC = GetOwnerAbilitySystem();
+
+    FPredInventoryOp Op;
+    Op.TimeMs = (uint32)(GetWorld()->GetTimeSeconds() * 1000.0f);
+    Op.OwnerID = GetOwner()->GetUniqueID();
+    Op.GoldAfter = OwnerASC ? OwnerASC->GetNumericAttribute(UBaseAttributeSet::GetGoldAttribute()) : CachedGold;
+    Op.Value = Value;
+    Op.ItemIndex = Item ? (int16)Item->ItemIndex : (int16)INDEX_NONE;
+    Op.Type = Type;
+    Op.Slot = (int8)FMath::Clamp(Slot, (int32)INDEX_NONE, (int32)MAX_int8);
+    Op.Count = (uint8)FMath::Clamp(Count, 0, (int32)MAX_uint8);
+    Op.bSucceeded = bSucceeded ? 1 : 0;
+    Recorder->Record(Op);
+}
+
+void UPredInventoryComponent::RecordFinalInventoryState()
+{
+    if (!GetOwner()->HasAuthority() || IsStatOnly()) { return; }
+
+    for (int32 Slot = 0; Slot < Inventory.Num(); Slot++)
+    {
+        const FPredActiveItem& SlottedItem = Inventory[Slot].SlottedItem;
+        RecordInventoryOp(EPredInventoryOpType::SlotState, SlottedItem.Item, Slot, SlottedItem.GetStackCount(), true, 0.0f);
+    }
+    RecordInventoryOp(EPredInventoryOpType::End, nullptr, INDEX_NONE, 0, true, 0.0f);
+}
+
+bool UPredInventoryComponent::MakeInventorySnapshot(FPredInventorySnapshot& OutSnapshot) const
+{
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (IsStatOnly() || !ItemService || ItemService->GetCatalog().Num() == 0) { return false; }
+
+    OutSnapshot.SlotItems.SetNumUninitialized(Inventory.Num());
+    OutSnapshot.SlotCounts.SetNumUninitialized(Inventory.Num());
+    for (int32 Slot = 0; Slot < Inventory.Num(); Slot++)
+    {
+        // The economy copy already has every slot as item indices, unindexed items are left out of it the same way.
+        OutSnapshot.SlotItems[Slot] = EconomyInventory.SlotItems[Slot];
+        OutSnapshot.SlotCounts[Slot] = EconomyInventory.SlotItems[Slot] != INDEX_NONE ? EconomyInventory.SlotCounts[Slot] : 0;
+    }
+
+    OutSnapshot.Gold = CachedGold;
+
+    OutSnapshot.UniqueProviderSlots.Reset();
+    for (int32 Slot = 0; Slot < Inventory.Num(); Slot++)
+    {
+        const FPredActiveItem& SlottedItem = Inventory[Slot].SlottedItem;
+        if (OutSnapshot.SlotItems[Slot] == INDEX_NONE) { continue; }
+
+        const FPredUniqueIdentifierMask Provided = EconomyInventory.GetProvidedUniqueIdentifiers(SlottedItem.UniqueItemID, SlottedItem.Item->UniqueIdentifierMask);
+        for (int32 UniqueBit = 0; UniqueBit < ItemService->GetCatalog().UniqueIdentifiers.Num(); UniqueBit++)
+        {
+            if (Provided.IsBitSet(UniqueBit))
+            {
+                OutSnapshot.UniqueProviderSlots.Add({ UniqueBit, Slot });
+            }
+        }
+    }
+
+    return true;
+}
+
+bool UPredInventoryComponent::RestoreInventorySnapshot(const FPredInventorySnapshot& Snapshot)
+{
+    if (!GetOwner()->HasAuthority() || IsStatOnly()) { return false; }
+
+    UAbilitySystemComponent* OwnerASC = GetOwnerAbilitySystem();
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (!OwnerASC || !ItemService || Snapshot.NumSlots() != Inventory.Num()) { return false; }
+
+    const FPredItemCatalog& Catalog = ItemService->GetCatalog();
+    for (int32 Slot = 0; Slot < Snapshot.NumSlots(); Slot++)
+    {
+        const int32 ItemIndex = Snapshot.SlotItems[Slot];
+        if (ItemIndex != INDEX_NONE && (!Catalog.Items.IsValidIndex(ItemIndex) || Snapshot.SlotCounts[Slot] < 1 || Snapshot.SlotCounts[Slot] > Catalog.GetMaxStackSize(ItemIndex)))
+        {
+            return false;
+        }
+    }
+
+    // Whatever we hold now goes first, a reconnecting player's new pawn usually holds nothing.
+    for (FPredInventorySlot& InventorySlot : Inventory)
+    {
+        if (!InventorySlot.IsEmpty())
+        {
+            RemoveItemEffectsFromOwner(InventorySlot.SlottedItem);
+            RevokeItemAbility(InventorySlot.SlottedItem);
+            InventorySlot.SlottedItem = FPredActiveItem();
+        }
+    }
+
+    // Every slot is filled before anything is applied, so the unique providers can be handed out up front.
+    for (int32 Slot = 0; Slot < Snapshot.NumSlots(); Slot++)
+    {
+        if (Snapshot.SlotItems[Slot] == INDEX_NONE) { continue; }
+
+        FPredActiveItem& SlottedItem = Inventory[Slot].SlottedItem;
+        SlottedItem.Item = Catalog.Items[Snapshot.SlotItems[Slot]];
+        SlottedItem.UniqueItemID = ++LastUniqueItemID;
+        SlottedItem.StackCount = Snapshot.SlotCounts[Slot];
+    }
+    RebuildItemOwnership();
+
+    for (const TPair<int32, int32>& UniqueProviderSlot : Snapshot.UniqueProviderSlots)
+    {
+        const FPredActiveItem& Provider = Inventory[UniqueProviderSlot.Value].SlottedItem;
+        if (Provider.IsValid() && Provider.Item->UniqueIdentifierMask.IsBitSet(UniqueProviderSlot.Key))
+        {
+            ClaimUniqueIdentifier(Provider, UniqueProviderSlot.Key);
+        }
+    }
+
+    // Additive modifiers are summed up across every item and applied once per attribute, rather than once per item.
+    TMap<FGameplayAttribute, float> AdditiveMods;
+    {
+        TGuardValue<TMap<FGameplayAttribute, float>*> BatchGuard(BatchedAdditiveMods, &AdditiveMods);
+        for (FPredInventorySlot& InventorySlot : Inventory)
+        {
+            if (!InventorySlot.IsEmpty())
+            {
+                ApplyItemEffectsToOwner(InventorySlot.SlottedItem);
+                GrantItemAbility(InventorySlot.SlottedItem);
+            }
+        }
+    }
+    for (const TPair<FGameplayAttribute, float>& AdditiveMod : AdditiveMods)
+    {
+        OwnerASC->ApplyModToAttribute(AdditiveMod.Key, EGameplayModOp::Additive, AdditiveMod.Value);
+    }
+
+    OwnerASC->ApplyModToAttribute(UBaseAttributeSet::GetGoldAttribute(), EGameplayModOp::Additive, Snapshot.Gold - OwnerASC->GetNumericAttribute(UBaseAttributeSet::GetGoldAttribute()));
+
+    UpdateMemoryStats();
+    OnInventoryRestored.Broadcast();
+
+    TRACE(PredItemLog, Log, "Restored the inventory of %s from a snapshot, %d unique identifiers handed back to their providers.", *GetNameSafe(GetOwner()), Snapshot.UniqueProviderSlots.Num());
+    return true;
+}
+
+/** Returns what identifies the player owning @Owner across reconnects, empty if no player owns it */
+static FString GetOwningPlayerKey(const AActor* Owner, const APlayerController** OutPlayerController = nullptr)
+{
+    const APawn* OwnerPawn = Cast<APawn>(Owner);
+    const APlayerController* PlayerController = OwnerPawn ? Cast<APlayerController>(OwnerPawn->GetController()) : nullptr;
+    const APlayerState* PlayerState = PlayerController ? PlayerController->PlayerState : nullptr;
+    if (OutPlayerController)
+    {
+        *OutPlayerController = PlayerController;
+    }
+
+    if (!PlayerState) { return FString(); }
+    return PlayerState->GetUniqueId().IsValid() ? PlayerState->GetUniqueId().ToString() : PlayerState->GetPlayerName();
+}
+
+FString UPredInventoryComponent::GetOwnerPlayerKey() const
+{
+    return GetOwningPlayerKey(GetOwner());
+}
+
+void UPredInventoryComponent::SaveInventoryIfDisconnecting()
+{
+    if (!GetOwner()->HasAuthority() || IsStatOnly()) { return; }
+
+    // A player controller which lost its player is what takes the pawn down on disconnect (see APlayerController::PawnLeavingGame).
+    const APlayerController* PlayerController = nullptr;
+    const FString PlayerKey = GetOwningPlayerKey(GetOwner(), &PlayerController);
+    if (PlayerKey.IsEmpty() || PlayerController->Player) { return; }
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    FPredInventorySnapshot Snapshot;
+    if (!ItemService || !MakeInventorySnapshot(Snapshot)) { return; }
+
+    TArray<uint8> PackedSnapshot;
+    Snapshot.Pack(ItemService->GetCatalog(), PackedSnapshot);
+    TRACE(PredItemLog, Log, "%s disconnected, saved their inventory in %d bytes.", *PlayerKey, PackedSnapshot.Num());
+    ItemService->SaveInventorySnapshot(PlayerKey, MoveTemp(PackedSnapshot));
+}
+
+bool UPredInventoryComponent::RestoreSavedInventory()
+{
+    if (!GetOwner()->HasAuthority() || IsStatOnly()) { return false; }
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    const FString PlayerKey = GetOwningPlayerKey(GetOwner());
+    TArray<uint8> PackedSnapshot;
+    if (!ItemService || PlayerKey.IsEmpty() || !ItemService->TakeInventorySnapshot(PlayerKey, PackedSnapshot)) { return false; }
+
+    FPredInventorySnapshot Snapshot;
+    if (!Snapshot.Unpack(ItemService->GetCatalog(), PackedSnapshot) || !RestoreInventorySnapshot(Snapshot))
+    {
+        TRACE(PredItemLog, Warning, "Saved inventory of %s no longer fits, starting them over.", *PlayerKey);
+        return false;
+    }
+    return true;
+}
+
+UAbilitySystemComponent* UPredInventoryComponent::GetOwnerAbilitySystem()
+{
+    if (!CachedOwnerASC.IsValid())
+    {
+        CachedOwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    }
+    return CachedOwnerASC.Get();
+}
+
+void UPredInventoryComponent::GrantItemAbility(FPredActiveItem& ActiveItem)
+{
+    const UPredItem* Item = ActiveItem.Item;
+    if (!Item->ActiveAbility) { return; }
+
+    UAbilitySystemComponent* OwnerASC = GetOwnerAbilitySystem();
+    if (!OwnerASC) { return; }
+
+    // Another item already granted this ability, share its spec rather than granting it twice.
+    if (const int32* ProviderID = AbilityProvider.Find(Item->ActiveAbility))
+    {
+        for (const FPredInventorySlot& InventorySlot : Inventory)
+        {
+            if (InventorySlot.SlottedItem.UniqueItemID == *ProviderID && InventorySlot.SlottedItem.ActiveAbility.IsValid())
+            {
+                ActiveItem.ActiveAbility = InventorySlot.SlottedItem.ActiveAbility;
+                return;
+            }
+        }
+    }
+
+    ActiveItem.ActiveAbility = OwnerASC->GiveAbility(FGameplayAbilitySpec(Item->ActiveAbility->GetDefaultObject<UGameplayAbility>(), 1, INDEX_NONE, this));
+    AbilityProvider.Add(Item->ActiveAbility, ActiveItem.UniqueItemID);
+}
+
+void UPredInventoryComponent::RevokeItemAbility(FPredActiveItem& ActiveItem)
+{
+    const FGameplayAbilitySpecHandle AbilityHandle = ActiveItem.ActiveAbility;
+    ActiveItem.ActiveAbility = FGameplayAbilitySpecHandle();
+    if (!AbilityHandle.IsValid()) { return; }
+
+    // Only the provider owns the spec, everyone else was sharing it.
+    const TSubclassOf<UBaseGameplayAbility> AbilityClass = ActiveItem.Item->ActiveAbility;
+    const int32* ProviderID = AbilityProvider.Find(AbilityClass);
+    if (!ProviderID || *ProviderID != ActiveItem.UniqueItemID) { return; }
+
+    // Hand the spec over to another item sharing it.
+    for (const FPredInventorySlot& InventorySlot : Inventory)
     {
-        OwnerASC->TryActivateAbility(Inventory[Idx].SlottedItem.ActiveAbility);
+        const FPredActiveItem& OtherItem = InventorySlot.SlottedItem;
+        if (OtherItem.UniqueItemID != ActiveItem.UniqueItemID && OtherItem.ActiveAbility == AbilityHandle)
+        {
+            AbilityProvider.Add(AbilityClass, OtherItem.UniqueItemID);
+            return;
+        }
     }
 
+    AbilityProvider.Remove(AbilityClass);
+    if (UAbilitySystemComponent* OwnerASC = GetOwnerAbilitySystem())
+    {
+        OwnerASC->ClearAbility(AbilityHandle);
+    }
 }
 
 bool UPredInventoryComponent::CanPurchaseItem(UPredItem* Item, bool bUseLocation)
@@ -476,35 +1505,84 @@ bool UPredInventoryComponent::CanPurchaseItem(UPredItem* Item, bool bUseLocation
 
 void UPredInventoryComponent::Server_TryBuyItem_Implementation(UPredItem* Item)
 {
-    if (CanPurchaseItem(Item))
+    PRED_ITEM_SCOPE(Purchase, FPredItemStats::Get(this));
+
+    // The equips and removals a purchase makes are replayed as part of it, they aren't recorded on their own.
+    TGuardValue<int32> OpDepthGuard(InventoryOpDepth, InventoryOpDepth + 1);
+
+    if (!CanPurchaseItem(Item))
     {
-        // Determine how much we're paying for this item, before we remove the children
-        // (and making it more expensive)
-        float ItemCost = Item->GetItemCostFor(this);
+        RecordInventoryOp(EPredInventoryOpType::Buy, Item, INDEX_NONE, 1, false, 0.0f);
+        return;
+    }
+
+    // Determine how much we're paying for this item, before we remove the children
+    // (and making it more expensive)
+    float ItemCost = 0.0f;
+    if (PlanPurchase(Item))
+    {
+        // Indexed items are priced by the same walk that picked the slots we clear, so the two can't disagree.
+        ItemCost = PurchasePlan.Cost;
+        ConsumePurchasePlan();
+    }
+    else
+    {
+        ItemCost = Item->GetItemCostFor(this);
 
         // Clear out the inventory of any required items we had completed, will also find partially completed required items.
         ClearInventoryPostPurchase(Item);
+    }
 
-        // Equip the item.
-        EquipItem(Item, 1.0);
+    // Equip the item.
+    EquipItem(Item, 1.0);
 
-        // Apply cost
-        UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
-        if (!OwnerASC) { TRACE(PredItemLog, Error, "Tried to charge %s for %s, but could not find AbilitySystemComponent"); return; }
+    // Apply cost
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    if (!OwnerASC) { TRACE(PredItemLog, Error, "Tried to charge %s for %s, but could not find AbilitySystemComponent", *GetNameSafe(GetOwner()), *GetNameSafe(Item)); return; }
+
+    UGameplayEffect* ItemStaticModifierGE = NewObject<UGameplayEffect>();
+    ItemStaticModifierGE->DurationPolicy = EGameplayEffectDurationType::Instant;
 
-        UGameplayEffect* ItemStaticModifierGE = NewObject<UGameplayEffect>();
-        ItemStaticModifierGE->DurationPolicy = EGameplayEffectDurationType::Instant;
+    FGameplayModifierInfo GameplayModInfo;
+    GameplayModInfo.Attribute = UBaseAttributeSet::GetGoldAttribute();
+    GameplayModInfo.ModifierMagnitude = FScalableFloat(-1 * ItemCost);
+    GameplayModInfo.ModifierOp = EGameplayModOp::Additive;
+
+    ItemStaticModifierGE->Modifiers.Add(GameplayModInfo);
+
+    OwnerASC->ApplyGameplayEffectToSelf(ItemStaticModifierGE, 1.0f, OwnerASC->MakeEffectContext());
+
+    RecordEconomyEvent(EPredEconomyEventType::Buy, Item, 1, -ItemCost);
+    RecordInventoryOp(EPredInventoryOpType::Buy, Item, INDEX_NONE, 1, true, ItemCost);
+    INC_DWORD_STAT(STAT_PredItem_NumPurchases);
+    TRACE(PredItemLog, Verbose, "%s purchased item %s for %f gold.", *GetNameSafe(GetOwner()), *Item->ItemName.ToString(), ItemCost);
+}
 
-        FGameplayModifierInfo GameplayModInfo;
-        GameplayModInfo.Attribute = UBaseAttributeSet::GetGoldAttribute();
-        GameplayModInfo.ModifierMagnitude = FScalableFloat(-1 * ItemCost);
-        GameplayModInfo.ModifierOp = EGameplayModOp::Additive;
+const FPredItemCatalog* UPredInventoryComponent::PlanPurchase(const UPredItem* Item)
+{
+    APredItemService* ItemService = Item->ItemIndex != INDEX_NONE ? UPredItemLibrary::GetItemService(this) : nullptr;
+    if (!ItemService || !ItemService->GetCatalog().Economy.IsValidItem(Item->ItemIndex))
+    {
+        return nullptr;
+    }
 
-        ItemStaticModifierGE->Modifiers.Add(GameplayModInfo);
+    const FPredItemCatalog& Catalog = ItemService->GetCatalog();
+    Catalog.Economy.PlanPurchase(EconomyInventory, Item->ItemIndex, PurchasePlan);
+    return &Catalog;
+}
 
-        OwnerASC->ApplyGameplayEffectToSelf(ItemStaticModifierGE, 1.0f, OwnerASC->MakeEffectContext());
+void UPredInventoryComponent::ConsumePurchasePlan()
+{
+    // The planned slots are cleared in one go, effects are regenerated once at the end rather than after every emptied slot.
+    bool bEmptiedSlot = false;
+    for (const FPredConsumedSlot& ConsumedSlot : PurchasePlan.ConsumedSlots)
+    {
+        bEmptiedSlot |= TakeItemsFromSlot(ConsumedSlot.Count, ConsumedSlot.Slot);
+    }
 
-        TRACE(PredItemLog, Log, "%s purchased item %s for %f gold.", *GetNameSafe(GetOwner()), *Item->ItemName.ToString(), ItemCost);
+    if (bEmptiedSlot)
+    {
+        RegenerateInventoryEffectsPostItemRemoval();
     }
 }
 
@@ -520,7 +1598,7 @@ void UPredInventoryComponent::ClearInventoryPostPurchase(const UPredItem* Item)
 
 void UPredInventoryComponent::ClearInventoryPostPurchaseHelper(const UPredItem* ChildItem)
 {
-    // If we have this child item, we remove it and we're done.
+    // If we have this child item, we remove it and we're done. The purchase's Buy event covers it in the journal.
     // Don't want to remove any children of this node.
     if (HasItem(ChildItem))
     {
@@ -542,57 +1620,325 @@ bool UPredInventoryComponent::Server_TryBuyItem_Validate(UPredItem* Item)
 
 void UPredInventoryComponent::Server_TrySellItem_Implementation(int32 ItemSlot)
 {
-    if (UPredItemLibrary::CanSellAtInventorySlot(GetOwner(), ItemSlot))
+    PRED_ITEM_SCOPE(Sell, FPredItemStats::Get(this));
+
+    TGuardValue<int32> OpDepthGuard(InventoryOpDepth, InventoryOpDepth + 1);
+
+    if (!UPredItemLibrary::CanSellAtInventorySlot(GetOwner(), ItemSlot))
     {
+        RecordInventoryOp(EPredInventoryOpType::Sell, nullptr, ItemSlot, 1, false, 0.0f);
+        return;
+    }
+
+    UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
+    if (!OwnerASC) { /** yikes */ return; }
 
-        UAbilitySystemComponent* OwnerASC = UAbilitySystemBlueprintLibrary::GetAbilitySystemComponent(GetOwner());
-        if (!OwnerASC) { /** yikes */ return; }
+    const UPredItem* ItemAtSlot = Inventory[ItemSlot].SlottedItem.Item;
+    int32 ItemSellPrice = FMath::FloorToInt(GetItemSellPrice(ItemAtSlot));
 
-        const UPredItem* ItemAtSlot = Inventory[ItemSlot].SlottedItem.Item;
-        int32 ItemSellPrice = FMath::FloorToInt(GetItemSellPrice(ItemAtSlot));
+    UGameplayEffect* ItemStaticModifierGE = NewObject<UGameplayEffect>();
+    ItemStaticModifierGE->DurationPolicy = EGameplayEffectDurationType::Instant;
 
-        UGameplayEffect* ItemStaticModifierGE = NewObject<UGameplayEffect>();
-        ItemStaticModifierGE->DurationPolicy = EGameplayEffectDurationType::Instant;
+    FGameplayModifierInfo GameplayModInfo;
+    GameplayModInfo.Attribute = UBaseAttributeSet::GetGoldAttribute();
+    GameplayModInfo.ModifierMagnitude = FScalableFloat(ItemSellPrice);
+    GameplayModInfo.ModifierOp = EGameplayModOp::Additive;
 
-        FGameplayModifierInfo GameplayModInfo;
-        GameplayModInfo.Attribute = UBaseAttributeSet::GetGoldAttribute();
-        GameplayModInfo.ModifierMagnitude = FScalableFloat(ItemSellPrice);
-        GameplayModInfo.ModifierOp = EGameplayModOp::Additive;
+    ItemStaticModifierGE->Modifiers.Add(GameplayModInfo);
 
-        ItemStaticModifierGE->Modifiers.Add(GameplayModInfo);
+    OwnerASC->ApplyGameplayEffectToSelf(ItemStaticModifierGE, 1.0f, OwnerASC->MakeEffectContext());
+
+    RemoveItemAtSlot(1, ItemSlot);
+
+    RecordEconomyEvent(EPredEconomyEventType::Sell, ItemAtSlot, 1, ItemSellPrice);
+    RecordInventoryOp(EPredInventoryOpType::Sell, ItemAtSlot, ItemSlot, 1, true, ItemSellPrice);
+    INC_DWORD_STAT(STAT_PredItem_NumSells);
+    TRACE(PredItemLog, Verbose, "%s sold item %s for %d gold.", *GetNameSafe(GetOwner()), *ItemAtSlot->ItemName.ToString(), ItemSellPrice);
+}
+
+bool UPredInventoryComponent::Server_TrySellItem_Validate(int32 ItemSlot)
+{
+    return true;
+}
 
-        OwnerASC->ApplyGameplayEffectToSelf(ItemStaticModifierGE, 1.0f, OwnerASC->MakeEffectContext());
+void UPredInventoryComponent::OnRep_Inventory(const TArray<FPredInventorySlot>& OldInventory)
+{
+    PRED_ITEM_SCOPE(InventoryRep, FPredItemStats::Get(this));
 
-        RemoveItemAtSlot(1, ItemSlot);
+    RebuildItemOwnership();
+    UpdateMemoryStats();
 
-        TRACE(PredItemLog, Log, "%s sold item %s for %d gold.", *GetNameSafe(GetOwner()), *ItemAtSlot->ItemName.ToString(), ItemSellPrice);
+    // Joining late or getting a restored inventory brings in every slot at once, only the ones that actually changed are worth a UI update.
+    for (int32 i = 0; i < Inventory.Num(); i++)
+    {
+        const FPredActiveItem& SlottedItem = Inventory[i].SlottedItem;
+        const FPredActiveItem* OldItem = OldInventory.IsValidIndex(i) ? &OldInventory[i].SlottedItem : nullptr;
+        const bool bUnchanged = OldItem && OldItem->Item == SlottedItem.Item && OldItem->UniqueItemID == SlottedItem.UniqueItemID
+            && OldItem->StackCount == SlottedItem.StackCount && OldItem->ActiveAbility == SlottedItem.ActiveAbility;
+        if (!bUnchanged)
+        {
+            OnItemSlotUpdated.Broadcast(Inventory[i]);
+        }
     }
 }
 
-bool UPredInventoryComponent::Server_TrySellItem_Validate(int32 ItemSlot)
+void UPredInventoryComponent::OnRep_PublicSummary()
+{
+    PRED_ITEM_SCOPE(InventoryRep, FPredItemStats::Get(this));
+
+    ApplyPublicSummary();
+}
+
+void UPredInventoryComponent::MarkPublicSummaryDirty()
 {
+    if (!GetOwner()->HasAuthority() || IsStatOnly() || PublicSummaryTimer.IsValid()) { return; }
+
+    // Pushing at most once per interval is what keeps a burst of slot changes (a purchase and the parts it used up) to one update.
+    FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+    const float Delay = LastPublicSummaryTime + PublicSummaryInterval - GetWorld()->GetTimeSeconds();
+    if (Delay > 0.0f)
+    {
+        TimerManager.SetTimer(PublicSummaryTimer, this, &UPredInventoryComponent::PushPublicSummary, Delay, false);
+    }
+    else
+    {
+        PublicSummaryTimer = TimerManager.SetTimerForNextTick(this, &UPredInventoryComponent::PushPublicSummary);
+    }
+}
+
+void UPredInventoryComponent::PushPublicSummary()
+{
+    PublicSummaryTimer.Invalidate();
+    LastPublicSummaryTime = GetWorld()->GetTimeSeconds();
+
+    FPredInventorySummary NewSummary;
+    NewSummary.SlotItems.SetNumUninitialized(EconomyInventory.NumSlots());
+    NewSummary.SlotCounts.SetNumUninitialized(EconomyInventory.NumSlots());
+    for (int32 Slot = 0; Slot < EconomyInventory.NumSlots(); Slot++)
+    {
+        NewSummary.SlotItems[Slot] = (int16)EconomyInventory.SlotItems[Slot];
+        NewSummary.SlotCounts[Slot] = EconomyInventory.SlotCounts[Slot];
+    }
+
+    if (NewSummary == PublicSummary) { return; }
+
+    PublicSummary = MoveTemp(NewSummary);
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (ItemService)
+    {
+        PublicSummaryRevision = ItemService->NextSummaryRevision();
+    }
+}
+
+void UPredInventoryComponent::MarkTimelineDirty()
+{
+    if (!GetOwner()->HasAuthority() || IsStatOnly() || TimelineRecordTimer.IsValid()) { return; }
+
+    TimelineRecordTimer = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UPredInventoryComponent::RecordTimeline);
+}
+
+void UPredInventoryComponent::RecordTimeline()
+{
+    TimelineRecordTimer.Invalidate();
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (ItemService)
+    {
+        ItemService->RecordInventoryTimeline(this);
+    }
+}
+
+void UPredInventoryComponent::ApplyPublicSummary()
+{
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    const FPredItemCatalog& Catalog = ItemService ? ItemService->GetCatalog() : FPredItemCatalog::GetEmpty();
+
+    // Items can only be looked up once the catalog has replicated, OnCatalogLoaded tries again then.
+    for (const int16 ItemIndex : PublicSummary.SlotItems)
+    {
+        if (ItemIndex != INDEX_NONE && !Catalog.Items.IsValidIndex(ItemIndex)) { return; }
+    }
+
+    const int32 OldNumSlots = Inventory.Num();
+    Inventory.SetNum(PublicSummary.NumSlots());
+
+    TArray<int32, TInlineAllocator<8>> ChangedSlots;
+    for (int32 Slot = 0; Slot < PublicSummary.NumSlots(); Slot++)
+    {
+        FPredInventorySlot& InventorySlot = Inventory[Slot];
+        const int32 ItemIndex = PublicSummary.SlotItems[Slot];
+        const UPredItem* Item = ItemIndex != INDEX_NONE ? Catalog.Items[ItemIndex] : nullptr;
+        if (Slot < OldNumSlots && InventorySlot.SlottedItem.Item == Item && InventorySlot.SlottedItem.StackCount == PublicSummary.SlotCounts[Slot]) { continue; }
+
+        // Only the item and its stack, the rest of the slot is our owner's business.
+        InventorySlot.SlotID = Slot;
+        InventorySlot.SlottedItem = FPredActiveItem();
+        InventorySlot.SlottedItem.Item = Item;
+        InventorySlot.SlottedItem.StackCount = PublicSummary.SlotCounts[Slot];
+        ChangedSlots.Add(Slot);
+    }
+
+    RebuildItemOwnership();
+    UpdateMemoryStats();
+
+    for (const int32 Slot : ChangedSlots)
+    {
+        OnItemSlotUpdated.Broadcast(Inventory[Slot]);
+    }
+}
+
+APlayerState* UPredInventoryComponent::GetOwnerPlayerState() const
+{
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    return OwnerPawn ? OwnerPawn->GetPlayerState() : nullptr;
+}
+
+void UPredInventoryComponent::SetScoreboardOpen(bool bOpen)
+{
+    Server_SetScoreboardOpen(bOpen);
+}
+
+void UPredInventoryComponent::Server_SetScoreboardOpen_Implementation(bool bOpen)
+{
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (ItemService && !IsStatOnly())
+    {
+        ItemService->SetScoreboardViewer(this, bOpen);
+    }
+}
+
+bool UPredInventoryComponent::Server_SetScoreboardOpen_Validate(bool bOpen)
+{
+    return true;
+}
+
+void UPredInventoryComponent::Client_ReceiveScoreboardSummaries_Implementation(const TArray<FPredScoreboardEntry>& Entries)
+{
+    for (const FPredScoreboardEntry& Entry : Entries)
+    {
+        // Players who left before this arrived come in null.
+        if (Entry.Player)
+        {
+            ScoreboardSummaries.Add(Entry.Player, Entry.Summary);
+        }
+    }
+
+    OnScoreboardUpdated.Broadcast();
+}
+
+bool UPredInventoryComponent::GetScoreboardItems(const APlayerState* Player, TArray<UPredItem*>& OutItems, TArray<int32>& OutStackCounts) const
+{
+    OutItems.Reset();
+    OutStackCounts.Reset();
+
+    const FPredInventorySummary* Summary = ScoreboardSummaries.Find(Player);
+    if (!Summary) { return false; }
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    const FPredItemCatalog& Catalog = ItemService ? ItemService->GetCatalog() : FPredItemCatalog::GetEmpty();
+    for (int32 Slot = 0; Slot < Summary->NumSlots(); Slot++)
+    {
+        const int32 ItemIndex = Summary->SlotItems[Slot];
+        OutItems.Add(Catalog.Items.IsValidIndex(ItemIndex) ? Catalog.Items[ItemIndex] : nullptr);
+        OutStackCounts.Add(Summary->SlotCounts[Slot]);
+    }
     return true;
 }
 
-void UPredInventoryComponent::OnRep_Inventory()
+bool FPredInventorySummary::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
 {
-    for (FPredInventorySlot& Slot : Inventory)
+    uint32 NumPackedSlots = NumSlots();
+    Ar.SerializeIntPacked(NumPackedSlots);
+    if (Ar.IsLoading())
     {
-        OnItemSlotUpdated.Broadcast(Slot);
+        if (NumPackedSlots > MAX_uint8) { Ar.SetError(); bOutSuccess = false; return true; }
+
+        SlotItems.SetNumUninitialized(NumPackedSlots);
+        SlotCounts.SetNumUninitialized(NumPackedSlots);
+    }
+
+    // Item index + 1 so empty slots are 0, and only stacks of more than one spend bits on their count.
+    for (int32 Slot = 0; Slot < (int32)NumPackedSlots; Slot++)
+    {
+        uint32 PackedItem = Ar.IsSaving() ? SlotItems[Slot] + 1 : 0;
+        uint32 PackedCount = Ar.IsSaving() ? SlotCounts[Slot] : 0;
+        uint8 bStacked = PackedCount > 1 ? 1 : 0;
+        Ar.SerializeIntPacked(PackedItem);
+        Ar.SerializeBits(&bStacked, 1);
+        if (bStacked)
+        {
+            Ar.SerializeIntPacked(PackedCount);
+        }
+
+        if (Ar.IsLoading())
+        {
+            SlotItems[Slot] = (int16)((int32)FMath::Min<uint32>(PackedItem, MAX_int16) - 1);
+            SlotCounts[Slot] = bStacked ? (uint8)FMath::Min<uint32>(PackedCount, MAX_uint8) : (PackedItem != 0 ? 1 : 0);
+        }
     }
+
+    bOutSuccess = !Ar.IsError();
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
 // Debug
 //////////////////////////////////////////////////////////////////////////
 
+int32 UPredInventoryComponent::GetInventoryMemoryBytes() const
+{
+    SIZE_T Bytes = GetClass()->GetStructureSize();
+    Bytes += Inventory.GetAllocatedSize();
+    Bytes += EconomyInventory.GetAllocatedSize();
+    Bytes += AbilityProvider.GetAllocatedSize();
+
+    // Handles live inline in the slots, these only count anything once a slot spills over to the heap.
+    for (const FPredInventorySlot& InventorySlot : Inventory)
+    {
+        Bytes += InventorySlot.SlottedItem.ActiveEffects.GetAllocatedSize();
+        Bytes += InventorySlot.SlottedItem.ActiveUniqueEffects.GetAllocatedSize();
+        Bytes += InventorySlot.SlottedItem.ActivePassives.GetAllocatedSize();
+    }
+
+    return (int32)Bytes;
+}
+
+void UPredInventoryComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+    Super::GetResourceSizeEx(CumulativeResourceSize);
+
+    // Super already accounts for the object itself.
+    CumulativeResourceSize.AddDedicatedSystemMemoryBytes(GetInventoryMemoryBytes() - GetClass()->GetStructureSize());
+}
+
+void UPredInventoryComponent::UpdateMemoryStats()
+{
+    const int32 CurrentBytes = GetInventoryMemoryBytes();
+    if (CurrentBytes > ReportedMemoryBytes)
+    {
+        INC_MEMORY_STAT_BY(STAT_PredInventoryMemory, CurrentBytes - ReportedMemoryBytes);
+    }
+    else
+    {
+        DEC_MEMORY_STAT_BY(STAT_PredInventoryMemory, ReportedMemoryBytes - CurrentBytes);
+    }
+    ReportedMemoryBytes = CurrentBytes;
+}
+
 void UPredInventoryComponent::GenerateDebugString(FString& OutDebugString)
 {
     OutDebugString = "";
 
-    OutDebugString += FString::Printf(TEXT("Inventory for %s: \n"), *GetNameSafe(GetOwner()));
+    OutDebugString += FString::Printf(TEXT("Inventory for %s (%d bytes): \n"), *GetNameSafe(GetOwner()), GetInventoryMemoryBytes());
     for (int i = 0; i < Inventory.Num(); i++)
     {
-        OutDebugString += FString::Printf(TEXT("%s,"), Inventory[i].IsEmpty() ? TEXT("Empty") : *Inventory[i].SlottedItem.Item->GetItemName());
+        if (Inventory[i].IsEmpty())
+        {
+            OutDebugString += TEXT("Empty,");
+            continue;
+        }
+
+        OutDebugString += FString::Printf(TEXT("%s x%d,"), *Inventory[i].SlottedItem.Item->GetItemName(), Inventory[i].SlottedItem.GetStackCount());
     }
 }
@@ -6,14 +6,39 @@
 #include "Components/ActorComponent.h"
 
 #include "GameplayEffect.h"
+#include "GameplayEffectTypes.h"
 #include "GameplayTags.h"
 
 #include "PredItem.h"
+#include "PredItemCatalog.h"
+#include "PredItemStatPreview.h"
+#include "PredItemPassiveTicker.h"
 
 #include "PredInventoryComponent.generated.h"
 
 class UTexture2D;
 class UBaseGameplayAbility;
+class UPredItemLoadout;
+class APlayerState;
+struct FPredItemCatalog;
+struct FPredInventorySnapshot;
+enum class EPredEconomyEventType : uint8;
+enum class EPredInventoryOpType : uint8;
+
+/**
+ * What an inventory component is used for.
+ */
+UENUM(BlueprintType)
+enum class EPredInventoryMode : uint8
+{
+    /** Player inventories: gold, slots, input, replication, per-item effects. */
+    Full,
+    /**
+     * Non-player actors (minions, jungle camps) which only need the stats of their items.
+     * No gold, no input, no slots and nothing replicated, items are given as a whole through ApplyLoadout.
+     */
+    StatOnly
+};
 
 /**
  * Represents a currently-active unique effect.
@@ -41,33 +66,42 @@ struct FPredActiveUniqueEffect
 
 /**
  * Represents an equipped item. If there are two of the same equipped items in an inventory, there will be two distinct
- * structs representing them (each with a unique ID).
+ * structs representing them (each with a unique ID), unless the item stacks, in which case one struct holds the whole stack.
  * Maintains any state about the effects an item may have applied.
+ * Kept small, there is one per slot of every inventory and they are copied around with the slots.
  */
 USTRUCT(BlueprintType)
 struct FPredActiveItem
 {
     GENERATED_BODY()
 
-    FPredActiveItem() { UniqueItemID = FGuid::NewGuid(); }
-    
     /** Effectively the CDO of the item. Generated by the asset manager */
     UPROPERTY(BlueprintReadOnly, Category = "PredItem")
     const UPredItem* Item = nullptr;
 
+    /** Unique within the owning inventory, handed out by the inventory when the item is equipped. */
     UPROPERTY(BlueprintReadOnly, Category = "PredItem")
-    FGuid UniqueItemID;
+    int32 UniqueItemID = INDEX_NONE;
 
     UPROPERTY(BlueprintReadOnly, Category = "PredItem")
-    TArray<FActiveGameplayEffectHandle> ActiveEffects;
+    FGameplayAbilitySpecHandle ActiveAbility;
 
+    /** How many copies of Item this struct represents. Only ever above 1 for stackable items. */
     UPROPERTY(BlueprintReadOnly, Category = "PredItem")
-    TArray<FPredActiveUniqueEffect> ActiveUniqueEffects;
+    uint8 StackCount = 0;
 
-    UPROPERTY(BlueprintReadOnly, Category = "PredItem")
-    FGameplayAbilitySpecHandle ActiveAbility;
+    /**
+     * Effect handles are only meaningful on the server, so they are neither UPROPERTYs nor replicated.
+     * Most items apply one or two effects, which fit in the inline storage without a heap allocation.
+     */
+    TArray<FActiveGameplayEffectHandle, TInlineAllocator<2>> ActiveEffects;
+    TArray<FPredActiveUniqueEffect, TInlineAllocator<1>> ActiveUniqueEffects;
 
-    bool IsValid() { return Item != nullptr; }
+    /** Periodic modifiers registered with the item service's passive ticker. Server only, like the effect handles. */
+    TArray<FPredItemPassiveHandle> ActivePassives;
+
+    bool IsValid() const { return Item != nullptr; }
+    int32 GetStackCount() const { return IsValid() ? FMath::Max<int32>(StackCount, 1) : 0; }
 
 };
 
@@ -87,11 +121,62 @@ struct FPredInventorySlot
     UPROPERTY(BlueprintReadOnly, Category = "PredItem")
     FPredActiveItem SlottedItem;
 
-    bool IsEmpty() { return !SlottedItem.IsValid(); }
-    UTexture2D* GetItemIcon() { return IsEmpty() ? nullptr : SlottedItem.Item->Icon; }
+    bool IsEmpty() const { return !SlottedItem.IsValid(); }
+    UTexture2D* GetItemIcon() const { return IsEmpty() ? nullptr : SlottedItem.Item->Icon; }
+};
+
+/**
+ * What everyone but the owner gets to see of an inventory: the item index and stack count of each slot, nothing else.
+ * Packs into a handful of bytes, see NetSerialize.
+ */
+USTRUCT()
+struct FPredInventorySummary
+{
+    GENERATED_BODY()
+
+    /** Item index held by each slot, INDEX_NONE for empty slots (and items the economy doesn't know) */
+    TArray<int16> SlotItems;
+
+    /** Stack count of each slot, 0 for empty slots */
+    TArray<uint8> SlotCounts;
+
+    int32 NumSlots() const { return SlotItems.Num(); }
+
+    bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+    bool operator==(const FPredInventorySummary& Other) const { return SlotItems == Other.SlotItems && SlotCounts == Other.SlotCounts; }
+};
+
+template<>
+struct TStructOpsTypeTraits<FPredInventorySummary> : public TStructOpsTypeTraitsBase2<FPredInventorySummary>
+{
+    enum
+    {
+        WithNetSerializer = true,
+        WithIdenticalViaEquality = true
+    };
+};
+
+/**
+ * One player's inventory summary, as sent to players looking at the scoreboard.
+ */
+USTRUCT()
+struct FPredScoreboardEntry
+{
+    GENERATED_BODY()
+
+    /** Player states are always relevant, unlike the pawns holding the inventories */
+    UPROPERTY()
+    const APlayerState* Player = nullptr;
+
+    UPROPERTY()
+    FPredInventorySummary Summary;
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnItemSlotUpdatedSignature, const FPredInventorySlot&, ItemSlot);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnItemAffordabilityChangedSignature, const TArray<UPredItem*>&, Items, bool, bAffordable);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnInventoryRestoredSignature);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnScoreboardUpdatedSignature);
 DECLARE_DELEGATE_OneParam(FUseInventorySlot, int32);
 
 
@@ -104,6 +189,10 @@ public:
 
 	UPredInventoryComponent();
 
+    // UActorComponent
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+    // ~UActorComponent
+
     /**
      * Fired whenever any change is made to the internal inventory.
      * Useful for refreshing UI.
@@ -111,6 +200,57 @@ public:
     UPROPERTY(BlueprintAssignable, Category = "PredInventoryComponent")
     FOnItemSlotUpdatedSignature OnItemSlotUpdated;
 
+    /**
+     * Fired with the items that just became affordable (or stopped being affordable), either because our gold changed or because
+     * our inventory changed their price. Only items whose affordability actually flipped are passed along, the shop doesn't need to poll.
+     */
+    UPROPERTY(BlueprintAssignable, Category = "PredInventoryComponent")
+    FOnItemAffordabilityChangedSignature OnItemAffordabilityChanged;
+
+    /**
+     * Fired on the server once a snapshot replaced the whole inventory (see RestoreInventorySnapshot), in place of a slot update per slot.
+     */
+    UPROPERTY(BlueprintAssignable, Category = "PredInventoryComponent")
+    FOnInventoryRestoredSignature OnInventoryRestored;
+
+    /**
+     * Fired on the owning client whenever the server sends newer scoreboard summaries, see SetScoreboardOpen.
+     */
+    UPROPERTY(BlueprintAssignable, Category = "PredInventoryComponent")
+    FOnScoreboardUpdatedSignature OnScoreboardUpdated;
+
+    /**
+     * Tells the server whether our scoreboard is open. While it is, the server sends us every player's items, whether or not we can
+     * see them, at the item service's ScoreboardRefreshInterval. Only called by the owning client.
+     */
+    UFUNCTION(BlueprintCallable, Category = "PredInventoryComponent")
+    void SetScoreboardOpen(bool bOpen);
+
+    /**
+     * Places the items last sent to us for @Player's scoreboard row in @OutItems, one per slot (nullptr for empty slots), and their
+     * stack counts in @OutStackCounts. Returns false if nothing was sent for @Player yet.
+     */
+    UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
+    bool GetScoreboardItems(const APlayerState* Player, TArray<UPredItem*>& OutItems, TArray<int32>& OutStackCounts) const;
+
+    /**
+     * What everyone but our owner sees of us, as of the last push. Server side it is also what the scoreboard sends.
+     */
+    const FPredInventorySummary& GetPublicSummary() const { return PublicSummary; }
+
+    /** Item service revision (see APredItemService::NextSummaryRevision) PublicSummary last changed at. Server only. */
+    uint32 GetPublicSummaryRevision() const { return PublicSummaryRevision; }
+
+    /** Returns the player state of whoever owns us, nullptr if no player does */
+    APlayerState* GetOwnerPlayerState() const;
+
+    /** Returns what identifies the player owning us across reconnects, empty if no player does */
+    FString GetOwnerPlayerKey() const;
+
+    /** Hands the owning client the scoreboard summaries that changed since the last ones it got */
+    UFUNCTION(Client, Reliable)
+    void Client_ReceiveScoreboardSummaries(const TArray<FPredScoreboardEntry>& Entries);
+
     /**
      * Tries to buy an item at the first slot available. Returns true if successful.
      * Returning true in this state does not mean that the item was actually equipped, we are still pending server approval.
@@ -128,25 +268,27 @@ public:
     bool TrySellItem(int32 SlotToSellAt);
 
     /**
-     * Equips an item, finding the first unused item slot. Cannot be ran by clients.
+     * Equips @Count copies of an item. Stackable items top up existing stacks first, then the first unused item slots are taken.
+     * Cannot be ran by clients.
      */
     UFUNCTION(BlueprintCallable, Category = "PredInventoryComponent")
     void EquipItem(UPredItem* Item, int32 Count);
 
     /**
-     * Equips an item at the specified slot. Cannot be ran by clients.
+     * Equips @Count copies of an item at the specified slot. If the slot already holds a stack of the item, the stack grows (up to the item's max stack size).
+     * Cannot be ran by clients.
      */
     UFUNCTION()
     void EquipItemAtSlot(UPredItem* Item, int32 Count, int32 Slot);
 
     /**
-     * Removes the first item found that matches @Item. Cannot be ran by clients.
+     * Removes @Count copies of @Item, starting with the first slot found that matches @Item. Cannot be ran by clients.
      */
     UFUNCTION(BlueprintCallable, Category = "PredInventoryComponent")
     void RemoveItem(const UPredItem* Item, int32 Count);
 
     /**
-     * Removes an item at the specified slot. Cannot be ran by clients.
+     * Removes @Count copies of the item at the specified slot, emptying the slot once its stack is gone. Cannot be ran by clients.
      */
     UFUNCTION()
     void RemoveItemAtSlot(int32 Count, int32 Slot);
@@ -165,16 +307,70 @@ public:
 
     /**
      * Returns all inventory slots.
+     * Copies every slot (and the effect handles they hold), native code should prefer GetInventorySlotsView.
      */
     UFUNCTION(BlueprintPure, Category = "PredInventory")
     void GetAllInventorySlots(TArray<FPredInventorySlot>& Slots);
 
+    /**
+     * Read-only view of all inventory slots. Does not copy, but is invalidated by any change to the inventory.
+     */
+    TArrayView<const FPredInventorySlot> GetInventorySlotsView() const { return Inventory; }
+
+    /**
+     * Returns the slot at @SlotIndex without copying it, nullptr if the index is invalid (out of bounds).
+     */
+    const FPredInventorySlot* GetInventorySlotPtr(int32 SlotIndex) const { return Inventory.IsValidIndex(SlotIndex) ? &Inventory[SlotIndex] : nullptr; }
+
+    /**
+     * Iterator over the inventory slots, for when a range based for doesn't fit.
+     */
+    TArray<FPredInventorySlot>::TConstIterator CreateInventorySlotIterator() const { return Inventory.CreateConstIterator(); }
+
+    /**
+     * Read-only view of the item index (UPredItem::ItemIndex) held by each slot, INDEX_NONE for empty slots.
+     * Lines up with the inventory slots, cheaper to walk than the slots themselves when only the items matter.
+     */
+    TArrayView<const int32> GetOwnedItemIndices() const { return TArrayView<const int32>(EconomyInventory.SlotItems.data(), EconomyInventory.NumSlots()); }
+
+    /** Read-only view of the stack count of each slot, 0 for empty slots. Lines up with GetOwnedItemIndices. */
+    TArrayView<const uint8> GetSlotStackCounts() const { return TArrayView<const uint8>(EconomyInventory.SlotCounts.data(), EconomyInventory.NumSlots()); }
+
     /**
      * Returns the cost of the item @Item.
      */
     UFUNCTION(BlueprintPure, Category = "PredInventory")
     float CalculateItemCost(UPredItem* Item);
 
+    /**
+     * Returns the cost of @Item for this inventory from the personalized price cache, falling back to calculating it.
+     * The cache is only rebuilt when our inventory changes.
+     */
+    float GetPersonalizedItemCost(const UPredItem* Item);
+
+    /**
+     * Places whether we can afford @Item in @bOutAffordable, using the gold and personalized prices we track.
+     * Returns false if we aren't tracking affordability for @Item (no gold, or the item isn't indexed), in which case the caller has to work it out.
+     */
+    bool GetCachedAffordability(const UPredItem* Item, bool& bOutAffordable);
+
+    /**
+     * Returns the gold we last saw on our owner. Updated whenever the gold attribute changes.
+     */
+    UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
+    float GetCachedGold() const { return CachedGold; }
+
+    /**
+     * How many of each item we own, indexed by UPredItem::ItemIndex. Plain data, copy it to hand it to other threads.
+     */
+    TArrayView<const uint16> GetOwnedItemCounts() const { return TArrayView<const uint16>(EconomyInventory.OwnedItemCounts.data(), EconomyInventory.OwnedItemCounts.size()); }
+
+    /**
+     * Replaces our personalized prices with @NewPrices, built elsewhere against our owned item counts (eg. by the item service's batched refresh),
+     * broadcasting every item whose affordability flipped.
+     */
+    void ApplyPersonalizedPrices(FPredPersonalizedPrices&& NewPrices);
+
     /**
      * Returns the selling price of @Item. This is usually the price of the item, reduced by some modifier.
      */
@@ -200,7 +396,13 @@ public:
     float GetItemPriceAtInventorySlot(int32 SlotID);
 
     /**
-     * Returns the count of an item.
+     * Returns how many bytes this inventory is using: the component itself, the slots and everything they allocated.
+     */
+    UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
+    int32 GetInventoryMemoryBytes() const;
+
+    /**
+     * Returns the count of an item. Does not scan the inventory, counts are maintained as items are equipped and removed.
      */
     UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
     int32 GetItemCount(const UPredItem* Item);
@@ -211,28 +413,110 @@ public:
     UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
     bool HasItem(const UPredItem* Item);
 
+    /**
+     * Returns true if any unique identifier used by @Item is already applied by something in our inventory,
+     * meaning some of @Item's modifiers or effects would be suppressed if we equipped it.
+     */
+    UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
+    bool HasUniqueIdentifierConflict(const UPredItem* Item) const { return Item && Item->UniqueIdentifierMask.Intersects(EconomyInventory.AppliedUniqueIdentifiers); }
+
+    /**
+     * Fills @OutPreview with this inventory and its owner's current base attributes, for evaluating purchases without applying anything.
+     * Returns false if the item catalog isn't loaded yet or our owner has no ASC.
+     */
+    bool BuildStatPreview(FPredStatPreview& OutPreview) const;
+
+    /**
+     * Returns what @Attribute would be after buying @Item, accounting for the required items the purchase uses up and unique identifier suppression.
+     * Only item attribute modifiers are simulated, see FPredStatPreview. Returns the current value if no item modifies @Attribute.
+     */
+    UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
+    float PreviewAttributeAfterPurchase(UPredItem* Item, FGameplayAttribute Attribute) const;
+
     UFUNCTION()
     void TryUseInventorySlot(int32 Idx);
 
     UFUNCTION()
     void SetupInventoryInput(UInputComponent* InputComponent);
 
+    /**
+     * Gives the items in @Loadout to a stat-only inventory, replacing any previous loadout.
+     * All of the loadout's stats are applied as a single effect. Cannot be ran by clients.
+     */
+    UFUNCTION(BlueprintCallable, Category = "PredInventoryComponent")
+    void ApplyLoadout(UPredItemLoadout* Loadout);
+
+    /**
+     * Removes the current loadout (and its stats) from a stat-only inventory. Cannot be ran by clients.
+     */
+    UFUNCTION(BlueprintCallable, Category = "PredInventoryComponent")
+    void ClearLoadout();
+
+    UFUNCTION(BlueprintPure, Category = "PredInventoryComponent")
+    bool IsStatOnly() const { return InventoryMode == EPredInventoryMode::StatOnly; }
+
+    /**
+     * Records what every slot holds and our gold to the item service's inventory recording, closing our part of it. Server only.
+     */
+    void RecordFinalInventoryState();
+
+    /**
+     * Takes the effects of every slot holding an item flagged in @ChangedItemBits (one bit per item index) off our owner, ahead of a
+     * LiveOps override changing those items' magnitudes. Nothing else is touched. Returns true if anything was taken off. Server only.
+     */
+    bool RemoveEffectsOfItems(const TBitArray<>& ChangedItemBits);
+
+    /**
+     * Puts back what RemoveEffectsOfItems took off, at the items' new magnitudes. Also re-applies our loadout if it holds a changed item.
+     * Server only.
+     */
+    void ReapplyEffectsOfItems(const TBitArray<>& ChangedItemBits);
+
+    /**
+     * Places what every slot holds, our gold and which slot provides each unique identifier in @OutSnapshot.
+     * Returns false for stat-only inventories and before the item catalog is loaded.
+     */
+    bool MakeInventorySnapshot(FPredInventorySnapshot& OutSnapshot) const;
+
+    /**
+     * Replaces the whole inventory and our gold with @Snapshot in one step: every slot is filled before anything is applied, unique
+     * identifiers go back to the slots that provided them, and additive modifiers are applied once per attribute for all items together.
+     * Fires OnInventoryRestored rather than a slot update per slot. Returns false, changing nothing, if @Snapshot doesn't fit this
+     * inventory. Server only.
+     */
+    bool RestoreInventorySnapshot(const FPredInventorySnapshot& Snapshot);
+
+    /**
+     * Restores the snapshot the item service saved when our player disconnected, if there is one. Tried the tick after we begin play,
+     * which is once a freshly spawned pawn has been possessed. Call it again if our pawn is possessed later than that. Server only.
+     */
+    UFUNCTION(BlueprintCallable, Category = "PredInventoryComponent")
+    bool RestoreSavedInventory();
+
 protected:
 
     // UActorComponent
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     // ~UActorComponent interface
 
+    // UObject
+    virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+    // ~UObject
+
     UFUNCTION()
     void SetupInventorySlots();
 
     UFUNCTION(Server, Reliable, WithValidation)
     void Server_TryBuyItem(UPredItem* Item);
 
-    // TODO: use FGuids rather than int32 slots for this to allow for item moving in inventory
+    // TODO: use UniqueItemIDs rather than int32 slots for this to allow for item moving in inventory
     UFUNCTION(Server, Reliable, WithValidation)
     void Server_TrySellItem(int32 SlotToSellAt);
 
+    UFUNCTION(Server, Reliable, WithValidation)
+    void Server_SetScoreboardOpen(bool bOpen);
+
     /**
      * Finds a slot that contains the designated item, also placing the found slot in @OutItemSlot. Returns -1 if no slot was found.
      */
@@ -245,6 +529,52 @@ protected:
     UFUNCTION()
     void RemoveItemEffectsFromOwner(FPredActiveItem& Item);
 
+    /**
+     * Grants @Item's active ability to the owner, or shares the spec of another item that already granted it. Server only.
+     */
+    void GrantItemAbility(FPredActiveItem& Item);
+
+    /**
+     * Takes away @Item's active ability. If another item shares it, the ability stays and that item becomes its provider. Server only.
+     */
+    void RevokeItemAbility(FPredActiveItem& Item);
+
+    /**
+     * Tries to activate the ability of the item at @Slot, predicted locally on clients. Returns false if it couldn't be activated.
+     */
+    bool TryActivateInventorySlot(int32 Slot);
+
+    /**
+     * Records an economy event for our owner in the item service's journal, if it is recording. Server only.
+     */
+    void RecordEconomyEvent(EPredEconomyEventType Type, const UPredItem* Item, int32 Count, float GoldDelta);
+
+    /**
+     * Records an inventory operation to the item service's inventory recording, if it is recording. Server only.
+     * @Value depends on @Type, see EPredInventoryOpType.
+     */
+    void RecordInventoryOp(EPredInventoryOpType Type, const UPredItem* Item, int32 Slot, int32 Count, bool bSucceeded, float Value);
+
+    /**
+     * How many inventory operations are running. Only operations started at depth 0 are recorded, anything they do along the way is part of them.
+     */
+    int32 InventoryOpDepth = 0;
+
+    /**
+     * Returns our owner's ASC, cached after the first lookup so key presses don't have to search for it.
+     */
+    UAbilitySystemComponent* GetOwnerAbilitySystem();
+
+    /**
+     * Changes the stack count of the item at @Slot, re-applying its effects once at the new count.
+     */
+    void SetStackCountAtSlot(int32 Slot, int32 NewStackCount);
+
+    /**
+     * Finds the first slot holding @Item with room left on its stack, placing the index in @OutSlot.
+     */
+    bool FindStackWithRoom(const UPredItem* Item, int32& OutSlot) const;
+
     /**
      * Returns true if we have room for the item in our inventory
      */
@@ -258,7 +588,25 @@ protected:
     bool FindEmptySlot(int32& OutEmptySlot);
 
     /**
-     * Recursively removes items after being sold.
+     * Plans buying @Item into PurchasePlan: its cost, the owned parts it uses up and the slots they come out of.
+     * Returns the catalog it was planned against, or nullptr for items the economy doesn't know (not indexed yet).
+     */
+    const FPredItemCatalog* PlanPurchase(const UPredItem* Item);
+
+    /**
+     * Takes the slots in PurchasePlan out of the inventory. Server only. The purchase's Buy event covers the parts used up,
+     * they aren't journaled on their own.
+     */
+    void ConsumePurchasePlan();
+
+    /**
+     * RemoveItemAtSlot without regenerating effects, so several slots can be cleared before regenerating once.
+     * Returns true if the slot was emptied, in which case the caller has to call RegenerateInventoryEffectsPostItemRemoval.
+     */
+    bool TakeItemsFromSlot(int32 Count, int32 Slot);
+
+    /**
+     * Recursively removes items after being sold, for items the economy doesn't know (see PlanPurchase).
      * Handles cases where we have partial parts of children after buying an item (at a discount, because of having children).
      */
     UFUNCTION()
@@ -270,14 +618,27 @@ protected:
     void ClearInventoryPostPurchaseHelper(const UPredItem* ChildItem);
 
     /**
-     * Determines if an item is providing the specified unique effect for
+     * Determines if an item is providing the unique identifier with the bit @UniqueBit (see FPredItemCatalog::UniqueIdentifiers).
      */
-    bool IsProviderOfUniqueEffect(const FPredActiveItem& Item, FGameplayTag UniqueEffectIdentifier);
+    bool IsProviderOfUniqueEffect(const FPredActiveItem& Item, int32 UniqueBit) const
+    {
+        return EconomyInventory.IsProviderOfUniqueIdentifier(Item.UniqueItemID, UniqueBit);
+    }
 
     /**
-     * Returns true if this effect is currently applied to the owner.
+     * Returns true if the unique identifier with the bit @UniqueBit is currently applied to the owner.
      */
-    bool IsUniqueIdentifierApplied(const FGameplayTag& EffectIdentifier);
+    bool IsUniqueIdentifierApplied(int32 UniqueBit) const { return EconomyInventory.IsUniqueIdentifierApplied(UniqueBit); }
+
+    /**
+     * Marks the unique identifier with the bit @UniqueBit as applied, provided by @Item.
+     */
+    void ClaimUniqueIdentifier(const FPredActiveItem& Item, int32 UniqueBit);
+
+    /**
+     * Marks the unique identifier with the bit @UniqueBit as no longer applied.
+     */
+    void ReleaseUniqueIdentifier(int32 UniqueBit);
 
     /**
      * Iterates through the inventory re-applying effects if they should be applied. 
@@ -286,9 +647,41 @@ protected:
      */
     void RegenerateInventoryEffectsPostItemRemoval();
 
+    /**
+     * Full for players, StatOnly for actors that only need item stats. Can't be changed once play has begun.
+     */
+    UPROPERTY(EditDefaultsOnly, Category = "Inventory")
+    EPredInventoryMode InventoryMode = EPredInventoryMode::Full;
+
+    /** Loadout currently given to a stat-only inventory */
+    UPROPERTY()
+    const UPredItemLoadout* ActiveLoadout = nullptr;
+
+    /** The aggregated additive effect applied for ActiveLoadout */
+    FActiveGameplayEffectHandle LoadoutEffectHandle;
+
+    /** The aggregated multiplicative effect applied for ActiveLoadout, invalid if none of its items multiply anything */
+    FActiveGameplayEffectHandle LoadoutMultiplicativeEffectHandle;
+
     int32 NumInventorySlots = 6;
     int32 NumActivateableSlots = 6;
 
+    /**
+     * Seconds a slot key press is held on to when its ability can't be activated yet (not replicated yet, still on cooldown, ...).
+     * The ability is activated on the first frame it can be within that window.
+     */
+    UPROPERTY(EditDefaultsOnly, Category = "PredInventoryComponent")
+    float InputBufferWindow = 0.2f;
+
+    /** Slot of the buffered key press, INDEX_NONE if there is none */
+    int32 BufferedInputSlot = INDEX_NONE;
+
+    /** World time at which the buffered key press is dropped */
+    float BufferedInputExpireTime = 0.0f;
+
+    /** See GetOwnerAbilitySystem */
+    TWeakObjectPtr<UAbilitySystemComponent> CachedOwnerASC;
+
     /**
      * How much gold should we start with? Note that this should be handled elsewhere.
      * Will be ran every time the character respawns. GameMode?
@@ -300,20 +693,142 @@ protected:
      */
     float SellModifier = .75f;
 
+    /**
+     * Only replicated to our owner, ability handles and unique item IDs are of no use to anyone else.
+     * Everyone else gets PublicSummary and mirrors it in here, so slot queries and UI work the same for them.
+     */
     UPROPERTY(EditAnywhere, ReplicatedUsing = OnRep_Inventory, BlueprintReadOnly, Category = "Inventory")
     TArray<FPredInventorySlot> Inventory;
 
     /**
-     * Tracks unique effects to the provider of said effects.
+     * Item and stack count of each slot, replicated to everyone but our owner. Only goes to connections our owner is relevant to,
+     * players out of sight are covered by the scoreboard (see SetScoreboardOpen).
      */
-    TMap<FGameplayTag, FPredActiveItem> UniqueProviders;
+    UPROPERTY(ReplicatedUsing = OnRep_PublicSummary)
+    FPredInventorySummary PublicSummary;
 
     /**
-     * Tracks granted abilities to the item that is providing the ability.
+     * Most often, in seconds, PublicSummary is brought up to date. Everything that changes in between goes out together in the next
+     * push, so other players see a purchase and the parts it used up as one change. Our owner always gets Inventory right away.
      */
-    TMap<TSubclassOf<UBaseGameplayAbility>, FPredActiveItem> AbilityProvider;
+    UPROPERTY(EditDefaultsOnly, Category = "PredInventoryComponent", meta = (ClampMin = 0.0))
+    float PublicSummaryInterval = 0.5f;
+
+    /** See GetPublicSummaryRevision */
+    uint32 PublicSummaryRevision = 0;
+
+    /** World time PublicSummary was last pushed at */
+    float LastPublicSummaryTime = -MAX_flt;
+
+    /** Pending push of PublicSummary, invalid while nothing changed since the last one */
+    FTimerHandle PublicSummaryTimer;
+
+    /** Schedules a push of PublicSummary, no sooner than PublicSummaryInterval after the last one. Server only. */
+    void MarkPublicSummaryDirty();
+
+    /** Brings PublicSummary up to date with EconomyInventory */
+    void PushPublicSummary();
+
+    /** Mirrors PublicSummary into Inventory on clients that don't own us, broadcasting the slots that changed */
+    void ApplyPublicSummary();
+
+    /** Pending record to the item service's inventory timeline, invalid while nothing changed since the last one */
+    FTimerHandle TimelineRecordTimer;
+
+    /**
+     * Schedules a record to the inventory timeline for next tick. A purchase changes our gold and slots one after the other,
+     * waiting for the tick to be over records them as a single entry. Server only.
+     */
+    void MarkTimelineDirty();
+
+    void RecordTimeline();
+
+    /** Scoreboard summaries sent to us while our scoreboard was open, by player. Owning client only. */
+    TMap<TWeakObjectPtr<const APlayerState>, FPredInventorySummary> ScoreboardSummaries;
+
+    /**
+     * Plain data copy of Inventory for the item economy: item index and stack count of each slot, how many of each item we own
+     * and which slot provides each unique identifier. Kept in sync with Inventory on both server and client (unique identifiers
+     * are only tracked on the server), so counts never need a scan and room checks never touch the slots.
+     * Its ownership bits make HasItem a single bit test.
+     */
+    FPredEconomyInventory EconomyInventory;
+
+    /** Last purchase planned by PlanPurchase, kept around so buying doesn't allocate */
+    FPredPurchasePlan PurchasePlan;
+
+    /**
+     * Adjusts the ownership count (and bit) of @Item by @Delta, for items we own without a slot (loadouts).
+     */
+    void TrackItemOwnership(const UPredItem* Item, int32 Delta);
+
+    /**
+     * Copies @Slot of Inventory into EconomyInventory, updating the ownership counts of whatever it held and now holds.
+     */
+    void SyncEconomySlot(int32 Slot);
+
+    /**
+     * Rebuilds the slots and counts of EconomyInventory from Inventory.
+     * Used when the whole inventory changes at once (replication).
+     */
+    void RebuildItemOwnership();
+
+    /**
+     * Tracks granted abilities to the item (FPredActiveItem::UniqueItemID) that is providing the ability.
+     */
+    TMap<TSubclassOf<UBaseGameplayAbility>, int32> AbilityProvider;
+
+    /** Last FPredActiveItem::UniqueItemID handed out */
+    int32 LastUniqueItemID = 0;
+
+    /** While set, ApplyItemEffectsToOwner sums additive modifiers up here by attribute instead of applying them (see RestoreInventorySnapshot) */
+    TMap<FGameplayAttribute, float>* BatchedAdditiveMods = nullptr;
+
+    /** Packs our snapshot into the item service if our player is disconnecting, for RestoreSavedInventory to pick up when they come back */
+    void SaveInventoryIfDisconnecting();
+
+    /** Every item's price for this inventory and whether CachedGold covers it */
+    FPredPersonalizedPrices PersonalizedPrices;
+
+    /** Gold attribute value as of the last change we were told about */
+    float CachedGold = 0.0f;
+
+    /** True once we're bound to gold changes, affordability is only cached while we are */
+    bool bTrackingGold = false;
+
+    /** Set whenever our inventory (or the item catalog) changes, personalized prices are rebuilt on the next tick or query */
+    bool bPersonalizedPricesDirty = true;
+    bool bPersonalizedPriceRefreshPending = false;
+
+    FDelegateHandle GoldChangedDelegateHandle;
+
+    /** Binds to the owner's gold attribute changes and starts tracking affordability */
+    void StartTrackingGold();
+
+    void OnGoldChanged(const FOnAttributeChangeData& ChangeData);
+
+    UFUNCTION()
+    void OnCatalogLoaded();
+
+    /** Flags the personalized prices for a rebuild, batching everything that changes this frame into a single rebuild next tick */
+    void MarkPersonalizedPricesDirty();
+
+    /** Rebuilds personalized prices and affordability if they are dirty, broadcasting any affordability flips */
+    void RefreshPersonalizedPrices();
+
+    /** Flips the affordability bit of every item in PersonalizedPrices.SortedPrices[@StartIdx, @EndIdx) to @bAffordable and broadcasts them */
+    void BroadcastAffordabilityRange(int32 StartIdx, int32 EndIdx, bool bAffordable);
+
+    /** Bytes last reported to STAT_PredInventoryMemory by this inventory */
+    int32 ReportedMemoryBytes = 0;
+
+    /** Brings STAT_PredInventoryMemory up to date with this inventory's current footprint */
+    void UpdateMemoryStats();
+
+    UFUNCTION()
+    virtual void OnRep_Inventory(const TArray<FPredInventorySlot>& OldInventory);
 
     UFUNCTION()
-    virtual void OnRep_Inventory();
+    virtual void OnRep_PublicSummary();
 
 };
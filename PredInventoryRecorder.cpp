@@ -0,0 +1,424 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredInventoryRecorder.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Engine/World.h"
+#include "PredItemCatalog.h"
+#include "PredItemLibrary.h"
+#include "PredItemService.h"
+#include "PredLoggingLibrary.h"
+
+FPredInventoryRecorder::~FPredInventoryRecorder()
+{
+    Close();
+}
+
+bool FPredInventoryRecorder::Open(const FString& InFilename)
+{
+    check(!FileHandle.IsValid());
+
+    Filename = InFilename;
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+    FileHandle.Reset(PlatformFile.OpenWrite(*Filename));
+    if (!FileHandle.IsValid())
+    {
+        TRACESTATIC(PredItemLog, Warning, "Could not open inventory recording %s, inventory operations will not be recorded.", *Filename);
+        return false;
+    }
+
+    Header = FPredInventoryRecordingHeader();
+    Header.StartTicks = FDateTime::UtcNow().GetTicks();
+    WriteHeader();
+
+    BufferedOps.Reserve(OpsPerWrite);
+    NumRecordedOps = 0;
+    return true;
+}
+
+void FPredInventoryRecorder::Close()
+{
+    if (!FileHandle.IsValid()) { return; }
+
+    WriteBufferedOps();
+    FileHandle.Reset();
+}
+
+void FPredInventoryRecorder::SetCatalog(const FPredItemCatalog& Catalog)
+{
+    if (!FileHandle.IsValid()) { return; }
+
+    Header.NumItems = Catalog.Num();
+    Header.CatalogChecksum = ComputeCatalogChecksum(Catalog);
+    WriteHeader();
+}
+
+void FPredInventoryRecorder::RecordCatalogChange(const FPredItemCatalog& OldCatalog, const FPredItemCatalog& NewCatalog, uint32 TimeMs)
+{
+    if (!FileHandle.IsValid()) { return; }
+
+    check(OldCatalog.Num() == NewCatalog.Num());
+
+    FPredInventoryOp Op;
+    Op.TimeMs = TimeMs;
+    Op.Type = EPredInventoryOpType::ItemPrice;
+    Op.bSucceeded = 1;
+    for (int32 ItemIndex = 0; ItemIndex < NewCatalog.Num(); ItemIndex++)
+    {
+        const float NewPrice = NewCatalog.Economy.GetPrices()[ItemIndex];
+        if (NewPrice != OldCatalog.Economy.GetPrices()[ItemIndex])
+        {
+            Op.ItemIndex = (int16)ItemIndex;
+            Op.Value = NewPrice;
+            Record(Op);
+        }
+    }
+
+    Op.Type = EPredInventoryOpType::CatalogChange;
+    Op.ItemIndex = INDEX_NONE;
+    Op.Value = 0.0f;
+    Op.OwnerID = ComputeCatalogChecksum(NewCatalog);
+    Record(Op);
+}
+
+void FPredInventoryRecorder::Record(const FPredInventoryOp& Op)
+{
+    if (!FileHandle.IsValid()) { return; }
+
+    BufferedOps.Add(Op);
+    NumRecordedOps++;
+    if (BufferedOps.Num() >= OpsPerWrite)
+    {
+        WriteBufferedOps();
+    }
+}
+
+void FPredInventoryRecorder::WriteBufferedOps()
+{
+    if (BufferedOps.Num() > 0 && FileHandle.IsValid())
+    {
+        FileHandle->Write(reinterpret_cast<const uint8*>(BufferedOps.GetData()), BufferedOps.Num() * sizeof(FPredInventoryOp));
+        FileHandle->Flush();
+    }
+    BufferedOps.Reset();
+}
+
+void FPredInventoryRecorder::WriteHeader()
+{
+    FileHandle->Seek(0);
+    FileHandle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+    FileHandle->SeekFromEnd(0);
+}
+
+bool FPredInventoryRecorder::ReadRecordingFile(const FString& InFilename, FPredInventoryRecordingHeader& OutHeader, TArray<FPredInventoryOp>& OutOps)
+{
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *InFilename) || Bytes.Num() < (int32)sizeof(FPredInventoryRecordingHeader))
+    {
+        return false;
+    }
+
+    FMemory::Memcpy(&OutHeader, Bytes.GetData(), sizeof(FPredInventoryRecordingHeader));
+    if (OutHeader.Magic != FPredInventoryRecordingHeader::ExpectedMagic || OutHeader.OpSize != sizeof(FPredInventoryOp))
+    {
+        return false;
+    }
+
+    // A trailing partial operation means the server went down mid-write, drop it.
+    const int32 NumOps = (Bytes.Num() - sizeof(FPredInventoryRecordingHeader)) / sizeof(FPredInventoryOp);
+    OutOps.SetNumUninitialized(NumOps);
+    FMemory::Memcpy(OutOps.GetData(), Bytes.GetData() + sizeof(FPredInventoryRecordingHeader), NumOps * sizeof(FPredInventoryOp));
+    return true;
+}
+
+uint32 FPredInventoryRecorder::ComputeCatalogChecksum(const FPredItemCatalog& Catalog)
+{
+    return ComputeEconomyChecksum(Catalog.Economy);
+}
+
+uint32 FPredInventoryRecorder::ComputeEconomyChecksum(const FPredItemEconomy& Economy)
+{
+    uint32 Checksum = FCrc::MemCrc32(Economy.GetPrices().data(), Economy.GetPrices().size() * sizeof(float));
+    Checksum = FCrc::MemCrc32(Economy.GetRequiredItemOffsets().data(), Economy.GetRequiredItemOffsets().size() * sizeof(int32), Checksum);
+    Checksum = FCrc::MemCrc32(Economy.GetRequiredItemIndices().data(), Economy.GetRequiredItemIndices().size() * sizeof(int32), Checksum);
+    return FCrc::MemCrc32(Economy.GetMaxStackSizes().data(), Economy.GetMaxStackSizes().size() * sizeof(uint8), Checksum);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Replay
+//////////////////////////////////////////////////////////////////////////
+
+FPredInventoryReplay::FPredInventoryReplay(const FPredItemCatalog& InCatalog)
+    : Catalog(InCatalog)
+{
+}
+
+bool FPredInventoryReplay::ReplayCatalogOp(const FPredInventoryOp& Op, FPredInventoryReplayReport& Report)
+{
+    if (Op.Type == EPredInventoryOpType::ItemPrice)
+    {
+        if (!Economy.IsValidItem(Op.ItemIndex)) { return false; }
+
+        PendingPrices[Op.ItemIndex] = Op.Value;
+        return true;
+    }
+
+    Economy.SetPrices(PendingPrices);
+    Report.NumCatalogChanges++;
+    return FPredInventoryRecorder::ComputeEconomyChecksum(Economy) == Op.OwnerID;
+}
+
+void FPredInventoryReplay::Run(TArrayView<const FPredInventoryOp> Ops, int32 NumIterations, FPredInventoryReplayReport& OutReport)
+{
+    OutReport = FPredInventoryReplayReport();
+    NumIterations = FMath::Max(NumIterations, 1);
+
+    // Resolve each operation's inventory up front, so the timed part is only the operations themselves.
+    TMap<uint32, int32> InventoryByOwner;
+    TArray<int32> OpInventories;
+    TBitArray<> HasBegun;
+    OpInventories.SetNumUninitialized(Ops.Num());
+    for (int32 OpIdx = 0; OpIdx < Ops.Num(); OpIdx++)
+    {
+        if (IsCatalogInventoryOp(Ops[OpIdx].Type))
+        {
+            OpInventories[OpIdx] = INDEX_NONE;
+            continue;
+        }
+
+        const int32* ExistingInventory = InventoryByOwner.Find(Ops[OpIdx].OwnerID);
+        const int32 InventoryIdx = ExistingInventory ? *ExistingInventory : InventoryByOwner.Add(Ops[OpIdx].OwnerID, InventoryByOwner.Num());
+        if (InventoryIdx >= HasBegun.Num())
+        {
+            HasBegun.Add(false);
+        }
+
+        // Inventories which began before the recording did can't be replayed, we don't know what they held.
+        HasBegun[InventoryIdx] = HasBegun[InventoryIdx] || Ops[OpIdx].Type == EPredInventoryOpType::Begin;
+        OpInventories[OpIdx] = HasBegun[InventoryIdx] ? InventoryIdx : INDEX_NONE;
+        OutReport.NumSkippedOps += HasBegun[InventoryIdx] ? 0 : 1;
+    }
+    OutReport.NumInventories = InventoryByOwner.Num();
+
+    constexpr int32 NumOpTypes = NumPredInventoryOpTypes;
+    TArray<uint32> OpCycles[NumOpTypes];
+    for (TArray<uint32>& Cycles : OpCycles)
+    {
+        Cycles.Reserve(Ops.Num() * NumIterations / NumOpTypes);
+    }
+
+    TArray<FPredEconomyInventory> Inventories;
+    TArray<bool> FinalStateMatches;
+    for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+    {
+        // Only the last run is checked, the earlier ones are there to make the timings steadier.
+        FPredInventoryReplayReport IterationReport;
+        Inventories.Reset();
+        Inventories.SetNum(InventoryByOwner.Num());
+        FinalStateMatches.Init(true, InventoryByOwner.Num());
+        Economy = Catalog.Economy;
+        PendingPrices = Economy.GetPrices();
+
+        const double StartTime = FPlatformTime::Seconds();
+        for (int32 OpIdx = 0; OpIdx < Ops.Num(); OpIdx++)
+        {
+            const FPredInventoryOp& Op = Ops[OpIdx];
+            if (IsCatalogInventoryOp(Op.Type))
+            {
+                IterationReport.NumOpMismatches += ReplayCatalogOp(Op, IterationReport) ? 0 : 1;
+                continue;
+            }
+            if (OpInventories[OpIdx] == INDEX_NONE) { continue; }
+
+            const uint64 StartCycles = FPlatformTime::Cycles64();
+            const bool bMatches = ReplayOp(Op, Inventories[OpInventories[OpIdx]], IterationReport);
+            OpCycles[FMath::Min((int32)Op.Type, NumOpTypes - 1)].Add((uint32)(FPlatformTime::Cycles64() - StartCycles));
+
+            if (!bMatches)
+            {
+                if (Op.Type == EPredInventoryOpType::SlotState)
+                {
+                    FinalStateMatches[OpInventories[OpIdx]] = false;
+                }
+                else
+                {
+                    IterationReport.NumOpMismatches++;
+                }
+            }
+        }
+        OutReport.Seconds += FPlatformTime::Seconds() - StartTime;
+
+        OutReport.NumOpMismatches = IterationReport.NumOpMismatches;
+        OutReport.NumRefusedOutsideCatalog = IterationReport.NumRefusedOutsideCatalog;
+        OutReport.ExternalGold = IterationReport.ExternalGold;
+        OutReport.NumCatalogChanges = IterationReport.NumCatalogChanges;
+        OutReport.NumFinalStateMismatches = 0;
+        for (const bool bFinalStateMatches : FinalStateMatches)
+        {
+            OutReport.NumFinalStateMismatches += bFinalStateMatches ? 0 : 1;
+        }
+    }
+
+    for (int32 TypeIdx = 0; TypeIdx < NumOpTypes; TypeIdx++)
+    {
+        TArray<uint32>& Cycles = OpCycles[TypeIdx];
+        FPredInventoryReplayLatency& Latency = OutReport.Latencies[TypeIdx];
+        Latency.Count = Cycles.Num();
+        OutReport.NumOps += Cycles.Num();
+        if (Cycles.Num() == 0) { continue; }
+
+        Cycles.Sort();
+        auto Percentile = [&Cycles](double Fraction)
+        {
+            const int32 Idx = FMath::Min(Cycles.Num() - 1, (int32)(Cycles.Num() * Fraction));
+            return FPlatformTime::ToMilliseconds64(Cycles[Idx]) * 1000.0;
+        };
+        Latency.P50 = Percentile(0.5);
+        Latency.P90 = Percentile(0.9);
+        Latency.P99 = Percentile(0.99);
+        Latency.Max = FPlatformTime::ToMilliseconds64(Cycles.Last()) * 1000.0;
+    }
+}
+
+bool FPredInventoryReplay::ReplayOp(const FPredInventoryOp& Op, FPredEconomyInventory& Inventory, FPredInventoryReplayReport& Report) const
+{
+    const int32 ItemIndex = Op.ItemIndex;
+    const bool bValidItem = Economy.IsValidItem(ItemIndex);
+
+    switch (Op.Type)
+    {
+    case EPredInventoryOpType::Begin:
+    {
+        Inventory.Init(Op.Count, Economy.Num(), Op.GoldAfter);
+        Inventory.SellModifier = Op.Value;
+        return true;
+    }
+    case EPredInventoryOpType::Buy:
+    {
+        // The server refuses unknown items before they get anywhere.
+        if (!bValidItem) { return !Op.bSucceeded; }
+
+        // The server also refuses purchases away from the shop, which isn't ours to check.
+        float Cost = 0.0f;
+        if (!Op.bSucceeded)
+        {
+            Report.NumRefusedOutsideCatalog += Inventory.CanBuyItem(Economy, ItemIndex, Cost) ? 1 : 0;
+            return FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+        }
+
+        return Inventory.TryBuyItem(Economy, ItemIndex, Cost) && FMath::IsNearlyEqual(Cost, Op.Value, 0.01f) && FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+    }
+    case EPredInventoryOpType::Sell:
+    {
+        const bool bCanSell = Op.Slot >= 0 && Op.Slot < Inventory.NumSlots() && !Inventory.IsSlotEmpty(Op.Slot);
+        if (!bCanSell || !Op.bSucceeded)
+        {
+            return bCanSell == (Op.bSucceeded != 0) && FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+        }
+
+        const int32 SoldItemIndex = Inventory.SlotItems[Op.Slot];
+        int32 SellPrice = 0;
+        Inventory.TrySellItem(Economy, Op.Slot, SellPrice);
+
+        return SoldItemIndex == ItemIndex && FMath::IsNearlyEqual((float)SellPrice, Op.Value, 0.01f) && FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+    }
+    case EPredInventoryOpType::Equip:
+    {
+        if (!bValidItem) { return false; }
+
+        return (Inventory.EquipItem(Economy, ItemIndex, Op.Count) == 0) == (Op.bSucceeded != 0) && FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+    }
+    case EPredInventoryOpType::Remove:
+    {
+        if (!bValidItem) { return false; }
+
+        Inventory.RemoveItem(Economy, ItemIndex, Op.Count);
+        return FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+    }
+    case EPredInventoryOpType::SlotState:
+    {
+        if (Op.Slot < 0 || Op.Slot >= Inventory.NumSlots()) { return false; }
+        return Inventory.SlotItems[Op.Slot] == ItemIndex && (ItemIndex == INDEX_NONE || Inventory.SlotCounts[Op.Slot] == Op.Count);
+    }
+    case EPredInventoryOpType::GoldDelta:
+    {
+        Inventory.Gold += Op.Value;
+        Report.ExternalGold += Op.Value;
+        return FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+    }
+    case EPredInventoryOpType::End:
+    {
+        return FMath::IsNearlyEqual(Inventory.Gold, Op.GoldAfter, 0.01f);
+    }
+    default:
+        return false;
+    }
+}
+
+/**
+ * PredItem.ReplayInventoryOps <File> [NumIterations]
+ * Replays a recording against the world's item catalog as fast as it goes, checks it against the recording and reports throughput and latencies.
+ */
+static void ReplayInventoryOps(const TArray<FString>& Args, UWorld* World)
+{
+    if (Args.Num() < 1)
+    {
+        TRACESTATIC(PredItemLog, Log, "Usage: PredItem.ReplayInventoryOps <File> [NumIterations]");
+        return;
+    }
+
+    APredItemService* ItemService = World ? UPredItemLibrary::GetItemService(World) : nullptr;
+    if (!ItemService || ItemService->GetCatalog().Num() == 0)
+    {
+        TRACESTATIC(PredItemLog, Warning, "Replaying inventory operations needs a world with its items loaded.");
+        return;
+    }
+
+    FPredInventoryRecordingHeader Header;
+    TArray<FPredInventoryOp> Ops;
+    if (!FPredInventoryRecorder::ReadRecordingFile(Args[0], Header, Ops))
+    {
+        TRACESTATIC(PredItemLog, Warning, "%s is not an inventory recording.", *Args[0]);
+        return;
+    }
+
+    // Item indices only mean something against the catalog they were recorded with.
+    const FPredItemCatalog& Catalog = ItemService->GetCatalog();
+    if (Header.NumItems != (uint32)Catalog.Num() || Header.CatalogChecksum != FPredInventoryRecorder::ComputeCatalogChecksum(Catalog))
+    {
+        TRACESTATIC(PredItemLog, Warning, "%s was recorded with a different item catalog (%u items, checksum %08x), can't replay it.", *Args[0], Header.NumItems, Header.CatalogChecksum);
+        return;
+    }
+
+    const int32 NumIterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1;
+
+    FPredInventoryReplayReport Report;
+    FPredInventoryReplay Replay(Catalog);
+    Replay.Run(Ops, NumIterations, Report);
+
+    TRACESTATIC(PredItemLog, Log, "Replayed %s x%d: %lld operations over %d inventories in %.3fms, %.0f ops/s.",
+        *Args[0], NumIterations, Report.NumOps, Report.NumInventories, Report.Seconds * 1000.0, Report.GetOpsPerSecond());
+    TRACESTATIC(PredItemLog, Log, "%-10s %10s %10s %10s %10s %10s", TEXT("Op"), TEXT("Count"), TEXT("p50 us"), TEXT("p90 us"), TEXT("p99 us"), TEXT("Max us"));
+
+    static const TCHAR* OpNames[] = { TEXT("Begin"), TEXT("Buy"), TEXT("Sell"), TEXT("Equip"), TEXT("Remove"), TEXT("SlotState"), TEXT("End"), TEXT("ItemPrice"), TEXT("CatalogChange"), TEXT("GoldDelta") };
+    static_assert(UE_ARRAY_COUNT(OpNames) == NumPredInventoryOpTypes, "Name every EPredInventoryOpType");
+    for (int32 TypeIdx = 0; TypeIdx < UE_ARRAY_COUNT(OpNames); TypeIdx++)
+    {
+        const FPredInventoryReplayLatency& Latency = Report.Latencies[TypeIdx];
+        if (Latency.Count == 0) { continue; }
+        TRACESTATIC(PredItemLog, Log, "%-10s %10d %10.2f %10.2f %10.2f %10.2f", OpNames[TypeIdx], Latency.Count, Latency.P50, Latency.P90, Latency.P99, Latency.Max);
+    }
+
+    const bool bMatches = Report.NumOpMismatches == 0 && Report.NumFinalStateMismatches == 0;
+    TRACESTATIC(PredItemLog, Log, "%s: %lld operations and %d final inventories disagree with the recording. %lld purchases refused outside the catalog, %.0f gold earned between operations, %lld operations skipped, %d catalog changes followed.",
+        bMatches ? TEXT("Replay matches") : TEXT("Replay DIVERGED"), Report.NumOpMismatches, Report.NumFinalStateMismatches, Report.NumRefusedOutsideCatalog, Report.ExternalGold, Report.NumSkippedOps, Report.NumCatalogChanges);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayInventoryOpsCommand(
+    TEXT("PredItem.ReplayInventoryOps"),
+    TEXT("Replays an inventory recording against the item catalog and reports throughput and latencies. Usage: PredItem.ReplayInventoryOps <File> [NumIterations]"),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReplayInventoryOps));
@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PredItemEconomy.h"
+
+class IFileHandle;
+struct FPredItemCatalog;
+
+/**
+ * What an FPredInventoryOp records. Stored on disk, only ever append new values.
+ */
+enum class EPredInventoryOpType : uint8
+{
+    /** An inventory started recording. Count is its number of slots, Value its sell modifier and GoldAfter its starting gold. */
+    Begin,
+    /** Server_TryBuyItem. Value is what the item cost, 0 if the purchase was refused. */
+    Buy,
+    /** Server_TrySellItem at Slot. Value is what the item sold for. */
+    Sell,
+    /** EquipItem, from outside of a purchase */
+    Equip,
+    /** RemoveItem, from outside of a purchase */
+    Remove,
+    /** The contents of a slot when the recording stopped, for checking a replay against */
+    SlotState,
+    /** An inventory stopped recording. GoldAfter is its final gold. */
+    End,
+    /** A LiveOps override changed the price of ItemIndex to Value. Belongs to no inventory, takes effect at the next CatalogChange. */
+    ItemPrice,
+    /**
+     * A LiveOps override swapped the catalog, the ItemPrice ops just before it are its new prices. Belongs to no inventory,
+     * OwnerID holds the checksum of the new catalog (see FPredInventoryRecorder::ComputeCatalogChecksum).
+     */
+    CatalogChange,
+    /** Gold gained or lost outside of any other op (kills, passive income, snapshot restores, ...). Value is the change, GoldAfter the gold it left. */
+    GoldDelta,
+};
+
+/** Number of EPredInventoryOpType values */
+static constexpr int32 NumPredInventoryOpTypes = (int32)EPredInventoryOpType::GoldDelta + 1;
+
+/** Whether ops of @Type belong to the whole recording rather than to an inventory */
+inline bool IsCatalogInventoryOp(EPredInventoryOpType Type) { return Type == EPredInventoryOpType::ItemPrice || Type == EPredInventoryOpType::CatalogChange; }
+
+/**
+ * A single inventory operation, written to disk as is. 24 bytes, little endian.
+ */
+struct FPredInventoryOp
+{
+    /** World time of the operation, in milliseconds */
+    uint32 TimeMs = 0;
+
+    /** Identifies the inventory owner within the match (UObject unique ID of the owner) */
+    uint32 OwnerID = 0;
+
+    /** Owner's gold once the operation was done */
+    float GoldAfter = 0.0f;
+
+    /** Depends on Type, see EPredInventoryOpType */
+    float Value = 0.0f;
+
+    /** UPredItem::ItemIndex of the item involved, INDEX_NONE if none */
+    int16 ItemIndex = INDEX_NONE;
+
+    EPredInventoryOpType Type = EPredInventoryOpType::Begin;
+
+    /** Slot the operation targeted, INDEX_NONE if it didn't target one */
+    int8 Slot = INDEX_NONE;
+
+    uint8 Count = 0;
+
+    /** Whether the server went through with the operation */
+    uint8 bSucceeded = 0;
+
+    uint16 Reserved = 0;
+};
+static_assert(sizeof(FPredInventoryOp) == 24, "FPredInventoryOp is written to disk as is, keep it packed");
+
+/**
+ * Header at the start of every recording. The rest of the file is FPredInventoryOps, back to back.
+ */
+struct FPredInventoryRecordingHeader
+{
+    static constexpr uint32 ExpectedMagic = 0x31524950; // "PIR1"
+    static constexpr uint32 CurrentVersion = 1;
+
+    uint32 Magic = ExpectedMagic;
+    uint32 Version = CurrentVersion;
+    uint32 OpSize = sizeof(FPredInventoryOp);
+
+    /** Size and checksum of the catalog the item indices refer to, a replay needs the same one. Later swaps are recorded as CatalogChange ops. */
+    uint32 NumItems = 0;
+    uint32 CatalogChecksum = 0;
+    uint32 Reserved = 0;
+
+    /** FDateTime ticks (UTC) of when the recording was opened */
+    int64 StartTicks = 0;
+};
+static_assert(sizeof(FPredInventoryRecordingHeader) == 32, "FPredInventoryRecordingHeader is written to disk as is, keep it packed");
+
+/**
+ * Records the inventory operations of a match to a binary file, so the same workload can be replayed headless with FPredInventoryReplay.
+ * Only the operations that reach an inventory from outside are recorded, the equips and removals a purchase makes along the way are part of the purchase.
+ * Game thread only. Operations are buffered and written in batches.
+ */
+class PREDECESSOR_API FPredInventoryRecorder
+{
+public:
+
+    /** Operations buffered before they are written out */
+    static constexpr int32 OpsPerWrite = 4096;
+
+    ~FPredInventoryRecorder();
+
+    /** Creates @Filename and writes the header. Returns false if the file couldn't be opened, in which case nothing is recorded. */
+    bool Open(const FString& Filename);
+
+    /** Writes everything buffered and closes the file */
+    void Close();
+
+    /** Stamps the recording with @Catalog, which the item indices of every operation refer to */
+    void SetCatalog(const FPredItemCatalog& Catalog);
+
+    /**
+     * Records @NewCatalog, a LiveOps override of @OldCatalog with the same items, taking over at @TimeMs: an ItemPrice op for every
+     * price that changed, then a CatalogChange op. The header keeps describing the catalog the recording started with.
+     */
+    void RecordCatalogChange(const FPredItemCatalog& OldCatalog, const FPredItemCatalog& NewCatalog, uint32 TimeMs);
+
+    void Record(const FPredInventoryOp& Op);
+
+    bool IsRecording() const { return FileHandle.IsValid(); }
+
+    int64 GetNumRecordedOps() const { return NumRecordedOps; }
+
+    const FString& GetFilename() const { return Filename; }
+
+    /** Reads the recording @InFilename back. Returns false if it doesn't exist or isn't a recording. */
+    static bool ReadRecordingFile(const FString& InFilename, FPredInventoryRecordingHeader& OutHeader, TArray<FPredInventoryOp>& OutOps);
+
+    /** Checksum of everything in @Catalog that decides the outcome of an operation: prices, recipes and stack sizes */
+    static uint32 ComputeCatalogChecksum(const FPredItemCatalog& Catalog);
+
+    /** Same as ComputeCatalogChecksum, for a catalog's economy on its own */
+    static uint32 ComputeEconomyChecksum(const FPredItemEconomy& Economy);
+
+private:
+
+    void WriteBufferedOps();
+
+    /** Rewrites the header at the start of the file, leaving the file position at the end */
+    void WriteHeader();
+
+    TUniquePtr<IFileHandle> FileHandle;
+    FPredInventoryRecordingHeader Header;
+    TArray<FPredInventoryOp> BufferedOps;
+    int64 NumRecordedOps = 0;
+    FString Filename;
+};
+
+/**
+ * Latencies of one type of operation over a replay, in microseconds.
+ */
+struct FPredInventoryReplayLatency
+{
+    int32 Count = 0;
+    double P50 = 0.0;
+    double P90 = 0.0;
+    double P99 = 0.0;
+    double Max = 0.0;
+};
+
+/**
+ * Outcome of a replay.
+ */
+struct FPredInventoryReplayReport
+{
+    int32 NumInventories = 0;
+    int64 NumOps = 0;
+    double Seconds = 0.0;
+
+    /** Operations the replay didn't agree with the recording on: success, price or gold */
+    int64 NumOpMismatches = 0;
+
+    /** Inventories whose slots didn't end up the way they were recorded */
+    int32 NumFinalStateMismatches = 0;
+
+    /** Operations of inventories which began before the recording did, which can't be replayed */
+    int64 NumSkippedOps = 0;
+
+    /** Purchases the recording refused which the catalog alone would have allowed, eg. because the owner wasn't in the shop */
+    int64 NumRefusedOutsideCatalog = 0;
+
+    /** Gold gained or lost between operations (kills, passive income, ...), the sum of the recording's GoldDelta ops */
+    double ExternalGold = 0.0;
+
+    /** Catalog swaps the replay followed */
+    int32 NumCatalogChanges = 0;
+
+    /** Indexed by EPredInventoryOpType */
+    FPredInventoryReplayLatency Latencies[NumPredInventoryOpTypes];
+
+    double GetOpsPerSecond() const { return Seconds > 0.0 ? NumOps / Seconds : 0.0; }
+};
+
+/**
+ * Replays a recording against the item catalog alone: no UObjects, no ASC, no replication, just the inventory rules run as fast as they go.
+ * Each inventory is simulated as an FPredEconomyInventory, driven through the catalog's economy like UPredInventoryComponent is.
+ * Prices follow the recording's CatalogChange ops, so a match that went through LiveOps overrides replays as it was played.
+ * Gold is carried from op to op, only what the recording's GoldDelta ops add comes from outside. Every op is checked against the
+ * success, price and gold the server recorded, and every inventory's slots and gold against how it ended.
+ */
+class PREDECESSOR_API FPredInventoryReplay
+{
+public:
+
+    explicit FPredInventoryReplay(const FPredItemCatalog& InCatalog);
+
+    /** Replays @Ops @NumIterations times over, filling @OutReport. Only the last iteration is checked against the recording. */
+    void Run(TArrayView<const FPredInventoryOp> Ops, int32 NumIterations, FPredInventoryReplayReport& OutReport);
+
+private:
+
+    /** Runs @Op against @Inventory, returning false if it didn't turn out the way it was recorded */
+    bool ReplayOp(const FPredInventoryOp& Op, FPredEconomyInventory& Inventory, FPredInventoryReplayReport& Report) const;
+
+    /** Runs the ItemPrice or CatalogChange @Op, returning false if the new prices don't add up to the recorded catalog */
+    bool ReplayCatalogOp(const FPredInventoryOp& Op, FPredInventoryReplayReport& Report);
+
+    const FPredItemCatalog& Catalog;
+
+    /** Economy of the catalog as of the op being replayed, starts out as the catalog's */
+    FPredItemEconomy Economy;
+
+    /** Prices of the next CatalogChange, gathered from the ItemPrice ops before it */
+    std::vector<float> PendingPrices;
+};
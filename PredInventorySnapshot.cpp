@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredInventorySnapshot.h"
+#include "PredItemCatalog.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+void FPredInventorySnapshot::Pack(const FPredItemCatalog& Catalog, TArray<uint8>& OutBytes) const
+{
+    FBitWriter Writer(0, true);
+
+    uint8 Version = CurrentVersion;
+    uint32 LayoutChecksum = Catalog.LayoutChecksum;
+    Writer << Version;
+    Writer << LayoutChecksum;
+
+    uint32 NumPackedSlots = NumSlots();
+    Writer.SerializeIntPacked(NumPackedSlots);
+
+    // Item index + 1 so empty slots are 0. Stack counts are only written for items that stack, in as many bits as their max needs.
+    for (int32 Slot = 0; Slot < NumSlots(); Slot++)
+    {
+        const int32 ItemIndex = SlotItems[Slot];
+        Writer.WriteInt(ItemIndex + 1, Catalog.Num() + 1);
+
+        if (ItemIndex != INDEX_NONE && Catalog.Economy.IsStackable(ItemIndex))
+        {
+            Writer.WriteInt(SlotCounts[Slot] - 1, Catalog.GetMaxStackSize(ItemIndex));
+        }
+    }
+
+    float PackedGold = Gold;
+    Writer << PackedGold;
+
+    uint32 NumProviders = UniqueProviderSlots.Num();
+    Writer.SerializeIntPacked(NumProviders);
+    for (const TPair<int32, int32>& UniqueProviderSlot : UniqueProviderSlots)
+    {
+        Writer.WriteInt(UniqueProviderSlot.Key, FMath::Max(Catalog.UniqueIdentifiers.Num(), 1));
+        Writer.WriteInt(UniqueProviderSlot.Value, FMath::Max(NumSlots(), 1));
+    }
+
+    OutBytes = *Writer.GetBuffer();
+    OutBytes.SetNum(Writer.GetNumBytes());
+}
+
+bool FPredInventorySnapshot::Unpack(const FPredItemCatalog& Catalog, const TArray<uint8>& Bytes)
+{
+    FBitReader Reader(const_cast<uint8*>(Bytes.GetData()), Bytes.Num() * 8);
+
+    uint8 Version = 0;
+    uint32 LayoutChecksum = 0;
+    Reader << Version;
+    Reader << LayoutChecksum;
+    if (Reader.IsError() || Version != CurrentVersion || LayoutChecksum != Catalog.LayoutChecksum) { return false; }
+
+    uint32 NumPackedSlots = 0;
+    Reader.SerializeIntPacked(NumPackedSlots);
+    if (Reader.IsError() || NumPackedSlots > MAX_uint8) { return false; }
+
+    SlotItems.SetNumUninitialized(NumPackedSlots);
+    SlotCounts.SetNumUninitialized(NumPackedSlots);
+    for (int32 Slot = 0; Slot < (int32)NumPackedSlots; Slot++)
+    {
+        const int32 ItemIndex = (int32)Reader.ReadInt(Catalog.Num() + 1) - 1;
+        SlotItems[Slot] = ItemIndex;
+        SlotCounts[Slot] = ItemIndex != INDEX_NONE ? 1 : 0;
+
+        if (ItemIndex != INDEX_NONE && Catalog.Economy.IsStackable(ItemIndex))
+        {
+            SlotCounts[Slot] = (uint8)(Reader.ReadInt(Catalog.GetMaxStackSize(ItemIndex)) + 1);
+        }
+    }
+
+    Reader << Gold;
+
+    uint32 NumProviders = 0;
+    Reader.SerializeIntPacked(NumProviders);
+    if (Reader.IsError() || NumProviders > (uint32)Catalog.UniqueIdentifiers.Num()) { return false; }
+
+    UniqueProviderSlots.SetNum(NumProviders);
+    for (TPair<int32, int32>& UniqueProviderSlot : UniqueProviderSlots)
+    {
+        UniqueProviderSlot.Key = (int32)Reader.ReadInt(FMath::Max(Catalog.UniqueIdentifiers.Num(), 1));
+        UniqueProviderSlot.Value = (int32)Reader.ReadInt(FMath::Max(NumSlots(), 1));
+    }
+
+    // ReadInt never returns anything past its max, so every index is in range and only a truncated buffer is left to catch.
+    return !Reader.IsError() && FMath::IsFinite(Gold);
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPredItemCatalog;
+
+/**
+ * Everything needed to put a full inventory back the way it was: what each slot holds, the owner's gold and which slot provides
+ * each applied unique identifier. Effect, ability and passive handles are left out, they are rebuilt by applying the items again.
+ *
+ * Held packed between taking and restoring it, eg. while its player is disconnected (see APredItemService::SaveInventorySnapshot).
+ * Items are packed by index in as few bits as the catalog needs, which makes a six slot inventory a couple dozen bytes, so a
+ * snapshot only unpacks against a catalog with the same item layout (see FPredItemCatalog::LayoutChecksum).
+ */
+struct PREDECESSOR_API FPredInventorySnapshot
+{
+    /** Bumped whenever the packed layout changes, older snapshots are refused */
+    static constexpr uint8 CurrentVersion = 1;
+
+    /** Item index held by each slot, INDEX_NONE for empty slots */
+    TArray<int32> SlotItems;
+
+    /** Stack count of each slot, 0 for empty slots */
+    TArray<uint8> SlotCounts;
+
+    float Gold = 0.0f;
+
+    /** Slot providing each applied unique identifier, keyed by the identifier's bit (see FPredItemCatalog::UniqueIdentifiers) */
+    TArray<TPair<int32, int32>> UniqueProviderSlots;
+
+    int32 NumSlots() const { return SlotItems.Num(); }
+
+    /** Packs the snapshot, taken against @Catalog, into @OutBytes */
+    void Pack(const FPredItemCatalog& Catalog, TArray<uint8>& OutBytes) const;
+
+    /**
+     * Unpacks @Bytes into this snapshot. Returns false if they aren't a snapshot of this version, were packed against a different
+     * item layout than @Catalog's, or hold anything @Catalog doesn't allow (unknown items, oversized stacks).
+     */
+    bool Unpack(const FPredItemCatalog& Catalog, const TArray<uint8>& Bytes);
+};
@@ -0,0 +1,415 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredInventoryTimeline.h"
+#include "Algo/BinarySearch.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "PredItemCatalog.h"
+#include "PredItemLibrary.h"
+#include "PredItemService.h"
+#include "PredLoggingLibrary.h"
+
+/** Item index + 1 so empty slots are 0, and only stacks of more than one spend bits on their count */
+static void SerializeTimelineSlot(FArchive& Ar, int16& ItemIndex, uint8& Count)
+{
+    uint32 PackedItem = Ar.IsSaving() ? ItemIndex + 1 : 0;
+    uint32 PackedCount = Ar.IsSaving() ? Count : 0;
+    uint8 bStacked = PackedCount > 1 ? 1 : 0;
+    Ar.SerializeIntPacked(PackedItem);
+    Ar.SerializeBits(&bStacked, 1);
+    if (bStacked)
+    {
+        Ar.SerializeIntPacked(PackedCount);
+    }
+
+    if (Ar.IsLoading())
+    {
+        ItemIndex = (int16)((int32)FMath::Min<uint32>(PackedItem, MAX_int16) - 1);
+        Count = bStacked ? (uint8)FMath::Min<uint32>(PackedCount, MAX_uint8) : (PackedItem != 0 ? 1 : 0);
+    }
+}
+
+FPredInventoryTimeline::FPredInventoryTimeline(uint32 InKeyframeIntervalMs)
+{
+    SetKeyframeInterval(InKeyframeIntervalMs);
+}
+
+int32 FPredInventoryTimeline::AddTrack(const FString& Name)
+{
+    FTrack& Track = Tracks.AddDefaulted_GetRef();
+    Track.Name = Name;
+    return Tracks.Num() - 1;
+}
+
+void FPredInventoryTimeline::Record(int32 TrackIdx, uint32 TimeMs, TArrayView<const int32> SlotItems, TArrayView<const uint8> SlotCounts, float Gold)
+{
+    check(Tracks.IsValidIndex(TrackIdx) && SlotItems.Num() == SlotCounts.Num());
+
+    FTrack& Track = Tracks[TrackIdx];
+    FPredTimelineState& State = Track.State;
+    const int32 WholeGold = FMath::Max(FMath::FloorToInt(Gold), 0);
+    TimeMs = FMath::Max(TimeMs, Track.LastTimeMs);
+
+    // Deltas are written against the keyframe's slots, a different number of slots needs a keyframe of its own.
+    if (!Track.OpenChunk.IsValid() || State.NumSlots() != SlotItems.Num() || TimeMs - Track.OpenChunkStartMs >= KeyframeIntervalMs)
+    {
+        if (Track.OpenChunk.IsValid())
+        {
+            CloseChunk(Track, TrackIdx);
+        }
+
+        State.SlotItems.SetNumUninitialized(SlotItems.Num());
+        for (int32 Slot = 0; Slot < SlotItems.Num(); Slot++)
+        {
+            State.SlotItems[Slot] = (int16)SlotItems[Slot];
+        }
+        State.SlotCounts = TArray<uint8>(SlotCounts.GetData(), SlotCounts.Num());
+        State.Gold = WholeGold;
+        Track.LastTimeMs = TimeMs;
+        StartChunk(Track, TimeMs);
+        return;
+    }
+
+    bool bSlotsChanged = false;
+    for (int32 Slot = 0; Slot < SlotItems.Num() && !bSlotsChanged; Slot++)
+    {
+        bSlotsChanged = SlotItems[Slot] != State.SlotItems[Slot] || SlotCounts[Slot] != State.SlotCounts[Slot];
+    }
+    const bool bGoldChanged = WholeGold != State.Gold;
+    if (!bSlotsChanged && !bGoldChanged) { return; }
+
+    FBitWriter& Writer = *Track.OpenChunk;
+    uint32 TimeDeltaMs = TimeMs - Track.LastTimeMs;
+    Writer.SerializeIntPacked(TimeDeltaMs);
+    Writer.WriteBit(bSlotsChanged ? 1 : 0);
+    Writer.WriteBit(bGoldChanged ? 1 : 0);
+
+    if (bSlotsChanged)
+    {
+        // A bit per slot says whether it changed, only changed slots are written.
+        for (int32 Slot = 0; Slot < SlotItems.Num(); Slot++)
+        {
+            const bool bSlotChanged = SlotItems[Slot] != State.SlotItems[Slot] || SlotCounts[Slot] != State.SlotCounts[Slot];
+            Writer.WriteBit(bSlotChanged ? 1 : 0);
+            if (bSlotChanged)
+            {
+                State.SlotItems[Slot] = (int16)SlotItems[Slot];
+                State.SlotCounts[Slot] = SlotCounts[Slot];
+                SerializeTimelineSlot(Writer, State.SlotItems[Slot], State.SlotCounts[Slot]);
+            }
+        }
+    }
+
+    if (bGoldChanged)
+    {
+        // Zigzag so spending and earning both pack small.
+        const int32 GoldDelta = WholeGold - State.Gold;
+        uint32 PackedGoldDelta = ((uint32)GoldDelta << 1) ^ (uint32)(GoldDelta >> 31);
+        Writer.SerializeIntPacked(PackedGoldDelta);
+        State.Gold = WholeGold;
+    }
+
+    Track.LastTimeMs = TimeMs;
+}
+
+void FPredInventoryTimeline::StartChunk(FTrack& Track, uint32 TimeMs)
+{
+    Track.OpenChunk = MakeUnique<FBitWriter>(0, true);
+    Track.OpenChunkStartMs = TimeMs;
+
+    FBitWriter& Writer = *Track.OpenChunk;
+    uint32 NumSlots = Track.State.NumSlots();
+    Writer.SerializeIntPacked(NumSlots);
+    for (int32 Slot = 0; Slot < Track.State.NumSlots(); Slot++)
+    {
+        SerializeTimelineSlot(Writer, Track.State.SlotItems[Slot], Track.State.SlotCounts[Slot]);
+    }
+
+    uint32 Gold = Track.State.Gold;
+    Writer.SerializeIntPacked(Gold);
+}
+
+void FPredInventoryTimeline::CloseChunk(FTrack& Track, int32 TrackIdx)
+{
+    const FBitWriter& Writer = *Track.OpenChunk;
+
+    FPredTimelineChunk& Chunk = Track.Chunks.AddDefaulted_GetRef();
+    Chunk.Track = TrackIdx;
+    Chunk.StartTimeMs = Track.OpenChunkStartMs;
+    Chunk.EndTimeMs = Track.LastTimeMs;
+    Chunk.NumBits = (int32)Writer.GetNumBits();
+    Chunk.Bytes.Append(Writer.GetData(), (int32)Writer.GetNumBytes());
+
+    Track.OpenChunk.Reset();
+}
+
+void FPredInventoryTimeline::CloseStaleChunks(uint32 NowMs)
+{
+    for (int32 TrackIdx = 0; TrackIdx < Tracks.Num(); TrackIdx++)
+    {
+        FTrack& Track = Tracks[TrackIdx];
+        if (Track.OpenChunk.IsValid() && NowMs - Track.OpenChunkStartMs >= KeyframeIntervalMs)
+        {
+            CloseChunk(Track, TrackIdx);
+        }
+    }
+}
+
+void FPredInventoryTimeline::CloseAllChunks()
+{
+    for (int32 TrackIdx = 0; TrackIdx < Tracks.Num(); TrackIdx++)
+    {
+        if (Tracks[TrackIdx].OpenChunk.IsValid())
+        {
+            CloseChunk(Tracks[TrackIdx], TrackIdx);
+        }
+    }
+}
+
+bool FPredInventoryTimeline::AddChunk(FPredTimelineChunk&& Chunk)
+{
+    if (!Tracks.IsValidIndex(Chunk.Track) || !CanAppendChunk(Tracks[Chunk.Track].Chunks, Chunk)) { return false; }
+
+    FTrack& Track = Tracks[Chunk.Track];
+    Track.LastTimeMs = Chunk.EndTimeMs;
+    Track.Chunks.Add(MoveTemp(Chunk));
+    return true;
+}
+
+bool FPredInventoryTimeline::CanAppendChunk(const TArray<FPredTimelineChunk>& Chunks, const FPredTimelineChunk& Chunk)
+{
+    if (Chunk.NumBits < 0 || Chunk.NumBits > (int64)Chunk.Bytes.Num() * 8) { return false; }
+
+    // Seeking binary searches the chunks by start time.
+    return Chunks.Num() == 0 || Chunk.StartTimeMs > Chunks.Last().StartTimeMs;
+}
+
+bool FPredInventoryTimeline::GetStateAt(int32 TrackIdx, uint32 TimeMs, FPredTimelineState& OutState) const
+{
+    if (!Tracks.IsValidIndex(TrackIdx)) { return false; }
+
+    const FTrack& Track = Tracks[TrackIdx];
+    if (Track.OpenChunk.IsValid() && Track.OpenChunkStartMs <= TimeMs)
+    {
+        return ReplayChunk(Track.OpenChunk->GetData(), Track.OpenChunk->GetNumBits(), Track.OpenChunkStartMs, TimeMs, OutState);
+    }
+
+    // Last chunk starting at or before TimeMs. Times past its end just get all of it, nothing changed until the next one.
+    const int32 ChunkIdx = Algo::UpperBoundBy(Track.Chunks, TimeMs, &FPredTimelineChunk::StartTimeMs) - 1;
+    if (ChunkIdx < 0) { return false; }
+
+    const FPredTimelineChunk& Chunk = Track.Chunks[ChunkIdx];
+    return ReplayChunk(Chunk.Bytes.GetData(), Chunk.NumBits, Chunk.StartTimeMs, TimeMs, OutState);
+}
+
+bool FPredInventoryTimeline::ReplayChunk(const uint8* Data, int64 NumBits, uint32 StartTimeMs, uint32 UntilMs, FPredTimelineState& State)
+{
+    FBitReader Reader(const_cast<uint8*>(Data), NumBits);
+
+    uint32 NumSlots = 0;
+    Reader.SerializeIntPacked(NumSlots);
+    if (Reader.IsError() || NumSlots > MAX_uint8) { return false; }
+
+    State.SlotItems.SetNumUninitialized(NumSlots);
+    State.SlotCounts.SetNumUninitialized(NumSlots);
+    for (int32 Slot = 0; Slot < (int32)NumSlots; Slot++)
+    {
+        SerializeTimelineSlot(Reader, State.SlotItems[Slot], State.SlotCounts[Slot]);
+    }
+
+    uint32 Gold = 0;
+    Reader.SerializeIntPacked(Gold);
+    State.Gold = (int32)Gold;
+
+    uint32 TimeMs = StartTimeMs;
+    while (Reader.GetBitsLeft() > 0 && !Reader.IsError())
+    {
+        // Each change leads with its time, so we can stop right before the first one past UntilMs.
+        uint32 TimeDeltaMs = 0;
+        Reader.SerializeIntPacked(TimeDeltaMs);
+        if (TimeMs + TimeDeltaMs > UntilMs) { break; }
+        TimeMs += TimeDeltaMs;
+
+        const bool bSlotsChanged = Reader.ReadBit() != 0;
+        const bool bGoldChanged = Reader.ReadBit() != 0;
+
+        if (bSlotsChanged)
+        {
+            for (int32 Slot = 0; Slot < (int32)NumSlots; Slot++)
+            {
+                if (Reader.ReadBit())
+                {
+                    SerializeTimelineSlot(Reader, State.SlotItems[Slot], State.SlotCounts[Slot]);
+                }
+            }
+        }
+
+        if (bGoldChanged)
+        {
+            uint32 PackedGoldDelta = 0;
+            Reader.SerializeIntPacked(PackedGoldDelta);
+            State.Gold += (int32)(PackedGoldDelta >> 1) ^ -(int32)(PackedGoldDelta & 1);
+        }
+    }
+
+    return !Reader.IsError();
+}
+
+uint32 FPredInventoryTimeline::GetEndTimeMs() const
+{
+    uint32 EndTimeMs = 0;
+    for (const FTrack& Track : Tracks)
+    {
+        EndTimeMs = FMath::Max(EndTimeMs, Track.LastTimeMs);
+    }
+    return EndTimeMs;
+}
+
+int64 FPredInventoryTimeline::GetNumBytes() const
+{
+    int64 NumBytes = 0;
+    for (const FTrack& Track : Tracks)
+    {
+        for (const FPredTimelineChunk& Chunk : Track.Chunks)
+        {
+            NumBytes += Chunk.Bytes.Num();
+        }
+        NumBytes += Track.OpenChunk.IsValid() ? Track.OpenChunk->GetNumBytes() : 0;
+    }
+    return NumBytes;
+}
+
+bool FPredInventoryTimeline::SaveToFile(const FString& Filename, uint32 LayoutChecksum)
+{
+    CloseAllChunks();
+
+    TArray<uint8> Bytes;
+    FMemoryWriter Ar(Bytes);
+
+    uint32 Magic = FileMagic;
+    uint32 Version = FileVersion;
+    int32 NumSavedTracks = Tracks.Num();
+    Ar << Magic << Version << KeyframeIntervalMs << LayoutChecksum << NumSavedTracks;
+
+    for (FTrack& Track : Tracks)
+    {
+        int32 NumChunks = Track.Chunks.Num();
+        Ar << Track.Name << NumChunks;
+        for (FPredTimelineChunk& Chunk : Track.Chunks)
+        {
+            Ar << Chunk.StartTimeMs << Chunk.EndTimeMs << Chunk.NumBits << Chunk.Bytes;
+        }
+    }
+
+    return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FPredInventoryTimeline::LoadFromFile(const FString& Filename, uint32& OutLayoutChecksum)
+{
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *Filename)) { return false; }
+
+    FMemoryReader Ar(Bytes);
+
+    uint32 Magic = 0;
+    uint32 Version = 0;
+    uint32 LoadedKeyframeIntervalMs = 0;
+    int32 NumLoadedTracks = 0;
+    Ar << Magic << Version;
+    if (Ar.IsError() || Magic != FileMagic || Version != FileVersion) { return false; }
+
+    Ar << LoadedKeyframeIntervalMs << OutLayoutChecksum << NumLoadedTracks;
+    if (Ar.IsError() || NumLoadedTracks < 0 || NumLoadedTracks > MAX_uint16) { return false; }
+
+    TArray<FTrack> LoadedTracks;
+    LoadedTracks.SetNum(NumLoadedTracks);
+    for (int32 TrackIdx = 0; TrackIdx < NumLoadedTracks && !Ar.IsError(); TrackIdx++)
+    {
+        FTrack& Track = LoadedTracks[TrackIdx];
+        int32 NumChunks = 0;
+        Ar << Track.Name << NumChunks;
+
+        // Every chunk takes at least a dozen bytes, anything claiming more than fit is a corrupt file.
+        if (NumChunks < 0 || NumChunks > Bytes.Num() / 12) { return false; }
+
+        Track.Chunks.Reserve(NumChunks);
+        for (int32 ChunkIdx = 0; ChunkIdx < NumChunks; ChunkIdx++)
+        {
+            FPredTimelineChunk Chunk;
+            Chunk.Track = TrackIdx;
+            Ar << Chunk.StartTimeMs << Chunk.EndTimeMs << Chunk.NumBits << Chunk.Bytes;
+
+            // Held to the same rules as streamed chunks, replaying one that breaks them would read past its bytes.
+            if (Ar.IsError() || !CanAppendChunk(Track.Chunks, Chunk)) { return false; }
+
+            Track.LastTimeMs = FMath::Max(Track.LastTimeMs, Chunk.EndTimeMs);
+            Track.Chunks.Add(MoveTemp(Chunk));
+        }
+    }
+    if (Ar.IsError()) { return false; }
+
+    SetKeyframeInterval(LoadedKeyframeIntervalMs);
+    Tracks = MoveTemp(LoadedTracks);
+    return true;
+}
+
+/**
+ * PredItem.SeekTimeline <File> <Seconds>
+ * Prints what every player held at a point of a saved inventory timeline, the way a replay scrubber would see it.
+ */
+static void SeekInventoryTimeline(const TArray<FString>& Args, UWorld* World)
+{
+    if (Args.Num() < 2)
+    {
+        TRACESTATIC(PredItemLog, Log, "Usage: PredItem.SeekTimeline <File> <Seconds>");
+        return;
+    }
+
+    FPredInventoryTimeline Timeline;
+    uint32 LayoutChecksum = 0;
+    if (!Timeline.LoadFromFile(Args[0], LayoutChecksum))
+    {
+        TRACESTATIC(PredItemLog, Warning, "%s is not an inventory timeline.", *Args[0]);
+        return;
+    }
+
+    // Item indices only mean something against the catalog they were recorded with, print bare indices otherwise.
+    APredItemService* ItemService = World ? UPredItemLibrary::GetItemService(World) : nullptr;
+    const FPredItemCatalog* Catalog = ItemService && ItemService->GetCatalog().LayoutChecksum == LayoutChecksum ? &ItemService->GetCatalog() : nullptr;
+    if (!Catalog)
+    {
+        TRACESTATIC(PredItemLog, Warning, "%s was recorded with a different item catalog (layout %08x), showing item indices.", *Args[0], LayoutChecksum);
+    }
+
+    const uint32 TimeMs = (uint32)FMath::Max(FCString::Atof(*Args[1]) * 1000.0f, 0.0f);
+    TRACESTATIC(PredItemLog, Log, "%s at %.3fs of %.3fs, %d players, %lld bytes:", *Args[0], TimeMs / 1000.0f, Timeline.GetEndTimeMs() / 1000.0f, Timeline.NumTracks(), Timeline.GetNumBytes());
+
+    FPredTimelineState State;
+    for (int32 Track = 0; Track < Timeline.NumTracks(); Track++)
+    {
+        if (!Timeline.GetStateAt(Track, TimeMs, State))
+        {
+            TRACESTATIC(PredItemLog, Log, "  %s: nothing yet", *Timeline.GetTrackName(Track));
+            continue;
+        }
+
+        FString Items;
+        for (int32 Slot = 0; Slot < State.NumSlots(); Slot++)
+        {
+            const int32 ItemIndex = State.SlotItems[Slot];
+            const FString ItemName = ItemIndex == INDEX_NONE ? TEXT("-") : Catalog && Catalog->Items.IsValidIndex(ItemIndex) ? GetNameSafe(Catalog->Items[ItemIndex]) : FString::Printf(TEXT("#%d"), ItemIndex);
+            Items += State.SlotCounts[Slot] > 1 ? FString::Printf(TEXT(" %s x%d"), *ItemName, State.SlotCounts[Slot]) : TEXT(" ") + ItemName;
+        }
+        TRACESTATIC(PredItemLog, Log, "  %s: %d gold,%s", *Timeline.GetTrackName(Track), State.Gold, *Items);
+    }
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SeekInventoryTimelineCommand(
+    TEXT("PredItem.SeekTimeline"),
+    TEXT("Prints what every player held at a point of a saved inventory timeline. Usage: PredItem.SeekTimeline <File> <Seconds>"),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SeekInventoryTimeline));
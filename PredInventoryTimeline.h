@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/BitWriter.h"
+
+#include "PredInventoryTimeline.generated.h"
+
+class APlayerState;
+
+/**
+ * One player's items and gold at a point of their timeline.
+ */
+struct PREDECESSOR_API FPredTimelineState
+{
+    /** Item index held by each slot, INDEX_NONE for empty slots */
+    TArray<int16> SlotItems;
+
+    /** Stack count of each slot, 0 for empty slots */
+    TArray<uint8> SlotCounts;
+
+    /** Whole gold, fractions are dropped so passive income doesn't make an entry every frame */
+    int32 Gold = 0;
+
+    int32 NumSlots() const { return SlotItems.Num(); }
+};
+
+/**
+ * A stretch of one player's timeline: a keyframe holding their whole state, followed by the changes made since, bit-packed.
+ * Closed chunks never change again, which is what lets them be streamed and seeked into on their own.
+ */
+USTRUCT()
+struct FPredTimelineChunk
+{
+    GENERATED_BODY()
+
+    /** Index of the player's track in the timeline */
+    UPROPERTY()
+    int32 Track = INDEX_NONE;
+
+    /** Server world time of the keyframe, in milliseconds */
+    UPROPERTY()
+    uint32 StartTimeMs = 0;
+
+    /** Server world time of the last change in the chunk, in milliseconds */
+    UPROPERTY()
+    uint32 EndTimeMs = 0;
+
+    UPROPERTY()
+    int32 NumBits = 0;
+
+    UPROPERTY()
+    TArray<uint8> Bytes;
+};
+
+/**
+ * Who a timeline track belongs to, as sent to spectators.
+ */
+USTRUCT()
+struct FPredTimelineTrackInfo
+{
+    GENERATED_BODY()
+
+    /**
+     * Null if the player left before the track reached us. Only nulled once they are garbage collected after leaving, so only
+     * safe to read where it is held in a UPROPERTY, and checked with IsValid.
+     */
+    UPROPERTY()
+    const APlayerState* Player = nullptr;
+
+    UPROPERTY()
+    FString PlayerName;
+};
+
+/**
+ * How far along the timeline a spectator has been streamed (see APredItemService::SetTimelineSubscriber).
+ */
+struct FPredTimelineStreamCursor
+{
+    /** Cleared while the subscriber paused the stream, they keep their place for when they pick it back up */
+    bool bStreaming = false;
+
+    /** Closed chunks sent of each track, one entry per track sent */
+    TArray<int32> NumChunksSent;
+};
+
+/**
+ * Delta-compressed timeline of every player's items and gold over a match, recorded by the server and streamed to spectators.
+ *
+ * Each player has a track made of chunks. A chunk opens with a keyframe holding the player's whole state, every record after that
+ * only writes what changed: the time since the last record, which slots changed and what they hold now, and how much gold came
+ * or went. A buy is a handful of bytes, gold ticking up a couple. A new chunk is started once the open one spans a keyframe
+ * interval, so seeking to any time decodes a single chunk: the last one starting before it, up to that time.
+ *
+ * Spectators get the same chunks once closed and rebuild the same timeline (see UPredTimelineStreamComponent). Game thread only.
+ */
+class PREDECESSOR_API FPredInventoryTimeline
+{
+public:
+
+    static constexpr uint32 FileMagic = 0x31544950; // "PIT1"
+    static constexpr uint32 FileVersion = 1;
+
+    explicit FPredInventoryTimeline(uint32 InKeyframeIntervalMs = 10000);
+
+    void SetKeyframeInterval(uint32 InKeyframeIntervalMs) { KeyframeIntervalMs = FMath::Max<uint32>(InKeyframeIntervalMs, 1); }
+
+    /** Adds a track for the player @Name, returning its index */
+    int32 AddTrack(const FString& Name);
+
+    int32 NumTracks() const { return Tracks.Num(); }
+
+    const FString& GetTrackName(int32 Track) const { return Tracks[Track].Name; }
+
+    /**
+     * Records @Track's slots and @Gold as of @TimeMs. Only what changed since the track's last record is written, nothing at all
+     * if nothing did. A change in the number of slots starts a new chunk. Server only.
+     */
+    void Record(int32 Track, uint32 TimeMs, TArrayView<const int32> SlotItems, TArrayView<const uint8> SlotCounts, float Gold);
+
+    /** Closes every open chunk started at least a keyframe interval before @NowMs, so tracks that went quiet still get streamed */
+    void CloseStaleChunks(uint32 NowMs);
+
+    /** Closes every open chunk, eg. before saving */
+    void CloseAllChunks();
+
+    /**
+     * Appends @Chunk, streamed from the server, to its track. Returns false if it doesn't fit there: unknown track, or not
+     * newer than the track's last chunk.
+     */
+    bool AddChunk(FPredTimelineChunk&& Chunk);
+
+    /** Closed chunks of @Track, oldest first */
+    TArrayView<const FPredTimelineChunk> GetClosedChunks(int32 Track) const { return Tracks[Track].Chunks; }
+
+    /**
+     * Places @Track's state as of @TimeMs in @OutState. Returns false if the track has nothing recorded at or before @TimeMs.
+     */
+    bool GetStateAt(int32 Track, uint32 TimeMs, FPredTimelineState& OutState) const;
+
+    /** Time of the last change recorded on any track, in milliseconds */
+    uint32 GetEndTimeMs() const;
+
+    /** Bytes held by every chunk, open ones included */
+    int64 GetNumBytes() const;
+
+    /** Closes every open chunk and writes the whole timeline to @Filename, stamped with the catalog's FPredItemCatalog::LayoutChecksum */
+    bool SaveToFile(const FString& Filename, uint32 LayoutChecksum);
+
+    /** Replaces this timeline with the one saved in @Filename. Returns false if it isn't a timeline of this version. */
+    bool LoadFromFile(const FString& Filename, uint32& OutLayoutChecksum);
+
+private:
+
+    struct FTrack
+    {
+        FString Name;
+        TArray<FPredTimelineChunk> Chunks;
+
+        /** Chunk being written, null until the first record and after the chunk is closed */
+        TUniquePtr<FBitWriter> OpenChunk;
+        uint32 OpenChunkStartMs = 0;
+
+        /** State and time as of the last record */
+        FPredTimelineState State;
+        uint32 LastTimeMs = 0;
+    };
+
+    /** Opens a chunk for @Track at @TimeMs with a keyframe of its current state */
+    void StartChunk(FTrack& Track, uint32 TimeMs);
+    void CloseChunk(FTrack& Track, int32 TrackIdx);
+
+    /**
+     * Whether @Chunk, streamed or loaded rather than recorded, can go after @Chunks: its bits fit in its bytes and it starts after
+     * the last of them. Replaying relies on both.
+     */
+    static bool CanAppendChunk(const TArray<FPredTimelineChunk>& Chunks, const FPredTimelineChunk& Chunk);
+
+    /**
+     * Decodes the chunk in @Data into @State, applying its changes up to and including @UntilMs. Returns false if it is malformed.
+     */
+    static bool ReplayChunk(const uint8* Data, int64 NumBits, uint32 StartTimeMs, uint32 UntilMs, FPredTimelineState& State);
+
+    uint32 KeyframeIntervalMs;
+
+    TArray<FTrack> Tracks;
+};
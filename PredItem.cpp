@@ -5,6 +5,10 @@
 #include "AbilitySystemBlueprintLibrary.h"
 #include "BaseAttributeSet.h"
 #include "PredItemLibrary.h"
+#include "PredItemStats.h"
+#include "PredItemCatalog.h"
+#include "PredItemCatalogSnapshot.h"
+#include "PredItemService.h"
 
 FPrimaryAssetId UPredItem::GetPrimaryAssetId() const
 {
@@ -23,10 +27,11 @@ FString UPredItem::GetItemName() const
 
 float UPredItem::GetTotalItemCost() const
 {
-    // If we've already calculated the cost for this item, return that
-    if (HasCachedTotalItemCost)
+    // Compiled items are priced by the catalog's economy, the same totals every other price comes from.
+    const FPredCatalogSnapshotHandle Snapshot = FPredCatalogSnapshot::Acquire();
+    if (Snapshot.IsValid() && Snapshot->ItemNames.IsValidIndex(ItemIndex) && Snapshot->ItemNames[ItemIndex] == GetFName())
     {
-        return CachedTotalItemCost;
+        return Snapshot->Economy.GetTotalItemCost(ItemIndex);
     }
 
     // Iterate through this item's children
@@ -36,10 +41,6 @@ float UPredItem::GetTotalItemCost() const
         ReturnedCost += RequiredItem->GetTotalItemCost();
     }
 
-    // Set the cached value for any future queries.
-    CachedTotalItemCost = ReturnedCost;
-    HasCachedTotalItemCost = true;
-
     return ReturnedCost;
 }
 
@@ -48,6 +49,18 @@ float UPredItem::GetItemCost() const
     return Price.GetMagnitude();
 }
 
+FGameplayEffectSpecHandle UPredItem::MakeMultiplicativeEffectSpec(const FGameplayEffectContextHandle& EffectContext) const
+{
+    if (!MultiplicativeSpecTemplate.IsValid())
+    {
+        return FGameplayEffectSpecHandle();
+    }
+
+    FGameplayEffectSpec* NewSpec = new FGameplayEffectSpec(*MultiplicativeSpecTemplate);
+    NewSpec->SetContext(EffectContext);
+    return FGameplayEffectSpecHandle(NewSpec);
+}
+
 bool UPredItem::CanPurchase(UPredInventoryComponent* InventoryComponent)
 {
     // refactored because CanAfford now takes into account items that exist in the passed in InventoryComponent.
@@ -56,6 +69,13 @@ bool UPredItem::CanPurchase(UPredInventoryComponent* InventoryComponent)
 
 bool UPredItem::CanAfford(UPredInventoryComponent* InventoryComponent)
 {
+    // Inventories track their gold and our price as they change, only ask the owner directly if this one can't answer.
+    bool bAffordable = false;
+    if (InventoryComponent->GetCachedAffordability(this, bAffordable))
+    {
+        return bAffordable;
+    }
+
     bool bFoundAttribute = false;
     float GoldAmount = UAbilitySystemBlueprintLibrary::GetFloatAttribute(InventoryComponent->GetOwner()
                                                                          , UBaseAttributeSet::GetGoldAttribute(), bFoundAttribute);
@@ -64,24 +84,40 @@ bool UPredItem::CanAfford(UPredInventoryComponent* InventoryComponent)
 
 float UPredItem::GetItemCostFor(UPredInventoryComponent* InventoryComponent)
 {
-    TArray<FPredInventorySlot> Inventory;
-    InventoryComponent->GetAllInventorySlots(Inventory);
+    PRED_ITEM_SCOPE(ItemCost, FPredItemStats::Get(InventoryComponent));
+
+    // Compiled items are priced by the catalog, the same walk personalized prices and purchases use.
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(InventoryComponent);
+    const FPredItemCatalog& Catalog = ItemService ? ItemService->GetCatalog() : FPredItemCatalog::GetEmpty();
+    if (Catalog.Contains(this))
+    {
+        const TArrayView<const uint16> OwnedItemCounts = InventoryComponent->GetOwnedItemCounts();
+        TArray<uint16, TInlineAllocator<256>> RemainingCounts(OwnedItemCounts.GetData(), OwnedItemCounts.Num());
+        return Catalog.GetItemCostFor(ItemIndex, RemainingCounts);
+    }
+
+    // Anything else walks the assets, same rules as the catalog.
 
-    TArray<const UPredItem*> InventoryItemDefinitions;
-    for (FPredInventorySlot& InventorySlot : Inventory)
+    // Read the slots in place, copying them would also copy their effect handles.
+    TArray<const UPredItem*, TInlineAllocator<8>> InventoryItemDefinitions;
+    for (const FPredInventorySlot& InventorySlot : InventoryComponent->GetInventorySlotsView())
     {
         if (InventorySlot.IsEmpty())
         {
             continue;
         }
 
-        InventoryItemDefinitions.Add(InventorySlot.SlottedItem.Item);
+        // Every copy in a stack can satisfy a recipe on its own.
+        for (int32 StackIdx = 0; StackIdx < InventorySlot.SlottedItem.GetStackCount(); StackIdx++)
+        {
+            InventoryItemDefinitions.Add(InventorySlot.SlottedItem.Item);
+        }
     }
 
     return GetItemCostForHelper(InventoryItemDefinitions);
 }
 
-float UPredItem::GetItemCostForHelper(TArray<const UPredItem*>& RemainingInventory)
+float UPredItem::GetItemCostForHelper(TArray<const UPredItem*, TInlineAllocator<8>>& RemainingInventory)
 {
     // To buy this item, you need the base price. Always.
     float ReturnedCost = GetItemCost();
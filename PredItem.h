@@ -8,6 +8,7 @@
 #include "AttributeSet.h"
 #include "GameplayEffect.h"
 #include "Engine/CurveTable.h"
+#include "PredItemEconomy.h"
 
 #include "PredItem.generated.h"
 
@@ -35,7 +36,7 @@ enum class EPredItemAttributeMagnitudeType : uint8
  * Allows switching between curve magnitudes and flat magnitudes. Useful for testing
  * or things we don't want hooked to data.
  *
- * Presumably will be deprecated once we have a better way of iterating on "LiveOps" (data we want edited outside of the editor) workflow.
+ * LiveOps overrides (see FPredLiveOpsOverrides) replace magnitudes at runtime with flat ones, whatever they were authored as.
  */
 USTRUCT(BlueprintType)
 struct FPredItemMagnitude
@@ -129,6 +130,33 @@ struct FPredUniqueItemEffect
 
 };
 
+/**
+ * Defines an attribute change pulsed every Period seconds while the item is equipped, like health regeneration.
+ * Pulsed by the item service's passive ticker rather than a periodic GameplayEffect per owner.
+ * Always additive, and scales with the stack.
+ */
+USTRUCT(BlueprintType)
+struct FPredItemPeriodicModifier
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem")
+    FGameplayAttribute Attribute;
+
+    /**
+     * Change applied by each pulse.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem")
+    FPredItemMagnitude Magnitude;
+
+    /**
+     * Seconds between pulses. Pulses are scheduled in slices of FPredItemPassiveTicker::SliceDuration, so shorter periods are rounded up to that.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 0.1))
+    float Period = 1.0f;
+
+};
+
 /**
  * Data asset which defines a single item. 
  * NOT an actual item instance, rather a definition of an item. "The item with this ID has the name Dagger and gives +10 AttackSpeed".
@@ -189,6 +217,13 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem")
     TArray<FPredUniqueItemEffect> ItemEffects;    
 
+    /**
+     * Attribute changes pulsed periodically while this item is equipped.
+     * Will stop when the item is removed.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem")
+    TArray<FPredItemPeriodicModifier> PeriodicModifiers;
+
     /**
      * The active ability granted when we add this item to an entity.
      * Will not add if the ability already exists.
@@ -196,12 +231,26 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem")
     TSubclassOf<UBaseGameplayAbility> ActiveAbility;
 
+    /**
+     * How many copies of this item can share a single inventory slot. 1 means the item does not stack.
+     * Stacked copies share one application of the item's effects, scaled by the stack count.
+     * Unique modifiers and effects are still only applied once.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 1, ClampMax = 255))
+    int32 MaxStackSize = 1;
+
+    bool IsStackable() const { return MaxStackSize > 1; }
+
     UFUNCTION(BlueprintCallable, Category = "PredItem")
     FString GetIdentifierString() const;
 
     UFUNCTION(BlueprintPure, Category = "PredItem")
     FString GetItemName() const;
 
+    /**
+     * Price of the item and every part of it, nothing owned. Compiled items take it from the current catalog snapshot's economy,
+     * items outside of it (eg. while the item service sorts them for compiling) add up their parts' assets.
+     */
     UFUNCTION(BlueprintPure, Category = "PredItem")
     float GetTotalItemCost() const;
 
@@ -217,6 +266,47 @@ public:
     UPROPERTY(BlueprintReadOnly, Category = "PredItem")
     TArray<UPredItem*> BuildsInto;
 
+    /**
+     * Dense index of this item in the loaded catalog (the item service's price-sorted list).
+     * Not exposed, assigned when the items are loaded. INDEX_NONE until then.
+     * Items are shared by every world in the process, so they all have to load the same list (see FPredItemCatalog::CanAssignItemIndices).
+     */
+    UPROPERTY(Transient)
+    int32 ItemIndex = INDEX_NONE;
+
+    /**
+     * Every unique identifier this item's modifiers and effects use. Not exposed, compiled along with ItemIndex.
+     */
+    FPredUniqueIdentifierMask UniqueIdentifierMask;
+
+    /**
+     * Unique identifier bit of each entry in AttributeModifiers / ItemEffects, INDEX_NONE for entries without a unique identifier.
+     * Not exposed, compiled along with ItemIndex. Empty until then, in which case every entry is treated as non-unique.
+     */
+    TArray<int16> AttributeModifierUniqueBits;
+    TArray<int16> ItemEffectUniqueBits;
+
+    int32 GetAttributeModifierUniqueBit(int32 ModifierIdx) const { return AttributeModifierUniqueBits.IsValidIndex(ModifierIdx) ? AttributeModifierUniqueBits[ModifierIdx] : INDEX_NONE; }
+    int32 GetItemEffectUniqueBit(int32 EffectIdx) const { return ItemEffectUniqueBits.IsValidIndex(EffectIdx) ? ItemEffectUniqueBits[EffectIdx] : INDEX_NONE; }
+
+    /**
+     * SetByCaller tag of each entry in AttributeModifiers, empty for additive modifiers.
+     * Not exposed, compiled along with ItemIndex.
+     */
+    TArray<FGameplayTag> AttributeModifierSetByCallerTags;
+
+    /**
+     * Multiplicative stats spec with every non-unique multiplicative modifier of this item already assigned, for a single copy of the item.
+     * Not exposed, compiled along with ItemIndex. Null if the item has no multiplicative modifiers. Game thread only.
+     */
+    TSharedPtr<const FGameplayEffectSpec> MultiplicativeSpecTemplate;
+
+    /**
+     * Returns a copy of MultiplicativeSpecTemplate using @EffectContext. Invalid if the item has no multiplicative modifiers,
+     * or isn't compiled yet.
+     */
+    FGameplayEffectSpecHandle MakeMultiplicativeEffectSpec(const FGameplayEffectContextHandle& EffectContext) const;
+
     /**
      * Returns true if the inventory component (and owning actor) can buy this item.
      */
@@ -224,6 +314,7 @@ public:
 
     /**
      * Returns the item cost for the inventory component. Takes in account parts of the item that are already owned.
+     * Priced by the inventory's catalog if it holds us, otherwise by walking the item assets.
      */
     float GetItemCostFor(UPredInventoryComponent* InventoryComponent);
 
@@ -235,11 +326,7 @@ protected:
     bool CanAfford(UPredInventoryComponent* InventoryComponent);
 
     /**
-     * Iterates through an inventory recursively to determine if we can buy 
+     * Iterates through an inventory recursively to determine if we can buy. Only for items outside the compiled catalog.
      */
-    float GetItemCostForHelper(TArray<const UPredItem*>& RemainingInventory);
-
-    // Cache variables to avoid repeat recursive calculations.
-    mutable float CachedTotalItemCost = 0.0f;
-    mutable bool HasCachedTotalItemCost = false;
+    float GetItemCostForHelper(TArray<const UPredItem*, TInlineAllocator<8>>& RemainingInventory);
 };
@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemCatalog.h"
+#include "PredItemCatalogSnapshot.h"
+#include "PredItem.h"
+#include "PredAbilityLibrary.h"
+#include "PredItemStats.h"
+#include "Algo/AllOf.h"
+#include "Algo/Sort.h"
+
+/** Catalogs held by the worlds of this process, see FPredItemCatalog::FindOrBuildShared */
+static TArray<TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>> SharedCatalogs;
+
+TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe> FPredItemCatalog::FindOrBuildShared(const TArray<UPredItem*>& SortedItems)
+{
+    check(IsInGameThread());
+
+    SharedCatalogs.RemoveAllSwap([](const TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>& SharedCatalog) { return !SharedCatalog.IsValid(); });
+    for (const TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>& SharedCatalog : SharedCatalogs)
+    {
+        TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> PinnedCatalog = SharedCatalog.Pin();
+        if (PinnedCatalog.IsValid() && PinnedCatalog->Items == SortedItems)
+        {
+            INC_DWORD_STAT(STAT_PredItem_NumSharedCatalogHits);
+            return PinnedCatalog.ToSharedRef();
+        }
+    }
+
+    TSharedRef<FPredItemCatalog, ESPMode::ThreadSafe> NewCatalog = MakeShared<FPredItemCatalog, ESPMode::ThreadSafe>();
+    NewCatalog->Build(SortedItems);
+    SharedCatalogs.Add(NewCatalog);
+
+    // Worker threads read the newest catalog through its snapshot.
+    TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe> Snapshot = FPredCatalogSnapshot::Make(*NewCatalog);
+    FPredCatalogSnapshot::Publish(Snapshot);
+    NewCatalog->SnapshotGeneration = Snapshot->Generation;
+    return NewCatalog;
+}
+
+bool FPredItemCatalog::CanAssignItemIndices(const TArray<UPredItem*>& SortedItems)
+{
+    check(IsInGameThread());
+
+    for (const TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>& SharedCatalog : SharedCatalogs)
+    {
+        TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> PinnedCatalog = SharedCatalog.Pin();
+        if (!PinnedCatalog.IsValid()) { continue; }
+
+        if (PinnedCatalog->Num() != SortedItems.Num()) { return false; }
+        for (int32 i = 0; i < SortedItems.Num(); i++)
+        {
+            if (SortedItems[i] && SortedItems[i] != PinnedCatalog->Items[i]) { return false; }
+        }
+    }
+
+    return true;
+}
+
+TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> FPredItemCatalog::FindSharedForSnapshot(uint32 Generation)
+{
+    check(IsInGameThread());
+
+    for (const TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>& SharedCatalog : SharedCatalogs)
+    {
+        TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> PinnedCatalog = SharedCatalog.Pin();
+        if (PinnedCatalog.IsValid() && PinnedCatalog->SnapshotGeneration == Generation)
+        {
+            return PinnedCatalog;
+        }
+    }
+
+    return nullptr;
+}
+
+void FPredItemCatalog::ReplaceShared(const TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe>& OldCatalog, const TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe>& NewCatalog)
+{
+    check(IsInGameThread());
+
+    for (TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>& SharedCatalog : SharedCatalogs)
+    {
+        if (SharedCatalog.HasSameObject(&OldCatalog.Get()))
+        {
+            SharedCatalog = NewCatalog;
+            return;
+        }
+    }
+    SharedCatalogs.Add(NewCatalog);
+}
+
+TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> FPredItemCatalog::FindSharedForItems(const TArray<UObject*>& LoadedItems)
+{
+    check(IsInGameThread());
+
+    for (const TWeakPtr<const FPredItemCatalog, ESPMode::ThreadSafe>& SharedCatalog : SharedCatalogs)
+    {
+        TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> PinnedCatalog = SharedCatalog.Pin();
+        if (!PinnedCatalog.IsValid() || PinnedCatalog->Num() != LoadedItems.Num()) { continue; }
+
+        // Items keep the index the catalog gave them, so the same set maps every item back onto itself.
+        const bool bSameItems = Algo::AllOf(LoadedItems, [&PinnedCatalog](const UObject* LoadedItem)
+        {
+            const UPredItem* Item = Cast<UPredItem>(LoadedItem);
+            return Item && PinnedCatalog->Items.IsValidIndex(Item->ItemIndex) && PinnedCatalog->Items[Item->ItemIndex] == Item;
+        });
+        if (bSameItems)
+        {
+            INC_DWORD_STAT(STAT_PredItem_NumSharedCatalogHits);
+            return PinnedCatalog;
+        }
+    }
+
+    return nullptr;
+}
+
+const FPredItemCatalog& FPredItemCatalog::GetEmpty()
+{
+    static const FPredItemCatalog EmptyCatalog;
+    return EmptyCatalog;
+}
+
+void FPredItemCatalog::Build(const TArray<UPredItem*>& SortedItems)
+{
+    Items = SortedItems;
+
+    std::vector<FPredEconomyItemDef> EconomyItems(Items.Num());
+    UniqueIdentifiers.Reset();
+    UniqueIdentifierBits.Reset();
+
+    for (int32 i = 0; i < Items.Num(); i++)
+    {
+        check(Items[i]->ItemIndex == i);
+
+        EconomyItems[i].Price = Items[i]->GetItemCost();
+        EconomyItems[i].MaxStackSize = Items[i]->MaxStackSize;
+        for (const UPredItem* RequiredItem : Items[i]->RequiredItems)
+        {
+            // Required items are loaded along with everything else, an unindexed one means the asset is broken.
+            if (ensureMsgf(RequiredItem && RequiredItem->ItemIndex != INDEX_NONE, TEXT("%s requires an item that is not in the catalog"), *Items[i]->GetIdentifierString()))
+            {
+                EconomyItems[i].RequiredItems.push_back(RequiredItem->ItemIndex);
+            }
+        }
+    }
+
+    // Give every unique identifier in use a dense bit, then bake the bits into the items.
+    auto AssignUniqueBit = [this](const FGameplayTag& UniqueIdentifier) -> int16
+    {
+        if (UniqueIdentifier == FGameplayTag::EmptyTag)
+        {
+            return INDEX_NONE;
+        }
+
+        if (const int32* ExistingBit = UniqueIdentifierBits.Find(UniqueIdentifier))
+        {
+            return (int16)*ExistingBit;
+        }
+
+        if (!ensureMsgf(UniqueIdentifiers.Num() < FPredUniqueIdentifierMask::MaxBits, TEXT("More than %d unique identifiers in the item catalog, %s will not be treated as unique. Raise FPredUniqueIdentifierMask::NumWords."), FPredUniqueIdentifierMask::MaxBits, *UniqueIdentifier.ToString()))
+        {
+            return INDEX_NONE;
+        }
+
+        const int32 NewBit = UniqueIdentifiers.Add(UniqueIdentifier);
+        UniqueIdentifierBits.Add(UniqueIdentifier, NewBit);
+        return (int16)NewBit;
+    };
+
+    for (UPredItem* Item : Items)
+    {
+        Item->UniqueIdentifierMask = FPredUniqueIdentifierMask();
+
+        Item->AttributeModifierUniqueBits.SetNumUninitialized(Item->AttributeModifiers.Num());
+        for (int32 ModIdx = 0; ModIdx < Item->AttributeModifiers.Num(); ModIdx++)
+        {
+            const int16 UniqueBit = AssignUniqueBit(Item->AttributeModifiers[ModIdx].UniqueIdentifier);
+            Item->AttributeModifierUniqueBits[ModIdx] = UniqueBit;
+            if (UniqueBit != INDEX_NONE)
+            {
+                Item->UniqueIdentifierMask.SetBit(UniqueBit);
+            }
+        }
+
+        Item->ItemEffectUniqueBits.SetNumUninitialized(Item->ItemEffects.Num());
+        for (int32 EffectIdx = 0; EffectIdx < Item->ItemEffects.Num(); EffectIdx++)
+        {
+            const int16 UniqueBit = AssignUniqueBit(Item->ItemEffects[EffectIdx].UniqueIdentifier);
+            Item->ItemEffectUniqueBits[EffectIdx] = UniqueBit;
+            if (UniqueBit != INDEX_NONE)
+            {
+                Item->UniqueIdentifierMask.SetBit(UniqueBit);
+            }
+        }
+    }
+
+    // Flatten the modifiers into the table the stat preview reads, the unique bits above have to be compiled first.
+    ModifiedAttributes.Reset();
+    ModifierOffsets.SetNumUninitialized(Items.Num() + 1);
+    ModifierAttributeSlots.Reset();
+    ModifierMagnitudes.Reset();
+    ModifierUniqueBits.Reset();
+    ModifierIsMultiplicative.Reset();
+
+    for (int32 i = 0; i < Items.Num(); i++)
+    {
+        const UPredItem* Item = Items[i];
+        EconomyItems[i].UniqueIdentifierMask = Item->UniqueIdentifierMask;
+        ModifierOffsets[i] = ModifierMagnitudes.Num();
+
+        for (int32 ModIdx = 0; ModIdx < Item->AttributeModifiers.Num(); ModIdx++)
+        {
+            const FPredItemAttributeModifier& AttributeModifier = Item->AttributeModifiers[ModIdx].AttributeModifier;
+            ModifierAttributeSlots.Add(ModifiedAttributes.AddUnique(AttributeModifier.Attribute));
+            ModifierMagnitudes.Add(AttributeModifier.GetMagnitude());
+            ModifierUniqueBits.Add(Item->AttributeModifierUniqueBits[ModIdx]);
+            ModifierIsMultiplicative.Add(AttributeModifier.AttributeModType == EPredItemAttributeModType::Multiply);
+        }
+    }
+    ModifierOffsets[Items.Num()] = ModifierMagnitudes.Num();
+
+    Economy.Build(EconomyItems);
+
+    LayoutChecksum = 0;
+    for (const UPredItem* Item : Items)
+    {
+        LayoutChecksum = FCrc::StrCrc32(*Item->GetPrimaryAssetId().PrimaryAssetName.ToString(), LayoutChecksum);
+    }
+    LayoutChecksum = FCrc::MemCrc32(Economy.GetMaxStackSizes().data(), Economy.GetMaxStackSizes().size() * sizeof(uint8), LayoutChecksum);
+    for (const FGameplayTag& UniqueIdentifier : UniqueIdentifiers)
+    {
+        LayoutChecksum = FCrc::StrCrc32(*UniqueIdentifier.ToString(), LayoutChecksum);
+    }
+
+    // Bake the multiplicative modifiers into spec templates, so equipping only has to copy one.
+    // The templates hold a single copy's worth of the non-unique modifiers. Unique ones depend on what else is equipped and are assigned when applying.
+    FGameplayEffectSpecHandle BaseSpec = UPredAbilityLibrary::MakeOutgoingMultiplicativeEffectSpec(FGameplayEffectContextHandle());
+    BaseMultiplicativeSpec = BaseSpec.Data;
+
+    for (UPredItem* Item : Items)
+    {
+        BakeMultiplicativeSpecTemplate(Item);
+    }
+}
+
+void FPredItemCatalog::BakeMultiplicativeSpecTemplate(UPredItem* Item) const
+{
+    Item->AttributeModifierSetByCallerTags.SetNum(Item->AttributeModifiers.Num());
+    Item->MultiplicativeSpecTemplate.Reset();
+
+    FGameplayEffectSpec* SpecTemplate = nullptr;
+    for (int32 ModIdx = 0; ModIdx < Item->AttributeModifiers.Num(); ModIdx++)
+    {
+        const FPredItemAttributeModifier& AttributeModifier = Item->AttributeModifiers[ModIdx].AttributeModifier;
+        if (AttributeModifier.AttributeModType != EPredItemAttributeModType::Multiply || !BaseMultiplicativeSpec.IsValid())
+        {
+            Item->AttributeModifierSetByCallerTags[ModIdx] = FGameplayTag::EmptyTag;
+            continue;
+        }
+
+        const FGameplayTag SetByCallerTag = UPredAbilityLibrary::GetSetByCallerTagForAttribute(AttributeModifier.Attribute);
+        Item->AttributeModifierSetByCallerTags[ModIdx] = SetByCallerTag;
+
+        if (!SpecTemplate)
+        {
+            SpecTemplate = new FGameplayEffectSpec(*BaseMultiplicativeSpec);
+            Item->MultiplicativeSpecTemplate = MakeShareable(SpecTemplate);
+        }
+
+        if (Item->GetAttributeModifierUniqueBit(ModIdx) == INDEX_NONE)
+        {
+            SpecTemplate->SetSetByCallerMagnitude(SetByCallerTag, AttributeModifier.GetMagnitude());
+        }
+    }
+}
+
+FGameplayEffectSpecHandle FPredItemCatalog::MakeMultiplicativeEffectSpec(const FGameplayEffectContextHandle& EffectContext) const
+{
+    if (!BaseMultiplicativeSpec.IsValid())
+    {
+        return UPredAbilityLibrary::MakeOutgoingMultiplicativeEffectSpec(EffectContext);
+    }
+
+    FGameplayEffectSpec* NewSpec = new FGameplayEffectSpec(*BaseMultiplicativeSpec);
+    NewSpec->SetContext(EffectContext);
+    return FGameplayEffectSpecHandle(NewSpec);
+}
+
+float FPredItemCatalog::GetItemCostFor(int32 ItemIndex, TArrayView<uint16> RemainingCounts) const
+{
+    return Economy.GetItemCostFor(ItemIndex, RemainingCounts.GetData(), RemainingCounts.Num());
+}
+
+void FPredItemCatalog::GetAllItemCostsFor(TArrayView<const uint16> OwnedItemCounts, TArray<float>& OutPrices) const
+{
+    OutPrices.SetNumUninitialized(Num());
+
+    // Every item starts from the full inventory, the scratch copy is reset between items rather than reallocated.
+    TArray<uint16, TInlineAllocator<256>> RemainingCounts;
+    RemainingCounts.SetNumUninitialized(Num());
+    Economy.GetAllItemCostsFor(OwnedItemCounts.GetData(), OwnedItemCounts.Num(), OutPrices.GetData(), RemainingCounts.GetData());
+}
+
+void FPredPersonalizedPrices::Build(const FPredItemCatalog& Catalog, TArrayView<const uint16> OwnedItemCounts, float Gold, FPredItemStats& Stats)
+{
+    PRED_ITEM_SCOPE(PersonalizedPrices, Stats);
+
+    Catalog.GetAllItemCostsFor(OwnedItemCounts, PriceByIndex);
+
+    SortedPrices.Reset(Catalog.Num());
+    AffordableItemBits.Init(false, Catalog.Num());
+    for (int32 i = 0; i < Catalog.Num(); i++)
+    {
+        SortedPrices.Add({ PriceByIndex[i], Catalog.Items[i] });
+        AffordableItemBits[i] = PriceByIndex[i] <= Gold;
+    }
+    Algo::SortBy(SortedPrices, &FPredPersonalizedItemPrice::Price);
+}
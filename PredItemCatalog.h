@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "GameplayEffect.h"
+#include "PredItem.h"
+
+class FPredItemStats;
+
+/**
+ * Plain data copy of the loaded items, compiled by the item service once items are loaded.
+ * Indexed by UPredItem::ItemIndex. Apart from the spec templates, nothing in here touches UObjects, so it is safe to read
+ * from worker threads as long as nobody is rebuilding it.
+ *
+ * Item services don't build their own, they get one from FindOrBuildShared: compiled catalogs are immutable and shared by every
+ * match world in the process running the same items, so only the first match pays for compiling it. Worlds running a different
+ * item list can't share the process though, see CanAssignItemIndices.
+ */
+struct PREDECESSOR_API FPredItemCatalog
+{
+    /** Items, indexed by UPredItem::ItemIndex. Only for mapping indices back to items, never dereferenced off the game thread. */
+    TArray<UPredItem*> Items;
+
+    /**
+     * Prices, recipe graph, stack sizes and unique identifiers of every item, as the engine-independent economy core sees them.
+     * Pricing, room checks and purchase consumption all go through it.
+     */
+    FPredItemEconomy Economy;
+
+    /** Every unique identifier used by any item, indexed by its bit in FPredUniqueIdentifierMask */
+    TArray<FGameplayTag> UniqueIdentifiers;
+
+    /** Bit of each unique identifier in UniqueIdentifiers */
+    TMap<FGameplayTag, int32> UniqueIdentifierBits;
+
+    /** Every attribute modified by any item, indexed by the attribute slots of the modifier table below */
+    TArray<FGameplayAttribute> ModifiedAttributes;
+
+    /**
+     * Attribute modifiers of every item, one array per field. The modifiers of item i are
+     * [ModifierOffsets[i], ModifierOffsets[i + 1]), in the same order as the item's AttributeModifiers.
+     */
+    TArray<int32> ModifierOffsets;
+    TArray<int32> ModifierAttributeSlots;
+    TArray<float> ModifierMagnitudes;
+    TArray<int16> ModifierUniqueBits;
+    TArray<bool> ModifierIsMultiplicative;
+
+    /** Multiplicative stats spec with nothing assigned, which the items' spec templates are copied from. Game thread only. */
+    TSharedPtr<const FGameplayEffectSpec> BaseMultiplicativeSpec;
+
+    /** Generation of the FPredCatalogSnapshot published for this catalog, 0 if none was */
+    uint32 SnapshotGeneration = 0;
+
+    /**
+     * Checksum of what item indices and unique identifier bits mean: each item's asset name and stack size, and the unique identifiers.
+     * Data saved by index (inventory snapshots) only carries over to a catalog with the same checksum. Prices are left out on purpose.
+     */
+    uint32 LayoutChecksum = 0;
+
+    /**
+     * Rebuilds the catalog from @SortedItems, which must already have their item indices assigned.
+     * Also compiles each item's unique identifier bits and multiplicative spec template.
+     */
+    void Build(const TArray<UPredItem*>& SortedItems);
+
+    /**
+     * Bakes @Item's multiplicative modifiers into its spec template, at their current magnitudes. Build does this for every item,
+     * it only has to be done again when an item's modifiers change. Game thread only.
+     */
+    void BakeMultiplicativeSpecTemplate(UPredItem* Item) const;
+
+    /**
+     * Returns the catalog of @SortedItems, only building it if no world in the process holds one of exactly these items in this order.
+     * Shared catalogs live as long as a world holds them. Game thread only.
+     */
+    static TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe> FindOrBuildShared(const TArray<UPredItem*>& SortedItems);
+
+    /**
+     * Returns a catalog some world in the process already built from the same set of items as @LoadedItems (in any order),
+     * null if there is none. Its Items are the sorted items to use. Game thread only.
+     */
+    static TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> FindSharedForItems(const TArray<UObject*>& LoadedItems);
+
+    /**
+     * Whether @SortedItems can be given their item indices: true unless a world in the process still holds a catalog of a different
+     * list. Indices and spec templates live on the items themselves, so they can only mean one list at a time. Null entries, items
+     * not resolved yet, match anything. Worlds that can't are left without a catalog. Game thread only.
+     */
+    static bool CanAssignItemIndices(const TArray<UPredItem*>& SortedItems);
+
+    /** Returns the shared catalog whose snapshot has the generation @Generation, null if no world holds it anymore. Game thread only. */
+    static TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> FindSharedForSnapshot(uint32 Generation);
+
+    /**
+     * Shares @NewCatalog in place of @OldCatalog, for worlds loading the same items from now on. Worlds already holding
+     * @OldCatalog keep it until they pick up the new one themselves. Game thread only.
+     */
+    static void ReplaceShared(const TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe>& OldCatalog, const TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe>& NewCatalog);
+
+    /** Catalog with no items, for worlds whose items haven't loaded yet */
+    static const FPredItemCatalog& GetEmpty();
+
+    /** Returns the bit assigned to @UniqueIdentifier, INDEX_NONE if no item uses it (or it is empty) */
+    int32 GetUniqueIdentifierBit(const FGameplayTag& UniqueIdentifier) const
+    {
+        const int32* Bit = UniqueIdentifierBits.Find(UniqueIdentifier);
+        return Bit ? *Bit : INDEX_NONE;
+    }
+
+    /** Returns a copy of BaseMultiplicativeSpec using @EffectContext, for applying modifiers outside of an item's template */
+    FGameplayEffectSpecHandle MakeMultiplicativeEffectSpec(const FGameplayEffectContextHandle& EffectContext) const;
+
+    int32 Num() const { return Items.Num(); }
+
+    /** Whether @Item is in this catalog at its item index, ie. whether it can be priced through Economy */
+    bool Contains(const UPredItem* Item) const { return Item && Items.IsValidIndex(Item->ItemIndex) && Items[Item->ItemIndex] == Item; }
+
+    /** Returns the slot of @Attribute in ModifiedAttributes, INDEX_NONE if no item modifies it */
+    int32 GetAttributeSlot(const FGameplayAttribute& Attribute) const { return ModifiedAttributes.IndexOfByKey(Attribute); }
+
+    TArrayView<const int32> GetRequiredItems(int32 ItemIndex) const
+    {
+        const FPredEconomyItemRange RequiredItems = Economy.GetRequiredItems(ItemIndex);
+        return TArrayView<const int32>(RequiredItems.First, RequiredItems.Num());
+    }
+
+    /** Most copies of @ItemIndex a single inventory slot holds */
+    int32 GetMaxStackSize(int32 ItemIndex) const { return Economy.GetMaxStackSize(ItemIndex); }
+
+    /** Unique identifiers used by @ItemIndex, same as UPredItem::UniqueIdentifierMask */
+    const FPredUniqueIdentifierMask& GetUniqueIdentifierMask(int32 ItemIndex) const { return Economy.GetUniqueIdentifierMask(ItemIndex); }
+
+    /**
+     * Returns the cost of @ItemIndex for an inventory owning @RemainingCounts of each item (indexed by item index).
+     * Owned parts are used up from @RemainingCounts as they discount the item, same as UPredItem::GetItemCostFor.
+     */
+    float GetItemCostFor(int32 ItemIndex, TArrayView<uint16> RemainingCounts) const;
+
+    /**
+     * Prices every item for an inventory owning @OwnedItemCounts of each item, placing the prices (indexed by item index) in @OutPrices.
+     */
+    void GetAllItemCostsFor(TArrayView<const uint16> OwnedItemCounts, TArray<float>& OutPrices) const;
+};
+
+/**
+ * An item's price for a specific inventory, taking in account the parts of it that inventory already owns.
+ */
+struct FPredPersonalizedItemPrice
+{
+    float Price;
+    UPredItem* Item;
+};
+
+/**
+ * Every item's price for one inventory, and which of them that inventory can afford.
+ * Built from plain data only, so it can be built on a worker thread and handed to the inventory afterwards.
+ */
+struct PREDECESSOR_API FPredPersonalizedPrices
+{
+    /** Price of each item, indexed by item index */
+    TArray<float> PriceByIndex;
+
+    /** Every item's price, sorted by price so a gold change is a binary search */
+    TArray<FPredPersonalizedItemPrice> SortedPrices;
+
+    /** One bit per item index, set while the gold the prices were built against covers the item's price */
+    TBitArray<> AffordableItemBits;
+
+    /**
+     * Prices every item in @Catalog for an inventory owning @OwnedItemCounts of each item and holding @Gold.
+     */
+    void Build(const FPredItemCatalog& Catalog, TArrayView<const uint16> OwnedItemCounts, float Gold, FPredItemStats& Stats);
+};
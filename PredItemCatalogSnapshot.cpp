@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemCatalogSnapshot.h"
+#include "PredItemCatalog.h"
+#include "PredItem.h"
+#include "PredLoggingLibrary.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+
+std::atomic<const FPredCatalogSnapshot*> FPredCatalogSnapshot::CurrentSnapshot{ nullptr };
+std::atomic<uint32> FPredCatalogSnapshot::CurrentGeneration{ 0 };
+std::atomic<uint32> FPredCatalogSnapshot::NumAcquiring{ 0 };
+TArray<TSharedPtr<const FPredCatalogSnapshot, ESPMode::ThreadSafe>> FPredCatalogSnapshot::PublishedSnapshots;
+
+TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe> FPredCatalogSnapshot::Make(const FPredItemCatalog& Catalog)
+{
+    check(IsInGameThread());
+
+    TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FPredCatalogSnapshot, ESPMode::ThreadSafe>();
+
+    Snapshot->ItemNames.Reserve(Catalog.Num());
+    for (int32 ItemIndex = 0; ItemIndex < Catalog.Num(); ItemIndex++)
+    {
+        const FName ItemName = Catalog.Items[ItemIndex]->GetPrimaryAssetId().PrimaryAssetName;
+        Snapshot->ItemNames.Add(ItemName);
+        Snapshot->ItemIndicesByName.Add(ItemName, ItemIndex);
+    }
+
+    Snapshot->Economy = Catalog.Economy;
+    Snapshot->UniqueIdentifiers = Catalog.UniqueIdentifiers;
+
+    Snapshot->ModifiedAttributeNames.Reserve(Catalog.ModifiedAttributes.Num());
+    for (const FGameplayAttribute& Attribute : Catalog.ModifiedAttributes)
+    {
+        Snapshot->ModifiedAttributeNames.Add(FName(*Attribute.GetName()));
+    }
+
+    Snapshot->ModifierOffsets = Catalog.ModifierOffsets;
+    Snapshot->ModifierAttributeSlots = Catalog.ModifierAttributeSlots;
+    Snapshot->ModifierMagnitudes = Catalog.ModifierMagnitudes;
+    Snapshot->ModifierUniqueBits = Catalog.ModifierUniqueBits;
+    Snapshot->ModifierIsMultiplicative = Catalog.ModifierIsMultiplicative;
+
+    return Snapshot;
+}
+
+void FPredCatalogSnapshot::Publish(const TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe>& Snapshot)
+{
+    check(IsInGameThread());
+
+    // Only the game thread publishes, so nobody else is bumping the generation.
+    Snapshot->Generation = CurrentGeneration.load(std::memory_order_relaxed) + 1;
+
+    // Held here before it can be loaded, so Acquire can always take a reference to whatever it loads.
+    PublishedSnapshots.Add(Snapshot);
+    CurrentSnapshot.store(&Snapshot.Get());
+    CurrentGeneration.store(Snapshot->Generation, std::memory_order_release);
+
+    ReclaimRetiredSnapshots();
+
+    TRACESTATIC(PredItemLog, Log, "Published catalog snapshot %u with %d items.", Snapshot->Generation, Snapshot->Num());
+}
+
+FPredCatalogSnapshotHandle FPredCatalogSnapshot::Acquire()
+{
+    // Announced before loading, so the publisher holds on to whatever we load until we have our own reference.
+    NumAcquiring.fetch_add(1);
+    const FPredCatalogSnapshot* Snapshot = CurrentSnapshot.load();
+    FPredCatalogSnapshotHandle Handle(Snapshot ? Snapshot->AsShared() : TSharedPtr<const FPredCatalogSnapshot, ESPMode::ThreadSafe>());
+    NumAcquiring.fetch_sub(1);
+
+    return Handle;
+}
+
+void FPredCatalogSnapshot::ReclaimRetiredSnapshots()
+{
+    check(IsInGameThread());
+
+    if (PublishedSnapshots.Num() <= 1) { return; }
+
+    // Anyone who starts acquiring after this already sees the current snapshot. Readers mid-acquire might have loaded a retired
+    // one though, so those wait for the next try. Readers with handles keep their own references, this only drops ours.
+    if (NumAcquiring.load() != 0) { return; }
+
+    const FPredCatalogSnapshot* Current = CurrentSnapshot.load();
+    PublishedSnapshots.RemoveAll([Current](const TSharedPtr<const FPredCatalogSnapshot, ESPMode::ThreadSafe>& Snapshot) { return Snapshot.Get() != Current; });
+}
+
+bool FPredCatalogSnapshotHandle::Refresh()
+{
+    if (IsValid() && IsCurrent()) { return false; }
+
+    const uint32 OldGeneration = GetGeneration();
+    *this = FPredCatalogSnapshot::Acquire();
+    return GetGeneration() != OldGeneration;
+}
+
+static void DumpCatalogSnapshot()
+{
+    // Read from a worker thread on purpose, the snapshot is meant to be used from anywhere.
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, []()
+    {
+        const FPredCatalogSnapshotHandle Snapshot = FPredCatalogSnapshot::Acquire();
+        if (!Snapshot.IsValid())
+        {
+            TRACESTATIC(PredItemLog, Log, "No catalog snapshot has been published.");
+            return;
+        }
+
+        float TotalCost = 0.0f;
+        for (int32 ItemIndex = 0; ItemIndex < Snapshot->Num(); ItemIndex++)
+        {
+            TotalCost += Snapshot->Economy.GetTotalItemCost(ItemIndex);
+        }
+
+        TRACESTATIC(PredItemLog, Log, "Catalog snapshot %u (current %u): %d items, %d modifiers over %d attributes, %d unique identifiers, %.0f gold to buy everything.",
+            Snapshot.GetGeneration(), FPredCatalogSnapshot::GetCurrentGeneration(), Snapshot->Num(), Snapshot->ModifierMagnitudes.Num(),
+            Snapshot->ModifiedAttributeNames.Num(), Snapshot->UniqueIdentifiers.Num(), TotalCost);
+    });
+}
+
+static FAutoConsoleCommand DumpCatalogSnapshotCommand(
+    TEXT("PredItem.DumpCatalogSnapshot"),
+    TEXT("Logs a summary of the current catalog snapshot, read from a worker thread."),
+    FConsoleCommandDelegate::CreateStatic(&DumpCatalogSnapshot));
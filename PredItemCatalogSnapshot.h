@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Templates/SharedPointer.h"
+#include "PredItemEconomy.h"
+
+#include <atomic>
+
+struct FPredItemCatalog;
+class FPredCatalogSnapshotHandle;
+
+/**
+ * Immutable plain data copy of a compiled catalog, for reading items from any thread: prices and recipes (through the economy core),
+ * attribute modifiers, unique identifiers and item names. Nothing in here points at a UObject.
+ *
+ * Snapshots are published RCU-style: the game thread builds a new one and swaps it in with a single atomic store, readers on any
+ * thread pick up whichever one is current with Acquire. A reader's handle keeps its snapshot alive and unchanged for as long as it
+ * holds it, so a swap (a new catalog, a LiveOps change) never pulls data out from under a worker. Handles carry the generation of
+ * their snapshot, so a long-running reader can tell it is out of date and Refresh between work items.
+ *
+ * There is one current snapshot per process, the most recently compiled catalog. Worlds sharing a catalog (see
+ * FPredItemCatalog::FindOrBuildShared) share its snapshot too.
+ */
+struct PREDECESSOR_API FPredCatalogSnapshot : public TSharedFromThis<FPredCatalogSnapshot, ESPMode::ThreadSafe>
+{
+    /** Increases with every publish, starting at 1. 0 is never a published snapshot. */
+    uint32 Generation = 0;
+
+    /** Asset name of each item, indexed by item index */
+    TArray<FName> ItemNames;
+
+    /** Item index of each asset name in ItemNames */
+    TMap<FName, int32> ItemIndicesByName;
+
+    /** Prices, recipes, stack sizes and unique identifier masks, same as FPredItemCatalog::Economy */
+    FPredItemEconomy Economy;
+
+    /** Every unique identifier used by any item, indexed by its bit in FPredUniqueIdentifierMask */
+    TArray<FGameplayTag> UniqueIdentifiers;
+
+    /** Name of every attribute modified by any item, indexed by attribute slot */
+    TArray<FName> ModifiedAttributeNames;
+
+    /** Attribute modifiers of every item, laid out the same as in FPredItemCatalog */
+    TArray<int32> ModifierOffsets;
+    TArray<int32> ModifierAttributeSlots;
+    TArray<float> ModifierMagnitudes;
+    TArray<int16> ModifierUniqueBits;
+    TArray<bool> ModifierIsMultiplicative;
+
+    int32 Num() const { return ItemNames.Num(); }
+
+    /** Returns the item index of the item with the asset name @ItemName, INDEX_NONE if there is none */
+    int32 FindItemIndex(FName ItemName) const
+    {
+        const int32* ItemIndex = ItemIndicesByName.Find(ItemName);
+        return ItemIndex ? *ItemIndex : INDEX_NONE;
+    }
+
+    /** Builds a snapshot of @Catalog, not published yet. Game thread only, the catalog's items are read for their names. */
+    static TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe> Make(const FPredItemCatalog& Catalog);
+
+    /**
+     * Makes @Snapshot the current snapshot, assigning it the next generation. Readers holding older snapshots keep them.
+     * Game thread only.
+     */
+    static void Publish(const TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe>& Snapshot);
+
+    /** Returns a handle to the current snapshot, not valid if nothing was published yet. Lock-free, safe from any thread. */
+    static FPredCatalogSnapshotHandle Acquire();
+
+    /** Generation of the current snapshot, 0 if nothing was published yet. Safe from any thread. */
+    static uint32 GetCurrentGeneration() { return CurrentGeneration.load(std::memory_order_acquire); }
+
+    /**
+     * Drops the game thread's references to snapshots replaced by a publish, once no reader can still be picking them up.
+     * Called on publish and from the item service's tick. Game thread only.
+     */
+    static void ReclaimRetiredSnapshots();
+
+private:
+
+    /** Snapshot handed out by Acquire */
+    static std::atomic<const FPredCatalogSnapshot*> CurrentSnapshot;
+    static std::atomic<uint32> CurrentGeneration;
+
+    /** Readers between loading CurrentSnapshot and taking a reference to it. Retired snapshots are only let go while this is 0. */
+    static std::atomic<uint32> NumAcquiring;
+
+    /** The current snapshot and the retired ones waiting to be reclaimed, which keeps them alive for Acquire. Game thread only. */
+    static TArray<TSharedPtr<const FPredCatalogSnapshot, ESPMode::ThreadSafe>> PublishedSnapshots;
+};
+
+/**
+ * Reference to a catalog snapshot, see FPredCatalogSnapshot. Stays valid, and its snapshot unchanged, however many snapshots are
+ * published after it. Copy it freely between threads.
+ */
+class PREDECESSOR_API FPredCatalogSnapshotHandle
+{
+public:
+
+    FPredCatalogSnapshotHandle() = default;
+
+    explicit FPredCatalogSnapshotHandle(TSharedPtr<const FPredCatalogSnapshot, ESPMode::ThreadSafe> InSnapshot)
+        : Snapshot(MoveTemp(InSnapshot))
+    {
+    }
+
+    bool IsValid() const { return Snapshot.IsValid(); }
+
+    /** Generation of our snapshot, 0 if we don't have one */
+    uint32 GetGeneration() const { return Snapshot.IsValid() ? Snapshot->Generation : 0; }
+
+    /** True if nothing newer than our snapshot was published */
+    bool IsCurrent() const { return GetGeneration() == FPredCatalogSnapshot::GetCurrentGeneration(); }
+
+    /** Moves on to the current snapshot if a newer one was published. Returns true if our snapshot changed. */
+    bool Refresh();
+
+    const FPredCatalogSnapshot& operator*() const { return *Snapshot; }
+    const FPredCatalogSnapshot* operator->() const { return Snapshot.Get(); }
+
+private:
+
+    TSharedPtr<const FPredCatalogSnapshot, ESPMode::ThreadSafe> Snapshot;
+};
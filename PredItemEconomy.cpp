@@ -0,0 +1,524 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemEconomy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void FPredItemEconomy::Build(const std::vector<FPredEconomyItemDef>& Items)
+{
+    const int32_t NumItems = (int32_t)Items.size();
+
+    Prices.resize(NumItems);
+    MaxStackSizes.resize(NumItems);
+    UniqueIdentifierMasks.resize(NumItems);
+    RequiredItemOffsets.resize(NumItems + 1);
+    RequiredItemIndices.clear();
+
+    for (int32_t i = 0; i < NumItems; i++)
+    {
+        Prices[i] = Items[i].Price;
+        MaxStackSizes[i] = (uint8_t)std::min(std::max(Items[i].MaxStackSize, 1), 255);
+        UniqueIdentifierMasks[i] = Items[i].UniqueIdentifierMask;
+
+        RequiredItemOffsets[i] = (int32_t)RequiredItemIndices.size();
+        for (const int32_t RequiredItem : Items[i].RequiredItems)
+        {
+            if (RequiredItem >= 0 && RequiredItem < NumItems)
+            {
+                RequiredItemIndices.push_back(RequiredItem);
+            }
+        }
+    }
+    RequiredItemOffsets[NumItems] = (int32_t)RequiredItemIndices.size();
+
+    // Everything each item is built from, at any depth, so room checks don't have to walk the recipes.
+    NumItemWords = (NumItems + 63) / 64;
+    DescendantBits.assign((size_t)NumItems * NumItemWords, 0);
+    std::vector<bool> Visited(NumItems, false);
+    for (int32_t i = 0; i < NumItems; i++)
+    {
+        BuildDescendantBits(i, Visited);
+    }
+
+    // Recipes expanded once here, so pricing and planning a purchase is a flat walk with no recursion or stack.
+    ExpandedRecipeOffsets.resize(NumItems + 1);
+    ExpandedRecipeItems.clear();
+    ExpandedRecipeSkips.clear();
+    for (int32_t i = 0; i < NumItems; i++)
+    {
+        ExpandedRecipeOffsets[i] = (int32_t)ExpandedRecipeItems.size();
+        ExpandRecipe(i);
+    }
+    ExpandedRecipeOffsets[NumItems] = (int32_t)ExpandedRecipeItems.size();
+
+    BuildTotalItemCosts();
+}
+
+void FPredItemEconomy::SetPrices(const std::vector<float>& NewPrices)
+{
+    // Recipes don't depend on prices, only the totals have to follow.
+    Prices = NewPrices;
+    Prices.resize(MaxStackSizes.size(), 0.0f);
+    BuildTotalItemCosts();
+}
+
+void FPredItemEconomy::BuildTotalItemCosts()
+{
+    // With nothing owned, an item costs itself plus the total cost of every part.
+    std::vector<uint16_t> NoneOwned(Num(), 0);
+    TotalItemCosts.resize(Num());
+    for (int32_t i = 0; i < Num(); i++)
+    {
+        TotalItemCosts[i] = GetItemCostFor(i, NoneOwned.data(), Num());
+    }
+}
+
+void FPredItemEconomy::BuildDescendantBits(int32_t ItemIndex, std::vector<bool>& Visited)
+{
+    if (Visited[ItemIndex]) { return; }
+    Visited[ItemIndex] = true;
+
+    uint64_t* Descendants = DescendantBits.data() + (size_t)ItemIndex * NumItemWords;
+    for (const int32_t RequiredItemIndex : GetRequiredItems(ItemIndex))
+    {
+        BuildDescendantBits(RequiredItemIndex, Visited);
+
+        const uint64_t* RequiredDescendants = GetDescendantBits(RequiredItemIndex);
+        for (int32_t Word = 0; Word < NumItemWords; Word++)
+        {
+            Descendants[Word] |= RequiredDescendants[Word];
+        }
+        Descendants[RequiredItemIndex >> 6] |= uint64_t(1) << (RequiredItemIndex & 63);
+    }
+}
+
+void FPredItemEconomy::ExpandRecipe(int32_t ItemIndex)
+{
+    for (const int32_t RequiredItemIndex : GetRequiredItems(ItemIndex))
+    {
+        const size_t Position = ExpandedRecipeItems.size();
+        ExpandedRecipeItems.push_back(RequiredItemIndex);
+        ExpandedRecipeSkips.push_back(0);
+
+        ExpandRecipe(RequiredItemIndex);
+        ExpandedRecipeSkips[Position] = (int32_t)ExpandedRecipeItems.size();
+    }
+}
+
+float FPredItemEconomy::WalkPurchase(int32_t ItemIndex, uint16_t* RemainingCounts, int32_t NumCounts, std::vector<int32_t>* OutConsumedItems) const
+{
+    // To buy this item, you need the base price. Always.
+    float ReturnedCost = Prices[ItemIndex];
+
+    // Parts come up depth first, same order as recursing through the children would visit them.
+    const int32_t End = ExpandedRecipeOffsets[ItemIndex + 1];
+    for (int32_t Position = ExpandedRecipeOffsets[ItemIndex]; Position < End;)
+    {
+        // If we own the part, use it up so that we don't process it again, and don't pay for it or anything it is built from.
+        const int32_t PartIndex = ExpandedRecipeItems[Position];
+        if (PartIndex < NumCounts && RemainingCounts[PartIndex] > 0)
+        {
+            RemainingCounts[PartIndex]--;
+            if (OutConsumedItems)
+            {
+                OutConsumedItems->push_back(PartIndex);
+            }
+            Position = ExpandedRecipeSkips[Position];
+            continue;
+        }
+
+        ReturnedCost += Prices[PartIndex];
+        Position++;
+    }
+
+    return ReturnedCost;
+}
+
+void FPredItemEconomy::GetAllItemCostsFor(const uint16_t* OwnedItemCounts, int32_t NumOwnedCounts, float* OutPrices, uint16_t* Scratch) const
+{
+    // Every item starts from the full inventory, the scratch copy is reset between items rather than reallocated.
+    const int32_t NumCopied = std::min(NumOwnedCounts, Num());
+    std::fill(Scratch + NumCopied, Scratch + Num(), (uint16_t)0);
+
+    for (int32_t i = 0; i < Num(); i++)
+    {
+        if (NumCopied > 0)
+        {
+            std::memcpy(Scratch, OwnedItemCounts, NumCopied * sizeof(uint16_t));
+        }
+        OutPrices[i] = GetItemCostFor(i, Scratch, Num());
+    }
+}
+
+bool FPredItemEconomy::HasRoomForItem(const FPredEconomyInventory& Inventory, int32_t ItemIndex) const
+{
+    bool bNeedsPlan = false;
+    if (HasRoomWithoutPlan(Inventory, ItemIndex, bNeedsPlan) || !bNeedsPlan)
+    {
+        return !bNeedsPlan;
+    }
+
+    PlanPurchase(Inventory, ItemIndex, Inventory.ScratchPlan);
+    return Inventory.ScratchPlan.bFreesSlot;
+}
+
+bool FPredItemEconomy::HasRoomForPurchase(const FPredEconomyInventory& Inventory, const FPredPurchasePlan& Plan) const
+{
+    bool bNeedsPlan = false;
+    return HasRoomWithoutPlan(Inventory, Plan.ItemIndex, bNeedsPlan) || (bNeedsPlan && Plan.bFreesSlot);
+}
+
+bool FPredItemEconomy::HasRoomWithoutPlan(const FPredEconomyInventory& Inventory, int32_t ItemIndex, bool& bOutNeedsPlan) const
+{
+    bOutNeedsPlan = false;
+
+    // An empty slot can take us, as can a stack of this item with room left.
+    if (Inventory.NumEmptySlots > 0 || Inventory.FindStackWithRoom(*this, ItemIndex) != NoItem)
+    {
+        return true;
+    }
+
+    // Otherwise the parts we use up have to free a slot for us, and only parts we own get used up.
+    const uint64_t* Descendants = GetDescendantBits(ItemIndex);
+    const int32_t NumWords = std::min(NumItemWords, (int32_t)Inventory.OwnedItemBits.size());
+    uint64_t AnyOwned = 0;
+    uint64_t AnyStacked = 0;
+    for (int32_t Word = 0; Word < NumWords; Word++)
+    {
+        const uint64_t Owned = Descendants[Word] & Inventory.OwnedItemBits[Word];
+        AnyOwned |= Owned;
+        AnyStacked |= Owned & ~Inventory.SlotFreeingItemBits[Word];
+    }
+
+    // A purchase always uses up at least one owned part when there are any. If every one of them empties its slot, that's our room.
+    // Otherwise some sit in stacks, and it depends on which parts the purchase actually uses up.
+    bOutNeedsPlan = AnyOwned != 0 && AnyStacked != 0;
+    return AnyOwned != 0 && AnyStacked == 0;
+}
+
+void FPredItemEconomy::PlanPurchase(const FPredEconomyInventory& Inventory, int32_t ItemIndex, FPredPurchasePlan& OutPlan) const
+{
+    OutPlan.ItemIndex = ItemIndex;
+    OutPlan.ConsumedItems.clear();
+    OutPlan.ConsumedSlots.clear();
+    OutPlan.bFreesSlot = false;
+
+    const int32_t NumCopied = std::min((int32_t)Inventory.OwnedItemCounts.size(), Num());
+    OutPlan.RemainingCounts.assign(Inventory.OwnedItemCounts.begin(), Inventory.OwnedItemCounts.begin() + NumCopied);
+    OutPlan.RemainingCounts.resize(Num(), 0);
+    OutPlan.Cost = WalkPurchase(ItemIndex, OutPlan.RemainingCounts.data(), Num(), &OutPlan.ConsumedItems);
+
+    // Copies come out of the first slots holding them. Every copy of an item is placed the first time it comes up.
+    for (const int32_t ConsumedItemIndex : OutPlan.ConsumedItems)
+    {
+        const bool bPlaced = std::any_of(OutPlan.ConsumedSlots.begin(), OutPlan.ConsumedSlots.end(),
+            [ConsumedItemIndex](const FPredConsumedSlot& ConsumedSlot) { return ConsumedSlot.ItemIndex == ConsumedItemIndex; });
+        if (bPlaced) { continue; }
+
+        // Copies owned without a slot (loadouts) can't be taken out of one, they are left alone like RemoveItem leaves them.
+        int32_t NumToPlace = Inventory.GetOwnedCount(ConsumedItemIndex) - OutPlan.RemainingCounts[ConsumedItemIndex];
+        for (int32_t Slot = 0; Slot < Inventory.NumSlots() && NumToPlace > 0; Slot++)
+        {
+            if (Inventory.SlotItems[Slot] != ConsumedItemIndex) { continue; }
+
+            const int32_t Count = std::min(NumToPlace, (int32_t)Inventory.SlotCounts[Slot]);
+            OutPlan.ConsumedSlots.push_back({ Slot, ConsumedItemIndex, Count });
+            OutPlan.bFreesSlot |= Count == Inventory.SlotCounts[Slot];
+            NumToPlace -= Count;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPredEconomyInventory
+//////////////////////////////////////////////////////////////////////////
+
+void FPredEconomyInventory::Init(int32_t NumSlots, int32_t NumItems, float InGold)
+{
+    ResetSlots(NumSlots, NumItems);
+    AppliedUniqueIdentifiers = FPredUniqueIdentifierMask();
+    UniqueProviders.clear();
+    Gold = InGold;
+    LastUniqueItemID = 0;
+}
+
+void FPredEconomyInventory::ResetSlots(int32_t NumSlots, int32_t NumItems)
+{
+    SlotItems.assign(NumSlots, FPredItemEconomy::NoItem);
+    SlotCounts.assign(NumSlots, 0);
+    SlotUniqueIDs.assign(NumSlots, FPredItemEconomy::NoItem);
+    NumEmptySlots = NumSlots;
+    OwnedItemCounts.assign(NumItems, 0);
+    OwnedItemBits.assign((NumItems + 63) / 64, 0);
+    SlotFreeingItemBits.assign((NumItems + 63) / 64, 0);
+}
+
+void FPredEconomyInventory::AdjustOwnedCount(int32_t ItemIndex, int32_t Delta)
+{
+    if (ItemIndex < 0) { return; }
+
+    if (ItemIndex >= (int32_t)OwnedItemCounts.size())
+    {
+        OwnedItemCounts.resize(ItemIndex + 1, 0);
+    }
+
+    OwnedItemCounts[ItemIndex] = (uint16_t)std::min(std::max((int32_t)OwnedItemCounts[ItemIndex] + Delta, 0), 65535);
+    UpdateItemBits(ItemIndex);
+}
+
+void FPredEconomyInventory::UpdateItemBits(int32_t ItemIndex)
+{
+    const size_t Word = ItemIndex >> 6;
+    const uint64_t Bit = uint64_t(1) << (ItemIndex & 63);
+    if (Word >= OwnedItemBits.size())
+    {
+        OwnedItemBits.resize(Word + 1, 0);
+        SlotFreeingItemBits.resize(Word + 1, 0);
+    }
+
+    const int32_t FirstSlot = FindSlotFromItem(ItemIndex);
+    OwnedItemBits[Word] = GetOwnedCount(ItemIndex) > 0 ? OwnedItemBits[Word] | Bit : OwnedItemBits[Word] & ~Bit;
+    SlotFreeingItemBits[Word] = FirstSlot != FPredItemEconomy::NoItem && SlotCounts[FirstSlot] == 1 ? SlotFreeingItemBits[Word] | Bit : SlotFreeingItemBits[Word] & ~Bit;
+}
+
+void FPredEconomyInventory::SetSlot(int32_t Slot, int32_t ItemIndex, int32_t Count, int32_t UniqueItemID)
+{
+    const int32_t OldItemIndex = SlotItems[Slot];
+    const int32_t OldCount = SlotCounts[Slot];
+
+    const bool bEmpty = ItemIndex < 0 || Count <= 0;
+    SlotItems[Slot] = bEmpty ? FPredItemEconomy::NoItem : ItemIndex;
+    SlotCounts[Slot] = bEmpty ? 0 : (uint8_t)std::min(Count, 255);
+    SlotUniqueIDs[Slot] = bEmpty ? FPredItemEconomy::NoItem : UniqueItemID;
+    NumEmptySlots += (OldItemIndex < 0 ? 0 : 1) - (bEmpty ? 0 : 1);
+
+    // Counts are adjusted once the slot holds its new contents, so the bits see where the first copies are now.
+    if (OldItemIndex >= 0)
+    {
+        AdjustOwnedCount(OldItemIndex, -OldCount);
+    }
+    if (!bEmpty)
+    {
+        AdjustOwnedCount(ItemIndex, SlotCounts[Slot]);
+    }
+}
+
+int32_t FPredEconomyInventory::FindStackWithRoom(const FPredItemEconomy& Economy, int32_t ItemIndex) const
+{
+    if (!Economy.IsStackable(ItemIndex)) { return FPredItemEconomy::NoItem; }
+
+    const int32_t MaxStackSize = Economy.GetMaxStackSize(ItemIndex);
+    for (int32_t Slot = 0; Slot < NumSlots(); Slot++)
+    {
+        if (SlotItems[Slot] == ItemIndex && SlotCounts[Slot] < MaxStackSize)
+        {
+            return Slot;
+        }
+    }
+    return FPredItemEconomy::NoItem;
+}
+
+int32_t FPredEconomyInventory::FindEmptySlot() const
+{
+    return FindSlotFromItem(FPredItemEconomy::NoItem);
+}
+
+int32_t FPredEconomyInventory::FindSlotFromItem(int32_t ItemIndex) const
+{
+    for (int32_t Slot = 0; Slot < NumSlots(); Slot++)
+    {
+        if (SlotItems[Slot] == ItemIndex)
+        {
+            return Slot;
+        }
+    }
+    return FPredItemEconomy::NoItem;
+}
+
+void FPredEconomyInventory::ClaimUniqueIdentifier(int32_t UniqueItemID, int32_t UniqueBit)
+{
+    if (UniqueBit >= (int32_t)UniqueProviders.size())
+    {
+        UniqueProviders.resize(UniqueBit + 1, FPredItemEconomy::NoItem);
+    }
+
+    AppliedUniqueIdentifiers.SetBit(UniqueBit);
+    UniqueProviders[UniqueBit] = UniqueItemID;
+}
+
+FPredUniqueIdentifierMask FPredEconomyInventory::ClaimUnappliedUniqueIdentifiers(int32_t UniqueItemID, const FPredUniqueIdentifierMask& Mask)
+{
+    const FPredUniqueIdentifierMask Unapplied = Mask.Without(AppliedUniqueIdentifiers);
+    for (int32_t Word = 0; Word < FPredUniqueIdentifierMask::NumWords; Word++)
+    {
+        for (uint64_t Bits = Unapplied.Words[Word]; Bits != 0; Bits &= Bits - 1)
+        {
+            int32_t Bit = 0;
+            while (((Bits >> Bit) & 1) == 0) { Bit++; }
+            ClaimUniqueIdentifier(UniqueItemID, Word * 64 + Bit);
+        }
+    }
+    return Unapplied;
+}
+
+FPredUniqueIdentifierMask FPredEconomyInventory::GetProvidedUniqueIdentifiers(int32_t UniqueItemID, const FPredUniqueIdentifierMask& Mask) const
+{
+    FPredUniqueIdentifierMask Provided;
+    for (int32_t Bit = 0; Bit < (int32_t)UniqueProviders.size(); Bit++)
+    {
+        if (Mask.IsBitSet(Bit) && IsProviderOfUniqueIdentifier(UniqueItemID, Bit))
+        {
+            Provided.SetBit(Bit);
+        }
+    }
+    return Provided;
+}
+
+void FPredEconomyInventory::RegenerateUniqueIdentifiers(const FPredItemEconomy& Economy)
+{
+    for (int32_t Slot = 0; Slot < NumSlots(); Slot++)
+    {
+        if (IsSlotEmpty(Slot)) { continue; }
+
+        const FPredUniqueIdentifierMask& Mask = Economy.GetUniqueIdentifierMask(SlotItems[Slot]);
+        if (!Mask.IsSubsetOf(AppliedUniqueIdentifiers))
+        {
+            ClaimUnappliedUniqueIdentifiers(SlotUniqueIDs[Slot], Mask);
+        }
+    }
+}
+
+int32_t FPredEconomyInventory::EquipItem(const FPredItemEconomy& Economy, int32_t ItemIndex, int32_t Count)
+{
+    const int32_t MaxStackSize = Economy.GetMaxStackSize(ItemIndex);
+    int32_t RemainingCount = std::max(Count, 1);
+
+    // Top up the stacks we already have before taking up new slots. The stack's provider keeps its unique identifiers.
+    int32_t Slot = FPredItemEconomy::NoItem;
+    while (RemainingCount > 0 && (Slot = FindStackWithRoom(Economy, ItemIndex)) != FPredItemEconomy::NoItem)
+    {
+        const int32_t CountToAdd = std::min(RemainingCount, MaxStackSize - SlotCounts[Slot]);
+        SetSlot(Slot, ItemIndex, SlotCounts[Slot] + CountToAdd, SlotUniqueIDs[Slot]);
+        RemainingCount -= CountToAdd;
+    }
+
+    while (RemainingCount > 0 && (Slot = FindEmptySlot()) != FPredItemEconomy::NoItem)
+    {
+        const int32_t CountToAdd = std::min(RemainingCount, MaxStackSize);
+        SetSlot(Slot, ItemIndex, CountToAdd, ++LastUniqueItemID);
+        ClaimUnappliedUniqueIdentifiers(SlotUniqueIDs[Slot], Economy.GetUniqueIdentifierMask(ItemIndex));
+        RemainingCount -= CountToAdd;
+    }
+
+    return RemainingCount;
+}
+
+int32_t FPredEconomyInventory::RemoveItem(const FPredItemEconomy& Economy, int32_t ItemIndex, int32_t Count)
+{
+    int32_t RemainingCount = std::max(Count, 1);
+    int32_t Slot = FindSlotFromItem(ItemIndex);
+    while (RemainingCount > 0 && Slot != FPredItemEconomy::NoItem)
+    {
+        const int32_t CountToRemove = std::min(RemainingCount, (int32_t)SlotCounts[Slot]);
+        RemoveItemAtSlot(Economy, CountToRemove, Slot);
+        RemainingCount -= CountToRemove;
+
+        Slot = FindSlotFromItem(ItemIndex);
+    }
+    return RemainingCount;
+}
+
+void FPredEconomyInventory::RemoveItemAtSlot(const FPredItemEconomy& Economy, int32_t Count, int32_t Slot)
+{
+    // An emptied slot gives up what it provided, let the rest of the inventory pick it up.
+    if (TakeFromSlot(Economy, Count, Slot))
+    {
+        RegenerateUniqueIdentifiers(Economy);
+    }
+}
+
+bool FPredEconomyInventory::TakeFromSlot(const FPredItemEconomy& Economy, int32_t Count, int32_t Slot)
+{
+    if (IsSlotEmpty(Slot)) { return false; }
+
+    // Only part of the stack is going, the rest stays along with any unique identifiers it provides.
+    const int32_t OldStackCount = SlotCounts[Slot];
+    if (Count > 0 && Count < OldStackCount)
+    {
+        SetSlot(Slot, SlotItems[Slot], OldStackCount - Count, SlotUniqueIDs[Slot]);
+        return false;
+    }
+
+    const FPredUniqueIdentifierMask Provided = GetProvidedUniqueIdentifiers(SlotUniqueIDs[Slot], Economy.GetUniqueIdentifierMask(SlotItems[Slot]));
+    for (int32_t Word = 0; Word < FPredUniqueIdentifierMask::NumWords; Word++)
+    {
+        AppliedUniqueIdentifiers.Words[Word] &= ~Provided.Words[Word];
+    }
+
+    SetSlot(Slot, FPredItemEconomy::NoItem, 0, FPredItemEconomy::NoItem);
+    return true;
+}
+
+void FPredEconomyInventory::RemoveConsumedSlots(const FPredItemEconomy& Economy, const FPredPurchasePlan& Plan)
+{
+    // Whatever the emptied slots provided is handed on once they are all gone, to the first remaining slot using it,
+    // same as handing it on after every slot would end up.
+    bool bEmptiedSlot = false;
+    for (const FPredConsumedSlot& ConsumedSlot : Plan.ConsumedSlots)
+    {
+        bEmptiedSlot |= TakeFromSlot(Economy, ConsumedSlot.Count, ConsumedSlot.Slot);
+    }
+
+    if (bEmptiedSlot)
+    {
+        RegenerateUniqueIdentifiers(Economy);
+    }
+}
+
+bool FPredEconomyInventory::CanBuyItem(const FPredItemEconomy& Economy, int32_t ItemIndex, float& OutCost) const
+{
+    if (!Economy.IsValidItem(ItemIndex)) { return false; }
+
+    Economy.PlanPurchase(*this, ItemIndex, ScratchPlan);
+    OutCost = ScratchPlan.Cost;
+    return OutCost <= Gold && Economy.HasRoomForPurchase(*this, ScratchPlan);
+}
+
+bool FPredEconomyInventory::TryBuyItem(const FPredItemEconomy& Economy, int32_t ItemIndex, float& OutCost)
+{
+    // Determine how much we're paying for this item before the parts are used up (which would make it more expensive).
+    if (!CanBuyItem(Economy, ItemIndex, OutCost))
+    {
+        return false;
+    }
+
+    // CanBuyItem left its plan behind, take out exactly the slots it priced with.
+    RemoveConsumedSlots(Economy, ScratchPlan);
+
+    EquipItem(Economy, ItemIndex, 1);
+    Gold -= OutCost;
+    return true;
+}
+
+bool FPredEconomyInventory::TrySellItem(const FPredItemEconomy& Economy, int32_t Slot, int32_t& OutPrice)
+{
+    if (Slot < 0 || Slot >= NumSlots() || IsSlotEmpty(Slot)) { return false; }
+
+    // Selling for a fraction of the cost.
+    OutPrice = (int32_t)std::floor(Economy.GetTotalItemCost(SlotItems[Slot]) * SellModifier);
+    RemoveItemAtSlot(Economy, 1, Slot);
+    Gold += OutPrice;
+    return true;
+}
+
+size_t FPredEconomyInventory::GetAllocatedSize() const
+{
+    return SlotItems.capacity() * sizeof(int32_t) + SlotCounts.capacity() * sizeof(uint8_t) + SlotUniqueIDs.capacity() * sizeof(int32_t)
+        + OwnedItemCounts.capacity() * sizeof(uint16_t) + (OwnedItemBits.capacity() + SlotFreeingItemBits.capacity()) * sizeof(uint64_t)
+        + UniqueProviders.capacity() * sizeof(int32_t)
+        + ScratchPlan.ConsumedItems.capacity() * sizeof(int32_t) + ScratchPlan.ConsumedSlots.capacity() * sizeof(FPredConsumedSlot)
+        + ScratchPlan.RemainingCounts.capacity() * sizeof(uint16_t);
+}
@@ -0,0 +1,433 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Deliberately plain C++: no engine headers, so the economy can be built and benchmarked on its own (see PredItemEconomyBenchmark.cpp).
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef PREDECESSOR_API
+#define PREDECESSOR_API
+#endif
+
+class FPredItemEconomy;
+
+/**
+ * Set of unique identifiers, one bit per identifier in the item catalog (see FPredItemCatalog::UniqueIdentifiers).
+ * Fixed size so it stays a couple of words and never allocates.
+ */
+struct FPredUniqueIdentifierMask
+{
+    static constexpr int32_t NumWords = 2;
+    static constexpr int32_t MaxBits = NumWords * 64;
+
+    uint64_t Words[NumWords] = {};
+
+    void SetBit(int32_t Bit) { Words[Bit >> 6] |= (uint64_t(1) << (Bit & 63)); }
+    void ClearBit(int32_t Bit) { Words[Bit >> 6] &= ~(uint64_t(1) << (Bit & 63)); }
+    bool IsBitSet(int32_t Bit) const { return (Words[Bit >> 6] & (uint64_t(1) << (Bit & 63))) != 0; }
+
+    bool Intersects(const FPredUniqueIdentifierMask& Other) const
+    {
+        uint64_t Overlap = 0;
+        for (int32_t i = 0; i < NumWords; i++)
+        {
+            Overlap |= Words[i] & Other.Words[i];
+        }
+        return Overlap != 0;
+    }
+
+    /** True if every bit set in this mask is also set in @Other */
+    bool IsSubsetOf(const FPredUniqueIdentifierMask& Other) const
+    {
+        uint64_t Missing = 0;
+        for (int32_t i = 0; i < NumWords; i++)
+        {
+            Missing |= Words[i] & ~Other.Words[i];
+        }
+        return Missing == 0;
+    }
+
+    /** Returns the bits set in this mask but not in @Other */
+    FPredUniqueIdentifierMask Without(const FPredUniqueIdentifierMask& Other) const
+    {
+        FPredUniqueIdentifierMask Result;
+        for (int32_t i = 0; i < NumWords; i++)
+        {
+            Result.Words[i] = Words[i] & ~Other.Words[i];
+        }
+        return Result;
+    }
+
+    void Append(const FPredUniqueIdentifierMask& Other)
+    {
+        for (int32_t i = 0; i < NumWords; i++)
+        {
+            Words[i] |= Other.Words[i];
+        }
+    }
+
+    bool IsEmpty() const
+    {
+        uint64_t Any = 0;
+        for (int32_t i = 0; i < NumWords; i++)
+        {
+            Any |= Words[i];
+        }
+        return Any == 0;
+    }
+
+    bool operator==(const FPredUniqueIdentifierMask& Other) const
+    {
+        uint64_t Difference = 0;
+        for (int32_t i = 0; i < NumWords; i++)
+        {
+            Difference |= Words[i] ^ Other.Words[i];
+        }
+        return Difference == 0;
+    }
+    bool operator!=(const FPredUniqueIdentifierMask& Other) const { return !(*this == Other); }
+};
+
+/**
+ * An item as far as the economy cares: what it costs, what it is built from, how it stacks and which unique identifiers it uses.
+ */
+struct FPredEconomyItemDef
+{
+    /** Price of the item itself, not accounting for its required items */
+    float Price = 0.0f;
+
+    /** Indices of the required items, repeated for items required more than once */
+    std::vector<int32_t> RequiredItems;
+
+    int32_t MaxStackSize = 1;
+
+    FPredUniqueIdentifierMask UniqueIdentifierMask;
+};
+
+/**
+ * Contiguous run of item indices, for iterating required items without copying them.
+ */
+struct FPredEconomyItemRange
+{
+    const int32_t* First = nullptr;
+    const int32_t* Last = nullptr;
+
+    const int32_t* begin() const { return First; }
+    const int32_t* end() const { return Last; }
+    int32_t Num() const { return (int32_t)(Last - First); }
+};
+
+/** Copies of @ItemIndex a purchase takes out of @Slot */
+struct FPredConsumedSlot
+{
+    int32_t Slot = -1;
+    int32_t ItemIndex = -1;
+    int32_t Count = 0;
+};
+
+/**
+ * What buying an item does to an inventory, worked out in a single walk of its recipe: what it costs, which owned parts it uses up and
+ * exactly which slots they come out of. Pricing and consumption come from the same walk, so what we charge and what we take always agree.
+ * Meant to be kept around and reused, planning doesn't allocate once its arrays have grown.
+ */
+struct FPredPurchasePlan
+{
+    int32_t ItemIndex = -1;
+    float Cost = 0.0f;
+
+    /** One item index per copy used up, in recipe order */
+    std::vector<int32_t> ConsumedItems;
+
+    /** Slots the used up copies come out of, the first slots holding them first (like RemoveItem takes them) */
+    std::vector<FPredConsumedSlot> ConsumedSlots;
+
+    /** True if taking ConsumedSlots out empties at least one slot */
+    bool bFreesSlot = false;
+
+    /** How many of each item the inventory owns after the purchase, not counting the purchase itself */
+    std::vector<uint16_t> RemainingCounts;
+};
+
+/**
+ * Plain data inventory: what each slot holds, how many of each item that adds up to, gold and which slot provides each unique identifier.
+ *
+ * UPredInventoryComponent keeps one of these in step with its slots and asks the economy about it, applying effects on top.
+ * Simulations (the inventory replay, the benchmark) drive it directly with the whole operations below, which follow the same rules as the component.
+ */
+struct PREDECESSOR_API FPredEconomyInventory
+{
+    /** Item index held by each slot, FPredItemEconomy::NoItem for empty slots */
+    std::vector<int32_t> SlotItems;
+
+    /** Stack count of each slot, 0 for empty slots */
+    std::vector<uint8_t> SlotCounts;
+
+    /** Identifies the copy of the item held by each slot within this inventory, handed out when it is equipped */
+    std::vector<int32_t> SlotUniqueIDs;
+
+    /** How many of each item we own, indexed by item index. Grown on demand. */
+    std::vector<uint16_t> OwnedItemCounts;
+
+    /** One bit per item index, set while we own at least one of that item */
+    std::vector<uint64_t> OwnedItemBits;
+
+    /**
+     * One bit per item index, set while using up one copy of that item would empty a slot: the first slot holding it (copies
+     * come out of that one first) holds a single copy.
+     */
+    std::vector<uint64_t> SlotFreeingItemBits;
+
+    /** How many slots are empty, kept in step by SetSlot */
+    int32_t NumEmptySlots = 0;
+
+    /** Unique identifiers currently applied */
+    FPredUniqueIdentifierMask AppliedUniqueIdentifiers;
+
+    /** Unique ID of the slot providing each unique identifier, indexed by bit. Only valid where the bit is set in AppliedUniqueIdentifiers. */
+    std::vector<int32_t> UniqueProviders;
+
+    /** Only used by simulations, a real inventory's gold lives on its owner */
+    float Gold = 0.0f;
+    float SellModifier = 0.75f;
+
+    /** Last unique ID handed out by EquipItem */
+    int32_t LastUniqueItemID = 0;
+
+    /** Empties the inventory down to @NumSlots empty slots, tracking counts for @NumItems items, with @InGold */
+    void Init(int32_t NumSlots, int32_t NumItems, float InGold);
+
+    /** Empties the slots and owned counts only, leaving unique identifiers and gold alone (eg. before refilling the slots from replication) */
+    void ResetSlots(int32_t NumSlots, int32_t NumItems);
+
+    int32_t NumSlots() const { return (int32_t)SlotItems.size(); }
+    bool IsSlotEmpty(int32_t Slot) const { return SlotItems[Slot] < 0; }
+
+    int32_t GetOwnedCount(int32_t ItemIndex) const { return ItemIndex >= 0 && ItemIndex < (int32_t)OwnedItemCounts.size() ? OwnedItemCounts[ItemIndex] : 0; }
+
+    bool OwnsItem(int32_t ItemIndex) const
+    {
+        return ItemIndex >= 0 && (size_t)(ItemIndex >> 6) < OwnedItemBits.size() && (OwnedItemBits[ItemIndex >> 6] & (uint64_t(1) << (ItemIndex & 63))) != 0;
+    }
+
+    /** Adjusts how many of @ItemIndex we own by @Delta, without touching the slots (eg. loadouts, which have none) */
+    void AdjustOwnedCount(int32_t ItemIndex, int32_t Delta);
+
+    /** Places @Count copies of @ItemIndex (NoItem to empty it) in @Slot, keeping the owned counts in step */
+    void SetSlot(int32_t Slot, int32_t ItemIndex, int32_t Count, int32_t UniqueItemID);
+
+    /** Returns the first slot holding @ItemIndex with room left on its stack, NoItem if there is none */
+    int32_t FindStackWithRoom(const FPredItemEconomy& Economy, int32_t ItemIndex) const;
+
+    /** Returns the first empty slot, NoItem if there is none */
+    int32_t FindEmptySlot() const;
+
+    /** Returns the first slot holding @ItemIndex, NoItem if there is none */
+    int32_t FindSlotFromItem(int32_t ItemIndex) const;
+
+    bool IsUniqueIdentifierApplied(int32_t UniqueBit) const { return AppliedUniqueIdentifiers.IsBitSet(UniqueBit); }
+
+    bool IsProviderOfUniqueIdentifier(int32_t UniqueItemID, int32_t UniqueBit) const
+    {
+        return IsUniqueIdentifierApplied(UniqueBit) && UniqueProviders[UniqueBit] == UniqueItemID;
+    }
+
+    /** Marks @UniqueBit as applied, provided by the copy @UniqueItemID */
+    void ClaimUniqueIdentifier(int32_t UniqueItemID, int32_t UniqueBit);
+
+    void ReleaseUniqueIdentifier(int32_t UniqueBit) { AppliedUniqueIdentifiers.ClearBit(UniqueBit); }
+
+    /** Claims every identifier in @Mask nobody applies yet for @UniqueItemID, returning the ones it got */
+    FPredUniqueIdentifierMask ClaimUnappliedUniqueIdentifiers(int32_t UniqueItemID, const FPredUniqueIdentifierMask& Mask);
+
+    /** Returns the identifiers in @Mask that @UniqueItemID is providing */
+    FPredUniqueIdentifierMask GetProvidedUniqueIdentifiers(int32_t UniqueItemID, const FPredUniqueIdentifierMask& Mask) const;
+
+    /** Gives every unapplied identifier to the first slot (in slot order) whose item uses it, like the component does after a removal */
+    void RegenerateUniqueIdentifiers(const FPredItemEconomy& Economy);
+
+    /** Equips @Count copies of @ItemIndex, topping up stacks first and then taking empty slots. Returns how many copies didn't fit. */
+    int32_t EquipItem(const FPredItemEconomy& Economy, int32_t ItemIndex, int32_t Count);
+
+    /** Removes @Count copies of @ItemIndex, starting with the first slot holding it. Returns how many copies we didn't have. */
+    int32_t RemoveItem(const FPredItemEconomy& Economy, int32_t ItemIndex, int32_t Count);
+
+    /** Removes @Count copies from @Slot (its whole stack if @Count is 0), handing its unique identifiers on once it empties */
+    void RemoveItemAtSlot(const FPredItemEconomy& Economy, int32_t Count, int32_t Slot);
+
+    /**
+     * Takes the copies @Plan uses up out of their slots in one go, handing unique identifiers on once at the end rather than per slot.
+     * @Plan must have been made against this inventory as it is now.
+     */
+    void RemoveConsumedSlots(const FPredItemEconomy& Economy, const FPredPurchasePlan& Plan);
+
+    /** Returns true if there is room for @ItemIndex and we can afford it, placing its price in @OutCost */
+    bool CanBuyItem(const FPredItemEconomy& Economy, int32_t ItemIndex, float& OutCost) const;
+
+    /**
+     * Buys @ItemIndex if there is room and we can afford it: the owned parts it is built from are used up and the rest of the price is paid.
+     * Places the price in @OutCost. Returns false (changing nothing) if it can't be bought.
+     */
+    bool TryBuyItem(const FPredItemEconomy& Economy, int32_t ItemIndex, float& OutCost);
+
+    /** Sells one copy from @Slot for its total cost times SellModifier, rounded down. Returns false if the slot is empty. */
+    bool TrySellItem(const FPredItemEconomy& Economy, int32_t Slot, int32_t& OutPrice);
+
+    /** Heap memory held by the inventory, in bytes */
+    size_t GetAllocatedSize() const;
+
+private:
+
+    friend class FPredItemEconomy;
+
+    /** Updates the OwnedItemBits and SlotFreeingItemBits bits of @ItemIndex from its count and slots */
+    void UpdateItemBits(int32_t ItemIndex);
+
+    /** Takes @Count copies out of @Slot (its whole stack if @Count is 0) without handing on unique identifiers. Returns true if it emptied. */
+    bool TakeFromSlot(const FPredItemEconomy& Economy, int32_t Count, int32_t Slot);
+
+    /** Scratch plan for room checks and purchases, kept around so operations don't allocate */
+    mutable FPredPurchasePlan ScratchPlan;
+};
+
+/**
+ * Engine-independent core of the item economy: the recipe graph, what an item costs a given inventory, whether it has room for it,
+ * which owned parts a purchase uses up, and who provides each unique identifier.
+ *
+ * Built once from plain item definitions and immutable afterwards, so it is safe to share between threads.
+ * FPredItemCatalog compiles one from the loaded items and wraps it for the engine side.
+ */
+class PREDECESSOR_API FPredItemEconomy
+{
+public:
+
+    /** Item index of nothing, same value as INDEX_NONE */
+    static constexpr int32_t NoItem = -1;
+
+    /** Rebuilds the economy from @Items, indexed by item index */
+    void Build(const std::vector<FPredEconomyItemDef>& Items);
+
+    /**
+     * Replaces the price of every item with @NewPrices (indexed by item index), keeping the recipe graph as it is.
+     * Meant for patching a copy before it is shared, like a LiveOps override does, never an economy someone is reading.
+     */
+    void SetPrices(const std::vector<float>& NewPrices);
+
+    int32_t Num() const { return (int32_t)Prices.size(); }
+    bool IsValidItem(int32_t ItemIndex) const { return ItemIndex >= 0 && ItemIndex < Num(); }
+
+    /** Price of @ItemIndex itself, not accounting for its required items */
+    float GetPrice(int32_t ItemIndex) const { return Prices[ItemIndex]; }
+
+    /** Price of @ItemIndex with none of its parts owned */
+    float GetTotalItemCost(int32_t ItemIndex) const { return TotalItemCosts[ItemIndex]; }
+
+    int32_t GetMaxStackSize(int32_t ItemIndex) const { return MaxStackSizes[ItemIndex]; }
+    bool IsStackable(int32_t ItemIndex) const { return MaxStackSizes[ItemIndex] > 1; }
+
+    const FPredUniqueIdentifierMask& GetUniqueIdentifierMask(int32_t ItemIndex) const { return UniqueIdentifierMasks[ItemIndex]; }
+
+    FPredEconomyItemRange GetRequiredItems(int32_t ItemIndex) const
+    {
+        return { RequiredItemIndices.data() + RequiredItemOffsets[ItemIndex], RequiredItemIndices.data() + RequiredItemOffsets[ItemIndex + 1] };
+    }
+
+    /** Words in a bitset with one bit per item index */
+    int32_t GetNumItemWords() const { return NumItemWords; }
+
+    /** Bitset (GetNumItemWords() words) of every item @ItemIndex is built from, at any depth */
+    const uint64_t* GetDescendantBits(int32_t ItemIndex) const { return DescendantBits.data() + (size_t)ItemIndex * NumItemWords; }
+
+    /** Flattened recipe graph, see GetRequiredItems */
+    const std::vector<int32_t>& GetRequiredItemOffsets() const { return RequiredItemOffsets; }
+    const std::vector<int32_t>& GetRequiredItemIndices() const { return RequiredItemIndices; }
+    const std::vector<float>& GetPrices() const { return Prices; }
+    const std::vector<uint8_t>& GetMaxStackSizes() const { return MaxStackSizes; }
+
+    /**
+     * Returns the cost of @ItemIndex for an inventory owning @RemainingCounts of each item (@NumCounts of them, indexed by item index).
+     * Owned parts are used up from @RemainingCounts as they discount the item, so afterwards it holds what the purchase leaves behind.
+     */
+    float GetItemCostFor(int32_t ItemIndex, uint16_t* RemainingCounts, int32_t NumCounts) const
+    {
+        return WalkPurchase(ItemIndex, RemainingCounts, NumCounts, nullptr);
+    }
+
+    /**
+     * Prices every item for an inventory owning @OwnedItemCounts (@NumOwnedCounts of them), placing Num() prices in @OutPrices.
+     * @Scratch must hold Num() counts, it is overwritten.
+     */
+    void GetAllItemCostsFor(const uint16_t* OwnedItemCounts, int32_t NumOwnedCounts, float* OutPrices, uint16_t* Scratch) const;
+
+    /**
+     * Returns true if @Inventory has room for @ItemIndex: a stack of it has room left, a slot is empty, or the parts the purchase
+     * uses up (at any depth) empty a slot. Using up one copy out of a larger stack doesn't free anything.
+     * Answered from the empty slot count and the item's descendant bits against what we own, regardless of recipe depth. Only when
+     * an owned part sits in a stack does it fall back to walking the purchase.
+     */
+    bool HasRoomForItem(const FPredEconomyInventory& Inventory, int32_t ItemIndex) const;
+
+    /**
+     * Returns true if @Inventory has room for the purchase @Plan was made for. Same as HasRoomForItem, but uses @Plan rather than
+     * planning again when an owned part sits in a stack.
+     */
+    bool HasRoomForPurchase(const FPredEconomyInventory& Inventory, const FPredPurchasePlan& Plan) const;
+
+    /**
+     * Works out which owned parts buying @ItemIndex uses up, appending one item index per copy used up to @OutConsumedItems.
+     * Uses up @RemainingCounts (@NumCounts of them) in the same walk GetItemCostFor prices with, returning the same cost.
+     */
+    float PlanPostPurchaseConsumption(int32_t ItemIndex, uint16_t* RemainingCounts, int32_t NumCounts, std::vector<int32_t>& OutConsumedItems) const
+    {
+        return WalkPurchase(ItemIndex, RemainingCounts, NumCounts, &OutConsumedItems);
+    }
+
+    /** Plans buying @ItemIndex into @Inventory: its cost, the parts it uses up and the slots they come out of, see FPredPurchasePlan */
+    void PlanPurchase(const FPredEconomyInventory& Inventory, int32_t ItemIndex, FPredPurchasePlan& OutPlan) const;
+
+private:
+
+    /**
+     * Walks the expanded recipe of @ItemIndex, using up owned parts from @RemainingCounts (skipping everything below them) and adding
+     * up the price of the rest. Appends each part used up to @OutConsumedItems if given. Returns the cost.
+     */
+    float WalkPurchase(int32_t ItemIndex, uint16_t* RemainingCounts, int32_t NumCounts, std::vector<int32_t>* OutConsumedItems) const;
+
+    /**
+     * Room checks which don't need a plan: sets @bOutNeedsPlan and returns false if the answer depends on exactly which parts get used up.
+     */
+    bool HasRoomWithoutPlan(const FPredEconomyInventory& Inventory, int32_t ItemIndex, bool& bOutNeedsPlan) const;
+
+    /** Appends the expanded recipe of @ItemIndex's parts to ExpandedRecipeItems, see ExpandedRecipeOffsets */
+    void ExpandRecipe(int32_t ItemIndex);
+
+    /** Fills in the descendant bits of @ItemIndex (and of its parts first), @Visited marks the items already filled in */
+    void BuildDescendantBits(int32_t ItemIndex, std::vector<bool>& Visited);
+
+    /** Prices every item with nothing owned into TotalItemCosts, once the prices and recipes are in */
+    void BuildTotalItemCosts();
+
+    std::vector<float> Prices;
+    std::vector<float> TotalItemCosts;
+
+    /** Required items of item i are RequiredItemIndices[RequiredItemOffsets[i], RequiredItemOffsets[i + 1]) */
+    std::vector<int32_t> RequiredItemOffsets;
+    std::vector<int32_t> RequiredItemIndices;
+
+    std::vector<uint8_t> MaxStackSizes;
+    std::vector<FPredUniqueIdentifierMask> UniqueIdentifierMasks;
+
+    /**
+     * Every item's recipe expanded into the parts it is built from, depth first: item i's are ExpandedRecipeItems[ExpandedRecipeOffsets[i],
+     * ExpandedRecipeOffsets[i + 1]). ExpandedRecipeSkips holds the position just past each part's own parts, where the walk carries on
+     * when we own that part. Purchases are a linear walk over it rather than a recursion over the graph.
+     */
+    std::vector<int32_t> ExpandedRecipeOffsets;
+    std::vector<int32_t> ExpandedRecipeItems;
+    std::vector<int32_t> ExpandedRecipeSkips;
+
+    /** Descendants of item i are bits DescendantBits[i * NumItemWords, (i + 1) * NumItemWords) */
+    std::vector<uint64_t> DescendantBits;
+    int32_t NumItemWords = 0;
+};
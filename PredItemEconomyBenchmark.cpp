@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Headless benchmark of the item economy core (FPredItemEconomy / FPredEconomyInventory), no engine required.
+ * Runs synthetic catalogs (deep and wide recipe trees, 100 to 1000 items) through pricing, room checks, purchases and
+ * unique identifier resolution, reporting operations per second and heap allocations per operation.
+ *
+ * Not part of the game module, build it on its own:
+ *     g++ -O2 -std=c++17 PredItemEconomy.cpp PredItemEconomyBenchmark.cpp -o PredItemEconomyBenchmark
+ *     ./PredItemEconomyBenchmark [--seed N] [--quick]
+ */
+#if !defined(WITH_ENGINE)
+
+#include "PredItemEconomy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+
+//////////////////////////////////////////////////////////////////////////
+// Allocation counting
+//////////////////////////////////////////////////////////////////////////
+
+static uint64_t GNumAllocations = 0;
+
+void* operator new(size_t Size)
+{
+    GNumAllocations++;
+    if (void* Memory = std::malloc(Size ? Size : 1))
+    {
+        return Memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t Size)
+{
+    return operator new(Size);
+}
+
+void operator delete(void* Memory) noexcept { std::free(Memory); }
+void operator delete[](void* Memory) noexcept { std::free(Memory); }
+void operator delete(void* Memory, size_t) noexcept { std::free(Memory); }
+void operator delete[](void* Memory, size_t) noexcept { std::free(Memory); }
+
+//////////////////////////////////////////////////////////////////////////
+// Synthetic catalogs
+//////////////////////////////////////////////////////////////////////////
+
+/**
+ * Shape of a synthetic catalog. Items are split into tiers, every item above the first tier is built from
+ * MinParts to MaxParts items of the tier below it.
+ */
+struct FBenchCatalogShape
+{
+    const char* Name;
+    int32_t NumTiers;
+    int32_t MinParts;
+    int32_t MaxParts;
+};
+
+static const FBenchCatalogShape DeepShape = { "deep", 8, 1, 2 };
+static const FBenchCatalogShape WideShape = { "wide", 3, 3, 6 };
+
+static std::vector<FPredEconomyItemDef> MakeCatalog(const FBenchCatalogShape& Shape, int32_t NumItems, std::mt19937& Rng)
+{
+    std::vector<FPredEconomyItemDef> Items(NumItems);
+    std::vector<int32_t> TierStarts(Shape.NumTiers + 1);
+    for (int32_t Tier = 0; Tier <= Shape.NumTiers; Tier++)
+    {
+        TierStarts[Tier] = NumItems * Tier / Shape.NumTiers;
+    }
+
+    std::uniform_real_distribution<float> PriceDist(50.0f, 500.0f);
+    std::uniform_int_distribution<int32_t> PartsDist(Shape.MinParts, Shape.MaxParts);
+    std::uniform_int_distribution<int32_t> PercentDist(0, 99);
+    std::uniform_int_distribution<int32_t> UniqueBitDist(0, 63);
+
+    for (int32_t Tier = 0; Tier < Shape.NumTiers; Tier++)
+    {
+        for (int32_t ItemIndex = TierStarts[Tier]; ItemIndex < TierStarts[Tier + 1]; ItemIndex++)
+        {
+            FPredEconomyItemDef& Item = Items[ItemIndex];
+            Item.Price = PriceDist(Rng);
+
+            // Some of the basic items are consumables which stack.
+            Item.MaxStackSize = Tier == 0 && PercentDist(Rng) < 10 ? 5 : 1;
+
+            // About a third of the items use one or two unique identifiers, shared with other items.
+            if (PercentDist(Rng) < 35)
+            {
+                Item.UniqueIdentifierMask.SetBit(UniqueBitDist(Rng));
+                if (PercentDist(Rng) < 30)
+                {
+                    Item.UniqueIdentifierMask.SetBit(UniqueBitDist(Rng));
+                }
+            }
+
+            if (Tier == 0) { continue; }
+
+            std::uniform_int_distribution<int32_t> PartDist(TierStarts[Tier - 1], TierStarts[Tier] - 1);
+            const int32_t NumParts = PartsDist(Rng);
+            for (int32_t Part = 0; Part < NumParts; Part++)
+            {
+                Item.RequiredItems.push_back(PartDist(Rng));
+            }
+        }
+    }
+
+    return Items;
+}
+
+/** Fills @Inventory with @NumItems random items, as if a player had bought their way there */
+static void FillInventory(const FPredItemEconomy& Economy, FPredEconomyInventory& Inventory, int32_t NumItems, std::mt19937& Rng)
+{
+    std::uniform_int_distribution<int32_t> ItemDist(0, Economy.Num() - 1);
+    for (int32_t i = 0; i < NumItems; i++)
+    {
+        Inventory.EquipItem(Economy, ItemDist(Rng), 1);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Benchmarks
+//////////////////////////////////////////////////////////////////////////
+
+struct FBenchResult
+{
+    uint64_t NumOps = 0;
+    uint64_t NumAllocations = 0;
+    double Seconds = 0.0;
+};
+
+/**
+ * Runs @Body in batches of @BatchSize operations until @MinSeconds have passed.
+ * @Body takes the batch size and returns how many operations it did.
+ */
+template <typename BodyType>
+static FBenchResult RunTimed(double MinSeconds, int32_t BatchSize, BodyType&& Body)
+{
+    // One batch to warm up the caches and let the scratch buffers reach their final size.
+    Body(BatchSize);
+
+    FBenchResult Result;
+    const uint64_t StartAllocations = GNumAllocations;
+    const auto StartTime = std::chrono::steady_clock::now();
+    do
+    {
+        Result.NumOps += Body(BatchSize);
+        Result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+    }
+    while (Result.Seconds < MinSeconds);
+    Result.NumAllocations = GNumAllocations - StartAllocations;
+    return Result;
+}
+
+static void PrintResult(const char* Benchmark, const char* Shape, int32_t NumItems, const FBenchResult& Result)
+{
+    const double OpsPerSecond = Result.Seconds > 0.0 ? Result.NumOps / Result.Seconds : 0.0;
+    const double AllocationsPerOp = Result.NumOps > 0 ? (double)Result.NumAllocations / Result.NumOps : 0.0;
+    std::printf("%-16s %-6s %6d %14.0f %12.3f %12.4f\n", Benchmark, Shape, NumItems, OpsPerSecond, 1e6 / std::max(OpsPerSecond, 1.0), AllocationsPerOp);
+}
+
+static void RunCatalogBenchmarks(const FBenchCatalogShape& Shape, int32_t NumItems, uint32_t Seed, double MinSeconds)
+{
+    std::mt19937 Rng(Seed ^ (uint32_t)NumItems);
+
+    FPredItemEconomy Economy;
+    Economy.Build(MakeCatalog(Shape, NumItems, Rng));
+
+    std::uniform_int_distribution<int32_t> ItemDist(0, NumItems - 1);
+    std::uniform_int_distribution<int32_t> SlotDist(0, 5);
+
+    // A mid-game inventory to price against: a few parts and a finished item or two.
+    FPredEconomyInventory Inventory;
+    Inventory.Init(6, NumItems, 1e9f);
+    FillInventory(Economy, Inventory, 5, Rng);
+
+    std::vector<uint16_t> Scratch(NumItems);
+    std::vector<float> Prices(NumItems);
+
+    // What a single item costs us, the shop tooltip.
+    PrintResult("item-cost", Shape.Name, NumItems, RunTimed(MinSeconds, 1024, [&](int32_t BatchSize)
+    {
+        float Sink = 0.0f;
+        for (int32_t i = 0; i < BatchSize; i++)
+        {
+            std::memcpy(Scratch.data(), Inventory.OwnedItemCounts.data(), NumItems * sizeof(uint16_t));
+            Sink += Economy.GetItemCostFor(ItemDist(Rng), Scratch.data(), NumItems);
+        }
+        return Sink >= 0.0f ? BatchSize : 0;
+    }));
+
+    // Every item's price, what a personalized price rebuild does. One op is the whole catalog.
+    PrintResult("all-item-costs", Shape.Name, NumItems, RunTimed(MinSeconds, 8, [&](int32_t BatchSize)
+    {
+        for (int32_t i = 0; i < BatchSize; i++)
+        {
+            Economy.GetAllItemCostsFor(Inventory.OwnedItemCounts.data(), (int32_t)Inventory.OwnedItemCounts.size(), Prices.data(), Scratch.data());
+        }
+        return BatchSize;
+    }));
+
+    // Room checks against a full inventory, where only the parts we own can make room.
+    FPredEconomyInventory FullInventory;
+    FullInventory.Init(6, NumItems, 1e9f);
+    FillInventory(Economy, FullInventory, 6, Rng);
+    PrintResult("has-room", Shape.Name, NumItems, RunTimed(MinSeconds, 1024, [&](int32_t BatchSize)
+    {
+        int32_t NumWithRoom = 0;
+        for (int32_t i = 0; i < BatchSize; i++)
+        {
+            NumWithRoom += Economy.HasRoomForItem(FullInventory, ItemDist(Rng)) ? 1 : 0;
+        }
+        return NumWithRoom >= 0 ? BatchSize : 0;
+    }));
+
+    // A shopping spree: buy random items, selling something whenever a purchase doesn't fit.
+    FPredEconomyInventory ShoppingInventory;
+    ShoppingInventory.Init(6, NumItems, 1e12f);
+    PrintResult("buy-sell", Shape.Name, NumItems, RunTimed(MinSeconds, 1024, [&](int32_t BatchSize)
+    {
+        float Cost = 0.0f;
+        int32_t SellPrice = 0;
+        for (int32_t i = 0; i < BatchSize; i++)
+        {
+            if (!ShoppingInventory.TryBuyItem(Economy, ItemDist(Rng), Cost))
+            {
+                ShoppingInventory.TrySellItem(Economy, SlotDist(Rng), SellPrice);
+            }
+        }
+        return BatchSize;
+    }));
+
+    // Equipping and removing items which share unique identifiers, handing the identifiers from slot to slot.
+    FPredEconomyInventory UniqueInventory;
+    UniqueInventory.Init(6, NumItems, 0.0f);
+    FillInventory(Economy, UniqueInventory, 6, Rng);
+    PrintResult("unique-resolve", Shape.Name, NumItems, RunTimed(MinSeconds, 1024, [&](int32_t BatchSize)
+    {
+        for (int32_t i = 0; i < BatchSize; i++)
+        {
+            const int32_t Slot = SlotDist(Rng);
+            UniqueInventory.RemoveItemAtSlot(Economy, 0, Slot);
+            UniqueInventory.EquipItem(Economy, ItemDist(Rng), 1);
+        }
+        return BatchSize;
+    }));
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t Seed = 1234;
+    double MinSeconds = 0.25;
+    for (int32_t i = 1; i < argc; i++)
+    {
+        const std::string Arg = argv[i];
+        if (Arg == "--seed" && i + 1 < argc)
+        {
+            Seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (Arg == "--quick")
+        {
+            MinSeconds = 0.02;
+        }
+        else
+        {
+            std::printf("Usage: %s [--seed N] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("Item economy benchmark, seed %u\n", Seed);
+    std::printf("%-16s %-6s %6s %14s %12s %12s\n", "Benchmark", "Shape", "Items", "Ops/s", "us/op", "Allocs/op");
+
+    const int32_t CatalogSizes[] = { 100, 250, 500, 1000 };
+    for (const FBenchCatalogShape* Shape : { &DeepShape, &WideShape })
+    {
+        for (const int32_t NumItems : CatalogSizes)
+        {
+            RunCatalogBenchmarks(*Shape, NumItems, Seed, MinSeconds);
+        }
+    }
+
+    return 0;
+}
+
+#endif // !defined(WITH_ENGINE)
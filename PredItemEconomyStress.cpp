@@ -0,0 +1,766 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Seeded stress harness for the item economy core. Runs millions of buy, sell, equip, remove and undo operations across many
+ * simulated inventories, checking every one against a deliberately simple reference model of the same rules:
+ *  - slots, stack counts, owned counts and unique IDs match the reference after every operation
+ *  - gold is conserved: every inventory's gold is its starting gold plus income, minus purchases, plus sales and refunds
+ *  - a purchase costs exactly its full price minus the full price of the parts it uses up, and uses up what the reference does
+ *  - every applied unique identifier is provided by a slot whose item uses it, every identifier in use is applied,
+ *    and providers are handed on after a removal the way the reference (and UPredInventoryComponent) does it
+ *  - undoing a purchase (removing the item, re-equipping its parts, refunding it) gives back the owned counts and gold from before it
+ * The same operations are then replayed through the core alone to report its throughput, so a faster path can be dropped in
+ * and proven equivalent by running this with the same seed.
+ *
+ * Not part of the game module, build it on its own:
+ *     g++ -O2 -std=c++17 PredItemEconomy.cpp PredItemEconomyStress.cpp -o PredItemEconomyStress
+ *     ./PredItemEconomyStress [--seed N] [--ops N] [--inventories N] [--items N] [--slots N]
+ * Exits with 1 on the first broken invariant, printing the seed and operation to reproduce it.
+ */
+#if !defined(WITH_ENGINE)
+
+#include "PredItemEconomy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+
+//////////////////////////////////////////////////////////////////////////
+// Catalog
+//////////////////////////////////////////////////////////////////////////
+
+/**
+ * Random recipe DAG: every item is built from up to four lower indexed items, so depths vary from flat to long chains.
+ * Prices are whole numbers so gold stays exact and conservation can be checked without tolerances.
+ */
+static std::vector<FPredEconomyItemDef> MakeStressCatalog(int32_t NumItems, std::mt19937& Rng)
+{
+    std::vector<FPredEconomyItemDef> Items(NumItems);
+    std::uniform_int_distribution<int32_t> PriceDist(25, 400);
+    std::uniform_int_distribution<int32_t> PercentDist(0, 99);
+    std::uniform_int_distribution<int32_t> UniqueBitDist(0, 15);
+
+    for (int32_t ItemIndex = 0; ItemIndex < NumItems; ItemIndex++)
+    {
+        FPredEconomyItemDef& Item = Items[ItemIndex];
+        Item.Price = (float)PriceDist(Rng);
+        Item.MaxStackSize = PercentDist(Rng) < 15 ? 1 + PercentDist(Rng) % 4 : 1;
+
+        // Few identifiers shared by many items, so providers change hands often.
+        if (PercentDist(Rng) < 40)
+        {
+            Item.UniqueIdentifierMask.SetBit(UniqueBitDist(Rng));
+            if (PercentDist(Rng) < 25)
+            {
+                Item.UniqueIdentifierMask.SetBit(UniqueBitDist(Rng));
+            }
+        }
+
+        // The first items are basic, the rest have a growing chance of being built from others (repeats included).
+        if (ItemIndex < NumItems / 5) { continue; }
+
+        const int32_t NumParts = PercentDist(Rng) % 5;
+        for (int32_t Part = 0; Part < NumParts; Part++)
+        {
+            Item.RequiredItems.push_back((int32_t)(Rng() % ItemIndex));
+        }
+    }
+
+    return Items;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Reference model
+//////////////////////////////////////////////////////////////////////////
+
+/**
+ * The inventory rules written as plainly as possible, straight from the item definitions: no flattened graph, no cached counts,
+ * every count a scan of the slots. Slow on purpose, it is the thing the core is checked against.
+ */
+struct FReferenceInventory
+{
+    struct FSlot
+    {
+        int32_t Item = -1;
+        int32_t Count = 0;
+        int32_t UniqueItemID = -1;
+    };
+
+    const std::vector<FPredEconomyItemDef>* Items = nullptr;
+    std::vector<FSlot> Slots;
+
+    /** Unique identifier bit to the unique ID of the slot providing it */
+    std::map<int32_t, int32_t> Providers;
+
+    float Gold = 0.0f;
+    float SellModifier = 0.75f;
+    int32_t LastUniqueItemID = 0;
+
+    const FPredEconomyItemDef& Def(int32_t ItemIndex) const { return (*Items)[ItemIndex]; }
+
+    int32_t Count(int32_t ItemIndex) const
+    {
+        int32_t Total = 0;
+        for (const FSlot& Slot : Slots)
+        {
+            Total += Slot.Item == ItemIndex ? Slot.Count : 0;
+        }
+        return Total;
+    }
+
+    std::map<int32_t, int32_t> CountAll() const
+    {
+        std::map<int32_t, int32_t> Counts;
+        for (const FSlot& Slot : Slots)
+        {
+            if (Slot.Item >= 0) { Counts[Slot.Item] += Slot.Count; }
+        }
+        return Counts;
+    }
+
+    float Cost(int32_t ItemIndex, std::map<int32_t, int32_t>& Remaining) const
+    {
+        float Total = Def(ItemIndex).Price;
+        for (const int32_t Part : Def(ItemIndex).RequiredItems)
+        {
+            if (Remaining[Part] > 0) { Remaining[Part]--; continue; }
+            Total += Cost(Part, Remaining);
+        }
+        return Total;
+    }
+
+    float FullCost(int32_t ItemIndex) const
+    {
+        std::map<int32_t, int32_t> NoneOwned;
+        return Cost(ItemIndex, NoneOwned);
+    }
+
+    void Consume(int32_t ItemIndex, std::map<int32_t, int32_t>& Remaining, std::vector<int32_t>& OutConsumed) const
+    {
+        if (Remaining[ItemIndex] > 0)
+        {
+            Remaining[ItemIndex]--;
+            OutConsumed.push_back(ItemIndex);
+            return;
+        }
+        for (const int32_t Part : Def(ItemIndex).RequiredItems)
+        {
+            Consume(Part, Remaining, OutConsumed);
+        }
+    }
+
+    /** Buys @ItemIndex on a copy of the slots and looks for where it would go */
+    bool HasRoom(int32_t ItemIndex) const
+    {
+        FReferenceInventory Trial = *this;
+        std::map<int32_t, int32_t> Remaining = CountAll();
+        std::vector<int32_t> Consumed;
+        for (const int32_t Part : Def(ItemIndex).RequiredItems)
+        {
+            Trial.Consume(Part, Remaining, Consumed);
+        }
+        for (const int32_t Part : Consumed)
+        {
+            Trial.Remove(Part, 1);
+        }
+        for (const FSlot& Slot : Trial.Slots)
+        {
+            if (Slot.Item < 0 || (Slot.Item == ItemIndex && Slot.Count < Def(ItemIndex).MaxStackSize)) { return true; }
+        }
+        return false;
+    }
+
+    int32_t Equip(int32_t ItemIndex, int32_t Count)
+    {
+        const int32_t MaxStackSize = std::min(std::max(Def(ItemIndex).MaxStackSize, 1), 255);
+        for (FSlot& Slot : Slots)
+        {
+            if (Count > 0 && MaxStackSize > 1 && Slot.Item == ItemIndex && Slot.Count < MaxStackSize)
+            {
+                const int32_t Added = std::min(Count, MaxStackSize - Slot.Count);
+                Slot.Count += Added;
+                Count -= Added;
+            }
+        }
+        for (FSlot& Slot : Slots)
+        {
+            if (Count > 0 && Slot.Item < 0)
+            {
+                Slot.Item = ItemIndex;
+                Slot.Count = std::min(Count, MaxStackSize);
+                Slot.UniqueItemID = ++LastUniqueItemID;
+                Count -= Slot.Count;
+                ClaimFor(Slot);
+            }
+        }
+        return Count;
+    }
+
+    void ClaimFor(const FSlot& Slot)
+    {
+        for (int32_t Bit = 0; Bit < FPredUniqueIdentifierMask::MaxBits; Bit++)
+        {
+            if (Def(Slot.Item).UniqueIdentifierMask.IsBitSet(Bit) && Providers.count(Bit) == 0)
+            {
+                Providers[Bit] = Slot.UniqueItemID;
+            }
+        }
+    }
+
+    void RemoveAtSlot(int32_t SlotIndex, int32_t Count)
+    {
+        FSlot& Slot = Slots[SlotIndex];
+        if (Slot.Item < 0) { return; }
+        if (Count > 0 && Count < Slot.Count)
+        {
+            Slot.Count -= Count;
+            return;
+        }
+
+        for (auto It = Providers.begin(); It != Providers.end();)
+        {
+            It = It->second == Slot.UniqueItemID ? Providers.erase(It) : std::next(It);
+        }
+        Slot = FSlot();
+
+        // Whatever was given up goes to the first slot, in slot order, that wants it.
+        for (const FSlot& OtherSlot : Slots)
+        {
+            if (OtherSlot.Item >= 0) { ClaimFor(OtherSlot); }
+        }
+    }
+
+    int32_t Remove(int32_t ItemIndex, int32_t Count)
+    {
+        for (int32_t SlotIndex = 0; SlotIndex < (int32_t)Slots.size() && Count > 0; SlotIndex++)
+        {
+            while (Count > 0 && Slots[SlotIndex].Item == ItemIndex)
+            {
+                const int32_t Removed = std::min(Count, Slots[SlotIndex].Count);
+                RemoveAtSlot(SlotIndex, Removed);
+                Count -= Removed;
+            }
+        }
+        return Count;
+    }
+
+    bool Buy(int32_t ItemIndex, float& OutCost, std::vector<int32_t>& OutConsumed)
+    {
+        std::map<int32_t, int32_t> Remaining = CountAll();
+        OutCost = Cost(ItemIndex, Remaining);
+        if (OutCost > Gold || !HasRoom(ItemIndex)) { return false; }
+
+        Remaining = CountAll();
+        OutConsumed.clear();
+        for (const int32_t Part : Def(ItemIndex).RequiredItems)
+        {
+            Consume(Part, Remaining, OutConsumed);
+        }
+        for (const int32_t Part : OutConsumed)
+        {
+            Remove(Part, 1);
+        }
+        Equip(ItemIndex, 1);
+        Gold -= OutCost;
+        return true;
+    }
+
+    bool Sell(int32_t SlotIndex, int32_t& OutPrice)
+    {
+        if (SlotIndex < 0 || SlotIndex >= (int32_t)Slots.size() || Slots[SlotIndex].Item < 0) { return false; }
+
+        OutPrice = (int32_t)std::floor(FullCost(Slots[SlotIndex].Item) * SellModifier);
+        RemoveAtSlot(SlotIndex, 1);
+        Gold += OutPrice;
+        return true;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Operations
+//////////////////////////////////////////////////////////////////////////
+
+enum class EStressOpType : uint8_t
+{
+    Buy,
+    Sell,
+    Equip,
+    Remove,
+    /** Undoes the inventory's last operation if it was a purchase */
+    Undo,
+    /** Gold from outside the shop (kills, passive income) */
+    Income,
+};
+
+static const char* GetStressOpName(EStressOpType Type)
+{
+    static const char* Names[] = { "Buy", "Sell", "Equip", "Remove", "Undo", "Income" };
+    return Names[(int32_t)Type];
+}
+
+struct FStressOp
+{
+    int32_t Inventory;
+    EStressOpType Type;
+
+    /** Item for Buy, Equip and Remove, slot for Sell, gold for Income */
+    int32_t Target;
+    int32_t Count;
+};
+
+/** What an inventory needs to undo its last purchase */
+struct FStressUndo
+{
+    bool bValid = false;
+    int32_t Item = -1;
+
+    /** Slot the purchased copy went into */
+    int32_t Slot = -1;
+    float Cost = 0.0f;
+    std::vector<int32_t> Consumed;
+    std::vector<uint16_t> CountsBefore;
+    std::vector<int32_t> SlotItemsBefore;
+    std::vector<uint8_t> SlotCountsBefore;
+    float GoldBefore = 0.0f;
+
+    /** Call before buying @InItem */
+    void Prepare(const FPredEconomyInventory& Inventory, int32_t InItem)
+    {
+        Item = InItem;
+        SlotItemsBefore = Inventory.SlotItems;
+        SlotCountsBefore = Inventory.SlotCounts;
+    }
+
+    /** Call after buying, finds the slot the purchase went into: the only one whose count of Item went up (an item is never its own part) */
+    void FindPurchasedSlot(const FPredEconomyInventory& Inventory)
+    {
+        Slot = -1;
+        for (int32_t i = 0; i < Inventory.NumSlots() && Slot < 0; i++)
+        {
+            const bool bGrew = Inventory.SlotItems[i] == Item && (SlotItemsBefore[i] != Item || Inventory.SlotCounts[i] > SlotCountsBefore[i]);
+            Slot = bGrew ? i : -1;
+        }
+    }
+};
+
+static std::vector<FStressOp> MakeStressOps(int32_t NumOps, int32_t NumInventories, int32_t NumItems, int32_t NumSlots, std::mt19937& Rng)
+{
+    std::vector<FStressOp> Ops(NumOps);
+    std::uniform_int_distribution<int32_t> InventoryDist(0, NumInventories - 1);
+    std::uniform_int_distribution<int32_t> ItemDist(0, NumItems - 1);
+    std::uniform_int_distribution<int32_t> SlotDist(0, NumSlots - 1);
+    std::uniform_int_distribution<int32_t> PercentDist(0, 99);
+
+    for (FStressOp& Op : Ops)
+    {
+        const int32_t Roll = PercentDist(Rng);
+        Op.Inventory = InventoryDist(Rng);
+        Op.Count = 1 + PercentDist(Rng) % 3;
+        Op.Type = Roll < 45 ? EStressOpType::Buy : Roll < 67 ? EStressOpType::Sell : Roll < 77 ? EStressOpType::Equip
+            : Roll < 84 ? EStressOpType::Remove : Roll < 94 ? EStressOpType::Undo : EStressOpType::Income;
+        Op.Target = Op.Type == EStressOpType::Sell ? SlotDist(Rng) : Op.Type == EStressOpType::Income ? 100 + PercentDist(Rng) * 20 : ItemDist(Rng);
+    }
+    return Ops;
+}
+
+/** Undoes the purchase recorded in @Undo: the copy bought goes, its parts come back and the gold is refunded. Returns false if a part didn't fit. */
+static bool UndoPurchase(const FPredItemEconomy& Economy, FPredEconomyInventory& Inventory, const FStressUndo& Undo)
+{
+    Inventory.RemoveItemAtSlot(Economy, 1, Undo.Slot);
+
+    bool bAllFit = true;
+    for (const int32_t Part : Undo.Consumed)
+    {
+        bAllFit &= Inventory.EquipItem(Economy, Part, 1) == 0;
+    }
+    Inventory.Gold += Undo.Cost;
+    return bAllFit;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Checked run
+//////////////////////////////////////////////////////////////////////////
+
+struct FStressContext
+{
+    uint32_t Seed = 0;
+    int64_t OpIndex = 0;
+    const FStressOp* Op = nullptr;
+};
+
+static void Fail(const FStressContext& Context, const char* Format, int32_t A = 0, int32_t B = 0, double C = 0.0, double D = 0.0)
+{
+    std::printf("FAILED seed %u, op %lld (%s on inventory %d, target %d, count %d): ", Context.Seed, (long long)Context.OpIndex,
+        GetStressOpName(Context.Op->Type), Context.Op->Inventory, Context.Op->Target, Context.Op->Count);
+    std::printf(Format, A, B, C, D);
+    std::printf("\n");
+    std::exit(1);
+}
+
+/** Checks @Inventory against @Reference and the invariants that hold for any inventory */
+static void CheckInventory(const FStressContext& Context, const FPredItemEconomy& Economy, const FPredEconomyInventory& Inventory,
+    const FReferenceInventory& Reference, double GoldLedger)
+{
+    if (Inventory.Gold != Reference.Gold || (double)Inventory.Gold != GoldLedger)
+    {
+        Fail(Context, "gold %.0f, reference %.0f, ledger %.0f", 0, 0, Inventory.Gold, GoldLedger);
+    }
+
+    std::vector<int32_t> SlotTotals(Economy.Num(), 0);
+    std::vector<int32_t> FirstSlots(Economy.Num(), FPredItemEconomy::NoItem);
+    FPredUniqueIdentifierMask InUse;
+    int32_t NumEmptySlots = 0;
+    for (int32_t Slot = 0; Slot < Inventory.NumSlots(); Slot++)
+    {
+        const FReferenceInventory::FSlot& ReferenceSlot = Reference.Slots[Slot];
+        const int32_t Item = Inventory.SlotItems[Slot];
+        if (Item != ReferenceSlot.Item || (Item >= 0 && (Inventory.SlotCounts[Slot] != ReferenceSlot.Count || Inventory.SlotUniqueIDs[Slot] != ReferenceSlot.UniqueItemID)))
+        {
+            Fail(Context, "slot %d holds item %d, reference has item %d", Slot, Item, 0.0, 0.0);
+        }
+        if (Item < 0)
+        {
+            NumEmptySlots++;
+            continue;
+        }
+
+        if (FirstSlots[Item] == FPredItemEconomy::NoItem)
+        {
+            FirstSlots[Item] = Slot;
+        }
+        if (Inventory.SlotCounts[Slot] < 1 || Inventory.SlotCounts[Slot] > Economy.GetMaxStackSize(Item))
+        {
+            Fail(Context, "slot %d stacks %d copies", Slot, Inventory.SlotCounts[Slot]);
+        }
+        SlotTotals[Item] += Inventory.SlotCounts[Slot];
+        InUse.Append(Economy.GetUniqueIdentifierMask(Item));
+    }
+
+    for (int32_t Item = 0; Item < Economy.Num(); Item++)
+    {
+        if (Inventory.GetOwnedCount(Item) != SlotTotals[Item])
+        {
+            Fail(Context, "owns %d of item %d, slots hold %d", Inventory.GetOwnedCount(Item), Item, SlotTotals[Item]);
+        }
+
+        // The bits room checks are answered from.
+        const bool bFreesSlot = FirstSlots[Item] != FPredItemEconomy::NoItem && Inventory.SlotCounts[FirstSlots[Item]] == 1;
+        const bool bFreeingBit = (Inventory.SlotFreeingItemBits[Item >> 6] & (uint64_t(1) << (Item & 63))) != 0;
+        if (Inventory.OwnsItem(Item) != (SlotTotals[Item] > 0) || bFreeingBit != bFreesSlot)
+        {
+            Fail(Context, "ownership bits of item %d out of step with its %d copies", Item, SlotTotals[Item]);
+        }
+    }
+
+    if (Inventory.NumEmptySlots != NumEmptySlots)
+    {
+        Fail(Context, "counts %d empty slots, there are %d", Inventory.NumEmptySlots, NumEmptySlots);
+    }
+
+    if (InUse != Inventory.AppliedUniqueIdentifiers)
+    {
+        Fail(Context, "applied unique identifiers don't match the ones in use");
+    }
+
+    for (int32_t Bit = 0; Bit < FPredUniqueIdentifierMask::MaxBits; Bit++)
+    {
+        if (!Inventory.IsUniqueIdentifierApplied(Bit)) { continue; }
+
+        const auto ReferenceProvider = Reference.Providers.find(Bit);
+        if (ReferenceProvider == Reference.Providers.end() || ReferenceProvider->second != Inventory.UniqueProviders[Bit])
+        {
+            Fail(Context, "unique identifier %d provided by %d, not by the reference's provider", Bit, Inventory.UniqueProviders[Bit]);
+        }
+
+        bool bProviderHoldsIt = false;
+        for (int32_t Slot = 0; Slot < Inventory.NumSlots(); Slot++)
+        {
+            bProviderHoldsIt |= !Inventory.IsSlotEmpty(Slot) && Inventory.SlotUniqueIDs[Slot] == Inventory.UniqueProviders[Bit]
+                && Economy.GetUniqueIdentifierMask(Inventory.SlotItems[Slot]).IsBitSet(Bit);
+        }
+        if (!bProviderHoldsIt)
+        {
+            Fail(Context, "unique identifier %d provided by %d, which doesn't hold an item using it", Bit, Inventory.UniqueProviders[Bit]);
+        }
+    }
+}
+
+struct FStressSettings
+{
+    uint32_t Seed = 1234;
+    int32_t NumOps = 2000000;
+    int32_t NumInventories = 64;
+    int32_t NumItems = 200;
+    int32_t NumSlots = 6;
+};
+
+static constexpr float StartingGold = 2000.0f;
+
+static void RunChecked(const FStressSettings& Settings, const std::vector<FPredEconomyItemDef>& Items, const FPredItemEconomy& Economy, const std::vector<FStressOp>& Ops)
+{
+    std::vector<FPredEconomyInventory> Inventories(Settings.NumInventories);
+    std::vector<FReferenceInventory> References(Settings.NumInventories);
+    std::vector<FStressUndo> Undos(Settings.NumInventories);
+    std::vector<double> GoldLedgers(Settings.NumInventories, StartingGold);
+    for (int32_t i = 0; i < Settings.NumInventories; i++)
+    {
+        Inventories[i].Init(Settings.NumSlots, Economy.Num(), StartingGold);
+        References[i].Items = &Items;
+        References[i].Slots.resize(Settings.NumSlots);
+        References[i].Gold = StartingGold;
+    }
+
+    int64_t NumPurchases = 0;
+    int64_t NumUndos = 0;
+    int64_t NumPartsConsumed = 0;
+    std::vector<uint16_t> Remaining;
+    std::vector<int32_t> Consumed;
+    std::vector<int32_t> ReferenceConsumed;
+
+    FStressContext Context;
+    Context.Seed = Settings.Seed;
+
+    const auto StartTime = std::chrono::steady_clock::now();
+    for (Context.OpIndex = 0; Context.OpIndex < (int64_t)Ops.size(); Context.OpIndex++)
+    {
+        const FStressOp& Op = Ops[Context.OpIndex];
+        Context.Op = &Op;
+        FPredEconomyInventory& Inventory = Inventories[Op.Inventory];
+        FReferenceInventory& Reference = References[Op.Inventory];
+        FStressUndo& Undo = Undos[Op.Inventory];
+        double& GoldLedger = GoldLedgers[Op.Inventory];
+        const bool bCanUndo = Undo.bValid;
+        Undo.bValid = false;
+
+        switch (Op.Type)
+        {
+        case EStressOpType::Buy:
+        {
+            Remaining.assign(Inventory.OwnedItemCounts.begin(), Inventory.OwnedItemCounts.end());
+            Remaining.resize(Economy.Num(), 0);
+            Consumed.clear();
+            Economy.PlanPostPurchaseConsumption(Op.Target, Remaining.data(), Economy.Num(), Consumed);
+
+            Undo.CountsBefore.assign(Inventory.OwnedItemCounts.begin(), Inventory.OwnedItemCounts.end());
+            Undo.GoldBefore = Inventory.Gold;
+            Undo.Prepare(Inventory, Op.Target);
+
+            float Cost = 0.0f;
+            float ReferenceCost = 0.0f;
+            const bool bBought = Inventory.TryBuyItem(Economy, Op.Target, Cost);
+            const bool bReferenceBought = Reference.Buy(Op.Target, ReferenceCost, ReferenceConsumed);
+            if (bBought != bReferenceBought)
+            {
+                Fail(Context, "bought %d, reference bought %d", bBought, bReferenceBought);
+            }
+            if (!bBought) { break; }
+
+            // The discount is exactly the full price of the parts used up, and they are the parts the reference uses up.
+            float ConsumedValue = 0.0f;
+            for (const int32_t Part : Consumed)
+            {
+                ConsumedValue += Economy.GetTotalItemCost(Part);
+            }
+            if (Cost != ReferenceCost || Cost + ConsumedValue != Economy.GetTotalItemCost(Op.Target) || Consumed != ReferenceConsumed)
+            {
+                Fail(Context, "cost %.0f, reference %.0f", 0, 0, Cost, ReferenceCost);
+            }
+
+            GoldLedger -= Cost;
+            Undo.FindPurchasedSlot(Inventory);
+            Undo.bValid = Undo.Slot >= 0;
+            Undo.Cost = Cost;
+            if (!Undo.bValid)
+            {
+                Fail(Context, "bought item %d but no slot gained a copy", Op.Target);
+            }
+            Undo.Consumed = Consumed;
+            NumPurchases++;
+            NumPartsConsumed += (int64_t)Consumed.size();
+            break;
+        }
+        case EStressOpType::Sell:
+        {
+            int32_t Price = 0;
+            int32_t ReferencePrice = 0;
+            const bool bSold = Inventory.TrySellItem(Economy, Op.Target, Price);
+            const bool bReferenceSold = Reference.Sell(Op.Target, ReferencePrice);
+            if (bSold != bReferenceSold || Price != ReferencePrice)
+            {
+                Fail(Context, "sold for %d, reference sold for %d", bSold ? Price : -1, bReferenceSold ? ReferencePrice : -1);
+            }
+            GoldLedger += bSold ? Price : 0;
+            break;
+        }
+        case EStressOpType::Equip:
+        {
+            const int32_t Leftover = Inventory.EquipItem(Economy, Op.Target, Op.Count);
+            const int32_t ReferenceLeftover = Reference.Equip(Op.Target, Op.Count);
+            if (Leftover != ReferenceLeftover)
+            {
+                Fail(Context, "%d copies didn't fit, %d for the reference", Leftover, ReferenceLeftover);
+            }
+            break;
+        }
+        case EStressOpType::Remove:
+        {
+            const int32_t Missing = Inventory.RemoveItem(Economy, Op.Target, Op.Count);
+            const int32_t ReferenceMissing = Reference.Remove(Op.Target, Op.Count);
+            if (Missing != ReferenceMissing)
+            {
+                Fail(Context, "%d copies missing, %d for the reference", Missing, ReferenceMissing);
+            }
+            break;
+        }
+        case EStressOpType::Undo:
+        {
+            if (!bCanUndo) { break; }
+
+            if (!UndoPurchase(Economy, Inventory, Undo))
+            {
+                Fail(Context, "parts of item %d didn't fit back after undoing its purchase", Undo.Item);
+            }
+            Reference.RemoveAtSlot(Undo.Slot, 1);
+            for (const int32_t Part : Undo.Consumed)
+            {
+                Reference.Equip(Part, 1);
+            }
+            Reference.Gold += Undo.Cost;
+            GoldLedger += Undo.Cost;
+
+            // Slots may have moved around, but what we own and our gold are back to before the purchase.
+            std::vector<uint16_t> CountsAfter(Inventory.OwnedItemCounts.begin(), Inventory.OwnedItemCounts.end());
+            CountsAfter.resize(std::max(CountsAfter.size(), Undo.CountsBefore.size()), 0);
+            Undo.CountsBefore.resize(CountsAfter.size(), 0);
+            if (CountsAfter != Undo.CountsBefore || Inventory.Gold != Undo.GoldBefore)
+            {
+                Fail(Context, "undoing the purchase of item %d didn't restore the inventory", Undo.Item);
+            }
+            NumUndos++;
+            break;
+        }
+        case EStressOpType::Income:
+        {
+            // Only topped up while low, so gold stays small enough to be exact as a float.
+            if (Inventory.Gold < 5000.0f)
+            {
+                Inventory.Gold += Op.Target;
+                Reference.Gold += Op.Target;
+                GoldLedger += Op.Target;
+            }
+            break;
+        }
+        }
+
+        CheckInventory(Context, Economy, Inventory, Reference, GoldLedger);
+    }
+    const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+    std::printf("Checked %lld operations over %d inventories in %.2fs (%.0f ops/s with the reference model)\n",
+        (long long)Ops.size(), Settings.NumInventories, Seconds, Ops.size() / std::max(Seconds, 1e-9));
+    std::printf("  %lld purchases using up %lld parts, %lld undone, every invariant held\n", (long long)NumPurchases, (long long)NumPartsConsumed, (long long)NumUndos);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Core only run
+//////////////////////////////////////////////////////////////////////////
+
+static void RunCoreOnly(const FStressSettings& Settings, const FPredItemEconomy& Economy, const std::vector<FStressOp>& Ops)
+{
+    std::vector<FPredEconomyInventory> Inventories(Settings.NumInventories);
+    std::vector<FStressUndo> Undos(Settings.NumInventories);
+    for (FPredEconomyInventory& Inventory : Inventories)
+    {
+        Inventory.Init(Settings.NumSlots, Economy.Num(), StartingGold);
+    }
+    std::vector<uint16_t> Remaining;
+
+    const auto StartTime = std::chrono::steady_clock::now();
+    for (const FStressOp& Op : Ops)
+    {
+        FPredEconomyInventory& Inventory = Inventories[Op.Inventory];
+        FStressUndo& Undo = Undos[Op.Inventory];
+        const bool bCanUndo = Undo.bValid;
+        Undo.bValid = false;
+
+        switch (Op.Type)
+        {
+        case EStressOpType::Buy:
+        {
+            // Undoing needs the parts used up, planned the same way the checked run does.
+            Remaining.assign(Inventory.OwnedItemCounts.begin(), Inventory.OwnedItemCounts.end());
+            Remaining.resize(Economy.Num(), 0);
+            Undo.Consumed.clear();
+            Economy.PlanPostPurchaseConsumption(Op.Target, Remaining.data(), Economy.Num(), Undo.Consumed);
+            Undo.Prepare(Inventory, Op.Target);
+            if (Inventory.TryBuyItem(Economy, Op.Target, Undo.Cost))
+            {
+                Undo.FindPurchasedSlot(Inventory);
+                Undo.bValid = Undo.Slot >= 0;
+            }
+            break;
+        }
+        case EStressOpType::Sell:
+        {
+            int32_t Price = 0;
+            Inventory.TrySellItem(Economy, Op.Target, Price);
+            break;
+        }
+        case EStressOpType::Equip:
+            Inventory.EquipItem(Economy, Op.Target, Op.Count);
+            break;
+        case EStressOpType::Remove:
+            Inventory.RemoveItem(Economy, Op.Target, Op.Count);
+            break;
+        case EStressOpType::Undo:
+            if (bCanUndo) { UndoPurchase(Economy, Inventory, Undo); }
+            break;
+        case EStressOpType::Income:
+            Inventory.Gold += Inventory.Gold < 5000.0f ? Op.Target : 0;
+            break;
+        }
+    }
+    const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+    std::printf("Core alone: %.2fs, %.0f ops/s\n", Seconds, Ops.size() / std::max(Seconds, 1e-9));
+}
+
+int main(int argc, char** argv)
+{
+    FStressSettings Settings;
+    for (int32_t i = 1; i < argc; i++)
+    {
+        const std::string Arg = argv[i];
+        const bool bHasValue = i + 1 < argc;
+        if (Arg == "--seed" && bHasValue) { Settings.Seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10); }
+        else if (Arg == "--ops" && bHasValue) { Settings.NumOps = std::max(std::atoi(argv[++i]), 1); }
+        else if (Arg == "--inventories" && bHasValue) { Settings.NumInventories = std::max(std::atoi(argv[++i]), 1); }
+        else if (Arg == "--items" && bHasValue) { Settings.NumItems = std::max(std::atoi(argv[++i]), 5); }
+        else if (Arg == "--slots" && bHasValue) { Settings.NumSlots = std::min(std::max(std::atoi(argv[++i]), 1), 127); }
+        else
+        {
+            std::printf("Usage: %s [--seed N] [--ops N] [--inventories N] [--items N] [--slots N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("Item economy stress, seed %u: %d operations, %d inventories of %d slots, %d items\n",
+        Settings.Seed, Settings.NumOps, Settings.NumInventories, Settings.NumSlots, Settings.NumItems);
+
+    std::mt19937 Rng(Settings.Seed);
+    const std::vector<FPredEconomyItemDef> Items = MakeStressCatalog(Settings.NumItems, Rng);
+    FPredItemEconomy Economy;
+    Economy.Build(Items);
+    const std::vector<FStressOp> Ops = MakeStressOps(Settings.NumOps, Settings.NumInventories, Settings.NumItems, Settings.NumSlots, Rng);
+
+    RunChecked(Settings, Items, Economy, Ops);
+    RunCoreOnly(Settings, Economy, Ops);
+    return 0;
+}
+
+#endif // !defined(WITH_ENGINE)
@@ -19,7 +19,7 @@ const FName UPredItemLibrary::ItemShopOpenRowName = "ItemShop_Open";
 const FName UPredItemLibrary::ItemShopCloseRowName = "ItemShop_Close";
 const FName UPredItemLibrary::ItemShopSelectRowName = "ItemShop_SelectItem";
 
-APredItemService* UPredItemLibrary::GetItemService(UObject* WorldContextObject)
+APredItemService* UPredItemLibrary::GetItemService(const UObject* WorldContextObject)
 {
     ABasePredecessorGameState* GameState = WorldContextObject->GetWorld()->GetGameState<ABasePredecessorGameState>();
     if (!GameState)
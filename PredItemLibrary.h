@@ -45,7 +45,7 @@ public:
     static void GenerateInventoryDebugString(AActor* InventoryOwner, FString& OutDebugString);
 
     UFUNCTION(BlueprintPure, meta = (WorldContext = "WorldContextObject"), Category = "PredItemLibrary")
-    static APredItemService* GetItemService(UObject* WorldContextObject);
+    static APredItemService* GetItemService(const UObject* WorldContextObject);
 
     /**
      * Grabs the inventory component from an actor
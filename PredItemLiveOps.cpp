@@ -0,0 +1,465 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemLiveOps.h"
+#include "PredItemService.h"
+#include "PredItemCatalog.h"
+#include "PredItemCatalogSnapshot.h"
+#include "PredInventoryComponent.h"
+#include "PredItemLoadout.h"
+#include "PredItem.h"
+#include "PredItemStats.h"
+#include "PredLoggingLibrary.h"
+#include "Algo/AnyOf.h"
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/UObjectIterator.h"
+
+TArray<TWeakObjectPtr<APredItemService>> FPredLiveOpsOverrides::ItemServices;
+FString FPredLiveOpsOverrides::OverrideFilename;
+FDateTime FPredLiveOpsOverrides::LastReadTimeStamp = FDateTime::MinValue();
+FDelegateHandle FPredLiveOpsOverrides::PollTickerHandle;
+bool FPredLiveOpsOverrides::bPollInFlight = false;
+
+void FPredLiveOpsOverrides::RegisterItemService(APredItemService* ItemService)
+{
+    check(IsInGameThread());
+
+    ItemServices.AddUnique(ItemService);
+
+    if (PollTickerHandle.IsValid() || !ItemService->HasAuthority() || !ItemService->bWatchLiveOpsOverrides) { return; }
+
+    // Overrides patch the loaded item assets, in the editor those are the ones being edited and would keep the changes.
+    if (GIsEditor)
+    {
+        TRACESTATIC(PredItemLog, Log, "Not watching for LiveOps item overrides in the editor, run a standalone server to use them.");
+        return;
+    }
+
+    OverrideFilename = FPaths::ProjectSavedDir() / ItemService->LiveOpsOverrideFile;
+    PollTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FPredLiveOpsOverrides::Poll), ItemService->LiveOpsPollInterval);
+    TRACESTATIC(PredItemLog, Log, "Watching %s for LiveOps item overrides.", *OverrideFilename);
+}
+
+void FPredLiveOpsOverrides::UnregisterItemService(APredItemService* ItemService)
+{
+    check(IsInGameThread());
+
+    ItemServices.RemoveAllSwap([ItemService](const TWeakObjectPtr<APredItemService>& Service) { return !Service.IsValid() || Service.Get() == ItemService; });
+
+    // Keep polling for as long as any server side service still wants overrides.
+    const bool bAnyWatching = Algo::AnyOf(ItemServices, [](const TWeakObjectPtr<APredItemService>& Service)
+    {
+        return Service->HasAuthority() && Service->bWatchLiveOpsOverrides;
+    });
+    if (!bAnyWatching && PollTickerHandle.IsValid())
+    {
+        FTicker::GetCoreTicker().RemoveTicker(PollTickerHandle);
+        PollTickerHandle.Reset();
+        OverrideFilename.Reset();
+    }
+}
+
+bool FPredLiveOpsOverrides::Poll(float DeltaTime)
+{
+    PollNow();
+    return true;
+}
+
+void FPredLiveOpsOverrides::ReloadNow()
+{
+    LastReadTimeStamp = FDateTime::MinValue();
+    PollNow();
+}
+
+void FPredLiveOpsOverrides::PollNow()
+{
+    check(IsInGameThread());
+
+    if (bPollInFlight || OverrideFilename.IsEmpty() || FPredCatalogSnapshot::GetCurrentGeneration() == 0) { return; }
+    bPollInFlight = true;
+
+    // Checking the file, reading it and validating it all stay off the game thread, which only ever sees a ready to apply update.
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Filename = OverrideFilename, LastTimeStamp = LastReadTimeStamp]()
+    {
+        const FDateTime TimeStamp = IFileManager::Get().GetTimeStamp(*Filename);
+
+        TSharedPtr<FPredLiveOpsUpdate, ESPMode::ThreadSafe> Update;
+        FString Error;
+        if (TimeStamp != FDateTime::MinValue() && TimeStamp != LastTimeStamp)
+        {
+            Update = MakeShared<FPredLiveOpsUpdate, ESPMode::ThreadSafe>();
+
+            FString Json;
+            const FPredCatalogSnapshotHandle Snapshot = FPredCatalogSnapshot::Acquire();
+            if (!FFileHelper::LoadFileToString(Json, *Filename))
+            {
+                Error = TEXT("the file could not be read");
+            }
+            else if (Snapshot.IsValid())
+            {
+                ParseOverrides(Json, *Snapshot, *Update, Error);
+            }
+        }
+
+        AsyncTask(ENamedThreads::GameThread, [Filename, TimeStamp, Update, Error]()
+        {
+            bPollInFlight = false;
+
+            // Missing or unchanged.
+            if (!Update.IsValid()) { return; }
+
+            if (!Error.IsEmpty())
+            {
+                // Not read again until it changes, so a broken file is only reported once.
+                TRACESTATIC(PredItemLog, Warning, "Rejected the LiveOps item overrides in %s, nothing was changed: %s", *Filename, *Error);
+                LastReadTimeStamp = TimeStamp;
+                return;
+            }
+
+            if (Update->Overrides.Num() == 0)
+            {
+                TRACESTATIC(PredItemLog, Log, "LiveOps item overrides in %s match the catalog, nothing to change.", *Filename);
+                LastReadTimeStamp = TimeStamp;
+                return;
+            }
+
+            // Otherwise the catalog changed while the file was being validated, the next poll validates it again.
+            if (Apply(*Update))
+            {
+                LastReadTimeStamp = TimeStamp;
+            }
+        });
+    });
+}
+
+bool FPredLiveOpsOverrides::ParseOverrides(const FString& Json, const FPredCatalogSnapshot& Snapshot, FPredLiveOpsUpdate& OutUpdate, FString& OutError)
+{
+    TSharedPtr<FJsonObject> Root;
+    if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid())
+    {
+        OutError = TEXT("not valid JSON");
+        return false;
+    }
+
+    const TSharedPtr<FJsonObject>* ItemsObject = nullptr;
+    if (!Root->TryGetObjectField(TEXT("Items"), ItemsObject))
+    {
+        OutError = TEXT("there is no Items object");
+        return false;
+    }
+
+    TArray<FPredLiveOpsItemOverride> Overrides;
+    for (const TPair<FString, TSharedPtr<FJsonValue>>& ItemEntry : (*ItemsObject)->Values)
+    {
+        const int32 ItemIndex = Snapshot.FindItemIndex(FName(*ItemEntry.Key));
+        if (ItemIndex == INDEX_NONE)
+        {
+            OutError = FString::Printf(TEXT("%s is not an item"), *ItemEntry.Key);
+            return false;
+        }
+
+        const TSharedPtr<FJsonObject>* ItemObject = nullptr;
+        if (!ItemEntry.Value->TryGetObject(ItemObject))
+        {
+            OutError = FString::Printf(TEXT("%s is not an object"), *ItemEntry.Key);
+            return false;
+        }
+
+        FPredLiveOpsItemOverride& Override = Overrides.AddDefaulted_GetRef();
+        Override.ItemIndex = ItemIndex;
+
+        for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : (*ItemObject)->Values)
+        {
+            if (Field.Key == TEXT("Price"))
+            {
+                double Price = 0.0;
+                if (!Field.Value->TryGetNumber(Price))
+                {
+                    OutError = FString::Printf(TEXT("%s has an invalid price, prices are numbers no lower than 0"), *ItemEntry.Key);
+                    return false;
+                }
+
+                Override.bOverridesPrice = true;
+                Override.Price = (float)Price;
+            }
+            else if (Field.Key == TEXT("Modifiers"))
+            {
+                const TSharedPtr<FJsonObject>* ModifiersObject = nullptr;
+                if (!Field.Value->TryGetObject(ModifiersObject))
+                {
+                    OutError = FString::Printf(TEXT("Modifiers of %s is not an object"), *ItemEntry.Key);
+                    return false;
+                }
+
+                for (const TPair<FString, TSharedPtr<FJsonValue>>& Modifier : (*ModifiersObject)->Values)
+                {
+                    int32 ModIdx = INDEX_NONE;
+                    if (!LexTryParseString(ModIdx, *Modifier.Key))
+                    {
+                        OutError = FString::Printf(TEXT("%s has no modifier %s"), *ItemEntry.Key, *Modifier.Key);
+                        return false;
+                    }
+
+                    double Magnitude = 0.0;
+                    if (!Modifier.Value->TryGetNumber(Magnitude))
+                    {
+                        OutError = FString::Printf(TEXT("modifier %d of %s is not a number"), ModIdx, *ItemEntry.Key);
+                        return false;
+                    }
+
+                    Override.ModifierMagnitudes.Add({ ModIdx, (float)Magnitude });
+                }
+            }
+            else
+            {
+                OutError = FString::Printf(TEXT("%s has an unknown field %s, only Price and Modifiers can be overridden"), *ItemEntry.Key, *Field.Key);
+                return false;
+            }
+        }
+    }
+
+    return MakeUpdate(Overrides, Snapshot, OutUpdate, OutError);
+}
+
+bool FPredLiveOpsOverrides::MakeUpdate(TArrayView<const FPredLiveOpsItemOverride> Overrides, const FPredCatalogSnapshot& Snapshot, FPredLiveOpsUpdate& OutUpdate, FString& OutError)
+{
+    OutUpdate.BaseGeneration = Snapshot.Generation;
+    OutUpdate.Overrides.Reset();
+    OutUpdate.ModifierMagnitudes = Snapshot.ModifierMagnitudes;
+    std::vector<float> Prices = Snapshot.Economy.GetPrices();
+
+    for (const FPredLiveOpsItemOverride& Requested : Overrides)
+    {
+        const int32 ItemIndex = Requested.ItemIndex;
+        if (ItemIndex < 0 || ItemIndex >= Snapshot.Num())
+        {
+            OutError = FString::Printf(TEXT("there is no item %d"), ItemIndex);
+            return false;
+        }
+
+        const FName ItemName = Snapshot.ItemNames[ItemIndex];
+        FPredLiveOpsItemOverride Override;
+        Override.ItemIndex = ItemIndex;
+
+        if (Requested.bOverridesPrice)
+        {
+            if (!FMath::IsFinite(Requested.Price) || Requested.Price < 0.0f)
+            {
+                OutError = FString::Printf(TEXT("%s has an invalid price, prices are numbers no lower than 0"), *ItemName.ToString());
+                return false;
+            }
+
+            if (Requested.Price != Prices[ItemIndex])
+            {
+                Override.bOverridesPrice = true;
+                Override.Price = Requested.Price;
+                Prices[ItemIndex] = Requested.Price;
+            }
+        }
+
+        const int32 FirstModifier = Snapshot.ModifierOffsets[ItemIndex];
+        const int32 NumModifiers = Snapshot.ModifierOffsets[ItemIndex + 1] - FirstModifier;
+        for (const FPredLiveOpsModifierOverride& Modifier : Requested.ModifierMagnitudes)
+        {
+            const int32 ModIdx = Modifier.Modifier;
+            if (ModIdx < 0 || ModIdx >= NumModifiers)
+            {
+                OutError = FString::Printf(TEXT("%s has no modifier %d, it has %d"), *ItemName.ToString(), ModIdx, NumModifiers);
+                return false;
+            }
+
+            if (!FMath::IsFinite(Modifier.Magnitude))
+            {
+                OutError = FString::Printf(TEXT("modifier %d of %s is not a number"), ModIdx, *ItemName.ToString());
+                return false;
+            }
+
+            // A multiplier of 0 or less wipes out or flips the stat, which is never what a balance change means.
+            if (Snapshot.ModifierIsMultiplicative[FirstModifier + ModIdx] && Modifier.Magnitude <= 0.0f)
+            {
+                OutError = FString::Printf(TEXT("modifier %d of %s is multiplicative, it has to be above 0"), ModIdx, *ItemName.ToString());
+                return false;
+            }
+
+            if (Modifier.Magnitude != OutUpdate.ModifierMagnitudes[FirstModifier + ModIdx])
+            {
+                Override.ModifierMagnitudes.Add(Modifier);
+                OutUpdate.ModifierMagnitudes[FirstModifier + ModIdx] = Modifier.Magnitude;
+            }
+        }
+
+        if (Override.bOverridesPrice || Override.ModifierMagnitudes.Num() > 0)
+        {
+            OutUpdate.Overrides.Add(MoveTemp(Override));
+        }
+    }
+
+    if (OutUpdate.Overrides.Num() == 0) { return true; }
+
+    // Recipes stay as they are, so only the totals have to be priced again.
+    OutUpdate.Economy = Snapshot.Economy;
+    OutUpdate.Economy.SetPrices(Prices);
+
+    TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe> NewSnapshot = MakeShared<FPredCatalogSnapshot, ESPMode::ThreadSafe>(Snapshot);
+    NewSnapshot->Economy = OutUpdate.Economy;
+    NewSnapshot->ModifierMagnitudes = OutUpdate.ModifierMagnitudes;
+    OutUpdate.Snapshot = NewSnapshot;
+
+    return true;
+}
+
+bool FPredLiveOpsOverrides::Apply(FPredLiveOpsUpdate& Update)
+{
+    check(IsInGameThread());
+    // Moves every world sharing the catalog at once, which makes it no one world's work.
+    PRED_ITEM_SCOPE(LiveOpsApply, FPredItemStats::GetProcessWide());
+
+    TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> OldCatalog = FPredItemCatalog::FindSharedForSnapshot(Update.BaseGeneration);
+    if (!OldCatalog.IsValid() || !Update.Snapshot.IsValid() || Update.BaseGeneration != FPredCatalogSnapshot::GetCurrentGeneration())
+    {
+        return false;
+    }
+
+    TBitArray<> ChangedItemBits(false, OldCatalog->Num());
+    for (const FPredLiveOpsItemOverride& Override : Update.Overrides)
+    {
+        ChangedItemBits[Override.ItemIndex] = true;
+    }
+
+    // Every world sharing the catalog moves over at once, they all hold the same items.
+    TArray<APredItemService*> Services;
+    TArray<UPredInventoryComponent*> Inventories;
+    for (const TWeakObjectPtr<APredItemService>& Service : ItemServices)
+    {
+        if (Service.IsValid() && Service->GetSharedCatalog() == OldCatalog)
+        {
+            Services.Add(Service.Get());
+            Service->GetRegisteredInventories(Inventories);
+        }
+    }
+
+    // Effects come off at the magnitudes they went on with, so nothing is left behind once the items change.
+    int32 NumAffectedInventories = 0;
+    for (UPredInventoryComponent* Inventory : Inventories)
+    {
+        NumAffectedInventories += Inventory->RemoveEffectsOfItems(ChangedItemBits) ? 1 : 0;
+    }
+
+    for (const FPredLiveOpsItemOverride& Override : Update.Overrides)
+    {
+        UPredItem* Item = OldCatalog->Items[Override.ItemIndex];
+        if (Override.bOverridesPrice)
+        {
+            Item->Price.MagnitudeType = EPredItemAttributeMagnitudeType::NoCurve;
+            Item->Price.FlatMagnitude = Override.Price;
+        }
+
+        for (const FPredLiveOpsModifierOverride& ModifierOverride : Override.ModifierMagnitudes)
+        {
+            FPredItemMagnitude& Magnitude = Item->AttributeModifiers[ModifierOverride.Modifier].AttributeModifier.Magnitude;
+            Magnitude.MagnitudeType = EPredItemAttributeMagnitudeType::NoCurve;
+            Magnitude.FlatMagnitude = ModifierOverride.Magnitude;
+        }
+
+        if (Override.ModifierMagnitudes.Num() > 0)
+        {
+            OldCatalog->BakeMultiplicativeSpecTemplate(Item);
+        }
+    }
+
+    // Loadouts holding a changed item aggregate their stats again the next time they are applied.
+    for (TObjectIterator<UPredItemLoadout> It; It; ++It)
+    {
+        const bool bHoldsChangedItem = Algo::AnyOf(It->Items, [&ChangedItemBits](const UPredItem* Item)
+        {
+            return Item && ChangedItemBits.IsValidIndex(Item->ItemIndex) && ChangedItemBits[Item->ItemIndex];
+        });
+        if (bHoldsChangedItem)
+        {
+            It->ResetAggregatedStatEffect();
+        }
+    }
+
+    // Only the changed values differ, the rest of the copy is the same plain data.
+    TSharedRef<FPredItemCatalog, ESPMode::ThreadSafe> NewCatalog = MakeShared<FPredItemCatalog, ESPMode::ThreadSafe>(*OldCatalog);
+    NewCatalog->Economy = MoveTemp(Update.Economy);
+    NewCatalog->ModifierMagnitudes = MoveTemp(Update.ModifierMagnitudes);
+
+    TSharedRef<FPredCatalogSnapshot, ESPMode::ThreadSafe> NewSnapshot = Update.Snapshot.ToSharedRef();
+    FPredCatalogSnapshot::Publish(NewSnapshot);
+    NewCatalog->SnapshotGeneration = NewSnapshot->Generation;
+
+    FPredItemCatalog::ReplaceShared(OldCatalog.ToSharedRef(), NewCatalog);
+    for (APredItemService* Service : Services)
+    {
+        Service->SwapCatalog(NewCatalog);
+        if (Service->HasAuthority())
+        {
+            Service->AddLiveOpsOverrides(Update.Overrides);
+        }
+    }
+
+    for (UPredInventoryComponent* Inventory : Inventories)
+    {
+        Inventory->ReapplyEffectsOfItems(ChangedItemBits);
+    }
+
+    // Prices changed for everyone, inventories reprice (batched on the server) and shops refresh off this.
+    for (APredItemService* Service : Services)
+    {
+        Service->OnItemsLoaded.Broadcast();
+    }
+
+    TRACESTATIC(PredItemLog, Log, "Applied LiveOps overrides to %d items in %d worlds as catalog snapshot %u, %d inventories had their effects re-applied.",
+        Update.Overrides.Num(), Services.Num(), NewSnapshot->Generation, NumAffectedInventories);
+    return true;
+}
+
+void FPredLiveOpsOverrides::ApplyReplicated(APredItemService* ItemService)
+{
+    check(IsInGameThread());
+
+    const TArray<FPredLiveOpsItemOverride>& Overrides = ItemService->GetLiveOpsOverrides();
+    if (Overrides.Num() == 0 || !ItemService->GetSharedCatalog().IsValid()) { return; }
+
+    if (GIsEditor)
+    {
+        TRACESTATIC(PredItemLog, Warning, "Ignoring the server's LiveOps overrides to %d items, they would patch the editor's item assets. Prices shown here may not match the server's.", Overrides.Num());
+        return;
+    }
+
+    // Overrides are validated and applied against the catalog's own snapshot, which is only the current one while no other
+    // catalog was compiled since. Remote clients only ever hold the one.
+    const FPredCatalogSnapshotHandle Snapshot = FPredCatalogSnapshot::Acquire();
+    if (!Snapshot.IsValid() || Snapshot.GetGeneration() != ItemService->GetSharedCatalog()->SnapshotGeneration)
+    {
+        TRACESTATIC(PredItemLog, Warning, "Can't apply the server's LiveOps overrides, another catalog was compiled in this process since ours.");
+        return;
+    }
+
+    FPredLiveOpsUpdate Update;
+    FString Error;
+    if (!MakeUpdate(Overrides, *Snapshot, Update, Error))
+    {
+        TRACESTATIC(PredItemLog, Warning, "Rejected the server's LiveOps overrides, our items don't match its: %s", *Error);
+        return;
+    }
+
+    // Already applied, eg. by a server sharing our catalog in the same process.
+    if (Update.Overrides.Num() == 0) { return; }
+
+    Apply(Update);
+}
+
+static FAutoConsoleCommand ReloadLiveOpsOverridesCommand(
+    TEXT("PredItem.ReloadLiveOpsOverrides"),
+    TEXT("Reads the LiveOps item override file again right away, even if it didn't change."),
+    FConsoleCommandDelegate::CreateStatic(&FPredLiveOpsOverrides::ReloadNow));
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+#include "PredItemEconomy.h"
+
+#include "PredItemLiveOps.generated.h"
+
+class APredItemService;
+struct FPredCatalogSnapshot;
+
+/**
+ * New magnitude of one of an item's attribute modifiers.
+ */
+USTRUCT()
+struct FPredLiveOpsModifierOverride
+{
+    GENERATED_BODY()
+
+    /** Index of the modifier in the item's AttributeModifiers */
+    UPROPERTY()
+    int32 Modifier = INDEX_NONE;
+
+    UPROPERTY()
+    float Magnitude = 0.0f;
+};
+
+/**
+ * New values for one item. Read from the LiveOps override file on the server, where only values that differ from the catalog's
+ * make it in, and replicated to clients (see APredItemService::GetLiveOpsOverrides).
+ */
+USTRUCT()
+struct FPredLiveOpsItemOverride
+{
+    GENERATED_BODY()
+
+    /** Index of the item, the same on the server and its clients since items replicate in order */
+    UPROPERTY()
+    int32 ItemIndex = INDEX_NONE;
+
+    /** Whether Price holds a new price of the item itself */
+    UPROPERTY()
+    bool bOverridesPrice = false;
+
+    UPROPERTY()
+    float Price = 0.0f;
+
+    /** Changed attribute modifiers, each one at most once */
+    UPROPERTY()
+    TArray<FPredLiveOpsModifierOverride> ModifierMagnitudes;
+};
+
+/**
+ * An override file that was read and validated against a catalog snapshot, along with everything derived from it that doesn't need
+ * the game thread. Built on a worker, applied on the game thread by FPredLiveOpsOverrides::Apply.
+ */
+struct FPredLiveOpsUpdate
+{
+    /** Generation of the snapshot the file was validated against. Only applies while that snapshot is still the current one. */
+    uint32 BaseGeneration = 0;
+
+    TArray<FPredLiveOpsItemOverride> Overrides;
+
+    /** Economy of the base catalog with the new prices, ready to move into the new catalog */
+    FPredItemEconomy Economy;
+
+    /** FPredItemCatalog::ModifierMagnitudes of the base catalog with the new magnitudes */
+    TArray<float> ModifierMagnitudes;
+
+    /** Copy of the base snapshot with the new values, published once applied */
+    TSharedPtr<FPredCatalogSnapshot, ESPMode::ThreadSafe> Snapshot;
+};
+
+/**
+ * Hot-patches item prices and attribute modifier magnitudes from a local JSON file while the server runs, no restart or cook needed:
+ *
+ *     {
+ *         "Items": {
+ *             "Item_LongSword": { "Price": 350, "Modifiers": { "0": 12.5 } }
+ *         }
+ *     }
+ *
+ * Items are keyed by asset name, modifiers by their index in the item's AttributeModifiers. Values are absolute and stay in place
+ * until the file says otherwise or the server restarts, removing an entry does not revert it.
+ *
+ * The file is polled from a worker, which reads it, validates all of it against the current catalog snapshot (a single bad entry
+ * rejects the whole file) and derives the new economy and snapshot. The game thread is left with only what touches the items:
+ * it takes the changed items' effects off the inventories holding them, patches the items, bakes their spec templates again,
+ * swaps a patched copy of the catalog in for every world sharing it and publishes the new snapshot, then puts the effects back at
+ * the new magnitudes. Inventories not holding a changed item only get repriced. Items keep their order and indices.
+ *
+ * Every override applied so far is replicated through the item service, clients diff it against their own catalog and apply what
+ * changed the same way, so they price and preview items with the server's values, late joiners included.
+ *
+ * Overrides patch the loaded item assets in place, so they are never applied in the editor, where those are the editor's own assets.
+ */
+class PREDECESSOR_API FPredLiveOpsOverrides
+{
+public:
+
+    /**
+     * Tracks @ItemService, whose catalog gets swapped whenever an override changes it. The first server side service that wants
+     * overrides (see APredItemService::bWatchLiveOpsOverrides) starts polling its override file. Game thread only.
+     */
+    static void RegisterItemService(APredItemService* ItemService);
+    static void UnregisterItemService(APredItemService* ItemService);
+
+    /**
+     * Reads the override file @Json and validates it against @Snapshot, placing the changes and everything derived from them in @OutUpdate.
+     * Returns false with the reason in @OutError if anything in the file is invalid. Safe from any thread.
+     */
+    static bool ParseOverrides(const FString& Json, const FPredCatalogSnapshot& Snapshot, FPredLiveOpsUpdate& OutUpdate, FString& OutError);
+
+    /**
+     * Validates @Overrides against @Snapshot, placing the values that differ from it and everything derived from them in @OutUpdate.
+     * Returns false with the reason in @OutError if an override doesn't fit the snapshot's items. Safe from any thread.
+     */
+    static bool MakeUpdate(TArrayView<const FPredLiveOpsItemOverride> Overrides, const FPredCatalogSnapshot& Snapshot, FPredLiveOpsUpdate& OutUpdate, FString& OutError);
+
+    /**
+     * Applies @Update to every world sharing the catalog it was validated against. Returns false if that catalog is no longer the
+     * current one, in which case the file has to be validated again. Game thread only.
+     */
+    static bool Apply(FPredLiveOpsUpdate& Update);
+
+    /**
+     * Applies the overrides replicated to the client side @ItemService, whichever of them its catalog doesn't have yet.
+     * Does nothing until its items are loaded. Game thread only.
+     */
+    static void ApplyReplicated(APredItemService* ItemService);
+
+    /** Reads the override file again right away, even if it didn't change. Game thread only. */
+    static void ReloadNow();
+
+private:
+
+    /** Has a worker read the override file if it changed since it was last read */
+    static void PollNow();
+
+    static bool Poll(float DeltaTime);
+
+    /** Services whose catalogs overrides swap */
+    static TArray<TWeakObjectPtr<APredItemService>> ItemServices;
+
+    /** Full path of the file being polled, empty while nobody wants overrides */
+    static FString OverrideFilename;
+
+    /** Modification time of the override file last read, it is only read again once it changes */
+    static FDateTime LastReadTimeStamp;
+
+    static FDelegateHandle PollTickerHandle;
+
+    /** Set while a worker is reading the file, so polls don't pile up */
+    static bool bPollInFlight;
+};
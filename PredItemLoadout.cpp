@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemLoadout.h"
+#include "PredItem.h"
+#include "PredItemLibrary.h"
+#include "PredLoggingLibrary.h"
+#include "PredAbilityLibrary.h"
+
+const UGameplayEffect* UPredItemLoadout::GetAggregatedStatEffect() const
+{
+    if (!AggregatedStatEffect)
+    {
+        BuildAggregatedStatEffect();
+    }
+    return AggregatedStatEffect;
+}
+
+FGameplayEffectSpecHandle UPredItemLoadout::MakeMultiplicativeEffectSpec(const FGameplayEffectContextHandle& EffectContext) const
+{
+    // Built along with the aggregated stat effect.
+    GetAggregatedStatEffect();
+    if (!MultiplicativeSpecTemplate.IsValid())
+    {
+        return FGameplayEffectSpecHandle();
+    }
+
+    FGameplayEffectSpec* NewSpec = new FGameplayEffectSpec(*MultiplicativeSpecTemplate);
+    NewSpec->SetContext(EffectContext);
+    return FGameplayEffectSpecHandle(NewSpec);
+}
+
+void UPredItemLoadout::BuildAggregatedStatEffect() const
+{
+    UPredItemLoadout* MutableThis = const_cast<UPredItemLoadout*>(this);
+    AggregatedStatEffect = NewObject<UGameplayEffect>(MutableThis, NAME_None, RF_Transient);
+    AggregatedStatEffect->DurationPolicy = EGameplayEffectDurationType::Infinite;
+
+    // Additive mods collapse into one modifier per attribute. Multiplicative mods go through the same SetByCaller effect inventories
+    // apply item multipliers with, one magnitude per attribute: 1 + Sum(Multiplier - 1), the way the aggregator combines separate items.
+    TMap<FGameplayAttribute, float> AdditiveMagnitudes;
+    TMap<FGameplayAttribute, float> MultiplierBonuses;
+    TSet<FGameplayTag> AppliedUniqueIdentifiers;
+
+    for (const UPredItem* Item : Items)
+    {
+        if (!Item) { continue; }
+
+        for (const FPredUniqueItemAttributeModifier& UniqueAttributeModifier : Item->AttributeModifiers)
+        {
+            if (UniqueAttributeModifier.UniqueIdentifier != FGameplayTag::EmptyTag)
+            {
+                bool bAlreadyApplied = false;
+                AppliedUniqueIdentifiers.Add(UniqueAttributeModifier.UniqueIdentifier, &bAlreadyApplied);
+                if (bAlreadyApplied)
+                {
+                    continue;
+                }
+            }
+
+            const FPredItemAttributeModifier& AttributeModifier = UniqueAttributeModifier.AttributeModifier;
+            if (AttributeModifier.AttributeModType == EPredItemAttributeModType::Multiply)
+            {
+                MultiplierBonuses.FindOrAdd(AttributeModifier.Attribute) += AttributeModifier.GetMagnitude() - 1.0f;
+            }
+            else
+            {
+                AdditiveMagnitudes.FindOrAdd(AttributeModifier.Attribute) += AttributeModifier.GetMagnitude();
+            }
+        }
+    }
+
+    for (const TPair<FGameplayAttribute, float>& AdditiveMagnitude : AdditiveMagnitudes)
+    {
+        FGameplayModifierInfo GameplayModInfo;
+        GameplayModInfo.Attribute = AdditiveMagnitude.Key;
+        GameplayModInfo.ModifierMagnitude = FScalableFloat(AdditiveMagnitude.Value);
+        GameplayModInfo.ModifierOp = EGameplayModOp::Additive;
+        AggregatedStatEffect->Modifiers.Add(GameplayModInfo);
+    }
+
+    MultiplicativeSpecTemplate.Reset();
+    if (MultiplierBonuses.Num() > 0)
+    {
+        FGameplayEffectSpecHandle SpecTemplate = UPredAbilityLibrary::MakeOutgoingMultiplicativeEffectSpec(FGameplayEffectContextHandle());
+        if (SpecTemplate.IsValid())
+        {
+            for (const TPair<FGameplayAttribute, float>& MultiplierBonus : MultiplierBonuses)
+            {
+                SpecTemplate.Data->SetSetByCallerMagnitude(UPredAbilityLibrary::GetSetByCallerTagForAttribute(MultiplierBonus.Key), 1.0f + MultiplierBonus.Value);
+            }
+            MultiplicativeSpecTemplate = SpecTemplate.Data;
+        }
+    }
+
+    TRACE(PredItemLog, Log, "Loadout %s aggregated %d items into %d additive modifiers and %d multipliers.", *GetNameSafe(this), Items.Num(), AggregatedStatEffect->Modifiers.Num(), MultiplierBonuses.Num());
+}
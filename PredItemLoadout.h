@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Engine/DataAsset.h"
+#include "GameplayEffect.h"
+
+#include "PredItemLoadout.generated.h"
+
+class UPredItem;
+
+/**
+ * A fixed set of items given out as a whole, eg. the items a minion wave or a jungle camp spawns with.
+ * Used by stat-only inventories. Immutable at runtime and shared by every inventory using it, so the
+ * aggregated stat effect is only ever built once.
+ */
+UCLASS(BlueprintType)
+class PREDECESSOR_API UPredItemLoadout : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+	
+public:
+
+    /**
+     * Items in this loadout. Duplicates are allowed and stack their stats.
+     * Unique modifiers are taken from the first item listing the unique identifier.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "PredItemLoadout")
+    TArray<UPredItem*> Items;
+
+    /**
+     * Returns the single infinite GameplayEffect carrying the additive stats of every item in the loadout. Built on first use.
+     * Only attribute modifiers are aggregated, item effects and active abilities are not part of a loadout.
+     */
+    const UGameplayEffect* GetAggregatedStatEffect() const;
+
+    /**
+     * Returns the multiplicative modifiers of every item in the loadout as a single spec of the effect inventories apply item
+     * multipliers with (see UPredItem::MakeMultiplicativeEffectSpec), using @EffectContext. Invalid if no item multiplies anything.
+     * Applied alongside GetAggregatedStatEffect, which only carries the additive modifiers.
+     */
+    FGameplayEffectSpecHandle MakeMultiplicativeEffectSpec(const FGameplayEffectContextHandle& EffectContext) const;
+
+    /**
+     * Drops the aggregated stat effect so the next use builds it again from the items' current stats, after a LiveOps override
+     * changed them. Inventories the old one is applied to keep it until they apply the loadout again.
+     */
+    void ResetAggregatedStatEffect() { AggregatedStatEffect = nullptr; MultiplicativeSpecTemplate.Reset(); }
+
+protected:
+
+    void BuildAggregatedStatEffect() const;
+
+    UPROPERTY(Transient)
+    mutable UGameplayEffect* AggregatedStatEffect = nullptr;
+
+    /** Multipliers of every item at their aggregated magnitudes, see MakeMultiplicativeEffectSpec */
+    mutable TSharedPtr<const FGameplayEffectSpec> MultiplicativeSpecTemplate;
+
+};
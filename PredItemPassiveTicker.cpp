@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemPassiveTicker.h"
+#include "AbilitySystemComponent.h"
+
+FPredItemPassiveHandle FPredItemPassiveTicker::AddPassive(UAbilitySystemComponent* Owner, const FGameplayAttribute& Attribute, float Magnitude, float Period, double CurrentTime)
+{
+    FPassive NewPassive;
+    NewPassive.Owner = Owner;
+    NewPassive.Attribute = Attribute;
+    NewPassive.Magnitude = Magnitude;
+    NewPassive.Period = FMath::Max(Period, SliceDuration);
+    NewPassive.NextPulseTime = CurrentTime + NewPassive.Period;
+    NewPassive.Serial = ++NextSerial;
+
+    FPredItemPassiveHandle Handle;
+    Handle.Index = Passives.Add(NewPassive);
+    Handle.Serial = NewPassive.Serial;
+
+    // The wheel hasn't turned yet, start it from now.
+    if (NextSlice == INDEX_NONE)
+    {
+        NextSlice = GetSlice(CurrentTime);
+    }
+    Schedule(Handle, NextSlice);
+
+    return Handle;
+}
+
+void FPredItemPassiveTicker::RemovePassive(FPredItemPassiveHandle Handle)
+{
+    if (IsValidHandle(Handle))
+    {
+        Passives.RemoveAt(Handle.Index);
+    }
+}
+
+bool FPredItemPassiveTicker::SetPassiveMagnitude(FPredItemPassiveHandle Handle, float Magnitude)
+{
+    if (!IsValidHandle(Handle)) { return false; }
+
+    Passives[Handle.Index].Magnitude = Magnitude;
+    return true;
+}
+
+void FPredItemPassiveTicker::Reset()
+{
+    Passives.Empty();
+    for (TArray<FPredItemPassiveHandle>& Bucket : Buckets)
+    {
+        Bucket.Empty();
+    }
+    PendingChanges.Empty();
+    NextSlice = INDEX_NONE;
+    NextBucketIndex = 0;
+    LastTickPulses = 0;
+    bBehind = false;
+}
+
+void FPredItemPassiveTicker::Schedule(FPredItemPassiveHandle Handle, int64 EarliestSlice)
+{
+    const int64 Slice = FMath::Max(GetSlice(Passives[Handle.Index].NextPulseTime), EarliestSlice);
+    Buckets[Slice % NumBuckets].Add(Handle);
+}
+
+void FPredItemPassiveTicker::Tick(double CurrentTime, int32 MaxPulses)
+{
+    LastTickPulses = 0;
+    bBehind = false;
+
+    if (NextSlice == INDEX_NONE) { return; }
+
+    // After a long hitch every bucket is due anyway, so a single lap covers it.
+    const int64 CurrentSlice = GetSlice(CurrentTime);
+    if (CurrentSlice - NextSlice >= NumBuckets)
+    {
+        NextSlice = CurrentSlice - NumBuckets + 1;
+        NextBucketIndex = 0;
+    }
+
+    while (NextSlice <= CurrentSlice)
+    {
+        TArray<FPredItemPassiveHandle>& Bucket = Buckets[NextSlice % NumBuckets];
+        while (NextBucketIndex < Bucket.Num())
+        {
+            const FPredItemPassiveHandle Handle = Bucket[NextBucketIndex];
+            if (!IsValidHandle(Handle))
+            {
+                Bucket.RemoveAtSwap(NextBucketIndex, 1, false);
+                continue;
+            }
+
+            // Due on a later lap of the wheel.
+            FPassive& Passive = Passives[Handle.Index];
+            if (Passive.NextPulseTime > CurrentTime)
+            {
+                NextBucketIndex++;
+                continue;
+            }
+
+            if (LastTickPulses >= MaxPulses)
+            {
+                bBehind = true;
+                FlushPendingChanges();
+                return;
+            }
+
+            UAbilitySystemComponent* Owner = Passive.Owner.Get();
+            if (!Owner)
+            {
+                Passives.RemoveAt(Handle.Index);
+                Bucket.RemoveAtSwap(NextBucketIndex, 1, false);
+                continue;
+            }
+
+            // Every period missed while we were behind is owed too. They go out summed with this one, as a single change, and the
+            // passive stays on its original phase.
+            const int32 NumPeriods = 1 + FMath::FloorToInt((CurrentTime - Passive.NextPulseTime) / Passive.Period);
+            const float PulsedMagnitude = Passive.Magnitude * NumPeriods;
+            Passive.NextPulseTime += Passive.Period * NumPeriods;
+
+            TArray<TPair<FGameplayAttribute, float>, TInlineAllocator<4>>& OwnerChanges = PendingChanges.FindOrAdd(Owner);
+            TPair<FGameplayAttribute, float>* AttributeChange = OwnerChanges.FindByPredicate([&Passive](const TPair<FGameplayAttribute, float>& Change) { return Change.Key == Passive.Attribute; });
+            if (AttributeChange)
+            {
+                AttributeChange->Value += PulsedMagnitude;
+            }
+            else
+            {
+                OwnerChanges.Emplace(Passive.Attribute, PulsedMagnitude);
+            }
+            LastTickPulses++;
+
+            Bucket.RemoveAtSwap(NextBucketIndex, 1, false);
+            Schedule(Handle, NextSlice + 1);
+        }
+
+        NextSlice++;
+        NextBucketIndex = 0;
+    }
+
+    FlushPendingChanges();
+}
+
+void FPredItemPassiveTicker::FlushPendingChanges()
+{
+    for (TPair<UAbilitySystemComponent*, TArray<TPair<FGameplayAttribute, float>, TInlineAllocator<4>>>& OwnerChanges : PendingChanges)
+    {
+        for (const TPair<FGameplayAttribute, float>& Change : OwnerChanges.Value)
+        {
+            OwnerChanges.Key->ApplyModToAttribute(Change.Key, EGameplayModOp::Additive, Change.Value);
+        }
+    }
+
+    // Owners are only valid for the tick that gathered them, don't hang on to them.
+    PendingChanges.Reset();
+}
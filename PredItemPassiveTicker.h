@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+
+class UAbilitySystemComponent;
+
+/**
+ * Identifies a passive registered with FPredItemPassiveTicker. Stays invalid once the passive is removed, even if its storage is reused.
+ */
+struct FPredItemPassiveHandle
+{
+    int32 Index = INDEX_NONE;
+    int32 Serial = 0;
+
+    bool IsValid() const { return Index != INDEX_NONE; }
+};
+
+/**
+ * Pulses the periodic modifiers (FPredItemPeriodicModifier) of every equipped item in the world.
+ *
+ * Passives are scheduled on a timing wheel: time is cut in slices of SliceDuration, and each passive sits in the bucket of the slice its next pulse falls in.
+ * A tick only looks at the buckets of the slices that went by, so passives that aren't due cost nothing.
+ * Pulses landing on the same owner in the same tick are summed per attribute and applied once.
+ * At most MaxPulses passives are pulsed per tick. Anything past that is carried over to the next tick, late rather than dropped:
+ * a passive that missed periods (over budget, or a hitch) pulses once for each of them when it next gets its turn, and keeps its phase.
+ *
+ * Owned by APredItemService, server only.
+ */
+class PREDECESSOR_API FPredItemPassiveTicker
+{
+public:
+
+    /** Length of a time slice, in seconds. Passives due in the same slice pulse on the same tick. */
+    static constexpr float SliceDuration = 0.1f;
+
+    /** Slices on the wheel. Passives with longer periods than the wheel covers are looked at once per lap until they are due. */
+    static constexpr int32 NumBuckets = 64;
+
+    /**
+     * Starts pulsing @Magnitude into @Attribute of @Owner every @Period seconds, the first pulse being @Period seconds after @CurrentTime.
+     */
+    FPredItemPassiveHandle AddPassive(UAbilitySystemComponent* Owner, const FGameplayAttribute& Attribute, float Magnitude, float Period, double CurrentTime);
+
+    /** Stops pulsing @Handle. Does nothing if it was already removed. */
+    void RemovePassive(FPredItemPassiveHandle Handle);
+
+    /** Changes how much @Handle pulses from its next pulse on, keeping its schedule. Returns false if it was already removed. */
+    bool SetPassiveMagnitude(FPredItemPassiveHandle Handle, float Magnitude);
+
+    /** Pulses every passive due by @CurrentTime, up to @MaxPulses of them, then applies the summed changes to their owners */
+    void Tick(double CurrentTime, int32 MaxPulses);
+
+    /** Removes every passive */
+    void Reset();
+
+    /** Number of passives being pulsed */
+    int32 Num() const { return Passives.Num(); }
+
+    /** Passives pulsed by the last tick */
+    int32 GetLastTickPulses() const { return LastTickPulses; }
+
+    /** Passives that were due but didn't fit in the last tick's budget */
+    bool IsBehind() const { return bBehind; }
+
+protected:
+
+    struct FPassive
+    {
+        TWeakObjectPtr<UAbilitySystemComponent> Owner;
+        FGameplayAttribute Attribute;
+        float Magnitude = 0.0f;
+        float Period = 0.0f;
+        double NextPulseTime = 0.0;
+        int32 Serial = 0;
+    };
+
+    bool IsValidHandle(FPredItemPassiveHandle Handle) const
+    {
+        return Passives.IsValidIndex(Handle.Index) && Passives[Handle.Index].Serial == Handle.Serial;
+    }
+
+    static int64 GetSlice(double Time) { return (int64)FMath::FloorToDouble(Time / SliceDuration); }
+
+    /** Places @Handle in the bucket of the slice its next pulse is in, no earlier than @EarliestSlice */
+    void Schedule(FPredItemPassiveHandle Handle, int64 EarliestSlice);
+
+    /** Applies the pulses gathered this tick, one change per owner and attribute */
+    void FlushPendingChanges();
+
+    TSparseArray<FPassive> Passives;
+
+    /** Buckets of the wheel. Removed passives are only dropped from their bucket when it next comes around. */
+    TArray<FPredItemPassiveHandle> Buckets[NumBuckets];
+
+    /** First slice which isn't fully processed yet, and where in its bucket processing stopped when the budget ran out */
+    int64 NextSlice = INDEX_NONE;
+    int32 NextBucketIndex = 0;
+
+    int32 NextSerial = 0;
+
+    /** Summed changes of this tick's pulses, per owner and attribute */
+    TMap<UAbilitySystemComponent*, TArray<TPair<FGameplayAttribute, float>, TInlineAllocator<4>>> PendingChanges;
+
+    int32 LastTickPulses = 0;
+    bool bBehind = false;
+};
@@ -7,24 +7,130 @@
 #include "PredItemLibrary.h"
 #include "PredLoggingLibrary.h"
 #include "PredItem.h"
+#include "PredInventoryComponent.h"
+#include "PredTimelineStreamComponent.h"
+#include "PredItemStats.h"
+#include "PredEconomyJournal.h"
+#include "PredItemCatalogSnapshot.h"
+#include "PredItemLiveOps.h"
+#include "Misc/Paths.h"
+#include "TimerManager.h"
+#include "GameFramework/PlayerState.h"
+#include "Async/ParallelFor.h"
 
 APredItemService::APredItemService()
 {
     SetReplicates(true);
     bAlwaysRelevant = true;
+
+    // Only ticks item passives, which only run on the server.
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
 void APredItemService::BeginPlay()
 {
     Super::BeginPlay();
 
+    // A new item service means a new match. Only our own totals start over, other worlds in the process keep theirs.
+    Stats.Reset();
+
+    SetActorTickEnabled(HasAuthority());
+
+    InventoryTimeline.SetKeyframeInterval((uint32)(TimelineKeyframeInterval * 1000.0f));
+
+    if (HasAuthority() && bRecordEconomyJournal)
+    {
+        const FString JournalFilename = FPaths::ProjectSavedDir() / TEXT("EconomyJournal") / FString::Printf(TEXT("%s_%s.pej"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+        EconomyJournal = MakeShared<FPredEconomyJournal, ESPMode::ThreadSafe>();
+        EconomyJournal->Open(JournalFilename);
+        GetWorldTimerManager().SetTimer(EconomyJournalFlushTimer, this, &APredItemService::FlushEconomyJournal, EconomyJournalFlushInterval, true);
+    }
+
+    // Clients register too, in-process clients share the server's items and catalog and have to move along with it.
+    FPredLiveOpsOverrides::RegisterItemService(this);
+}
+
+void APredItemService::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    FPredLiveOpsOverrides::UnregisterItemService(this);
+    PassiveTicker.Reset();
+    ScoreboardViewers.Reset();
+    GetWorldTimerManager().ClearTimer(ScoreboardRefreshTimer);
+    TimelineSubscribers.Reset();
+    GetWorldTimerManager().ClearTimer(TimelineStreamTimer);
+
+    if (GetInventoryTimeline() && InventoryTimeline.NumTracks() > 0)
+    {
+        const FString TimelineFilename = FPaths::ProjectSavedDir() / TEXT("InventoryTimelines") / FString::Printf(TEXT("%s_%s.pit"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+        if (InventoryTimeline.SaveToFile(TimelineFilename, GetCatalog().LayoutChecksum))
+        {
+            TRACE(PredItemLog, Log, "Inventory timeline of %d players saved to %s, %lld bytes.", InventoryTimeline.NumTracks(), *TimelineFilename, InventoryTimeline.GetNumBytes());
+        }
+        else
+        {
+            TRACE(PredItemLog, Warning, "Could not save the inventory timeline to %s.", *TimelineFilename);
+        }
+    }
+
+    if (InventoryRecorder.IsRecording())
+    {
+        // Inventories still around close out their part of the recording now, the rest did when they unregistered.
+        for (const TWeakObjectPtr<UPredInventoryComponent>& Inventory : RegisteredInventories)
+        {
+            if (Inventory.IsValid())
+            {
+                Inventory->RecordFinalInventoryState();
+            }
+        }
+        InventoryRecorder.Close();
+        TRACE(PredItemLog, Log, "Inventory recording %s closed with %lld operations.", *InventoryRecorder.GetFilename(), InventoryRecorder.GetNumRecordedOps());
+    }
+
+    if (EconomyJournal.IsValid())
+    {
+        GetWorldTimerManager().ClearTimer(EconomyJournalFlushTimer);
+        EconomyJournal->Close();
+        TRACE(PredItemLog, Log, "Economy journal %s closed with %llu events written, %llu dropped.", *EconomyJournal->GetFilename(), EconomyJournal->GetNumWrittenEvents(), EconomyJournal->GetNumDroppedEvents());
+        EconomyJournal.Reset();
+    }
 
+    Super::EndPlay(EndPlayReason);
+}
+
+void APredItemService::Tick(float DeltaSeconds)
+{
+    Super::Tick(DeltaSeconds);
+
+    {
+        PRED_ITEM_SCOPE(PassiveTick, Stats);
+        PassiveTicker.Tick(GetWorld()->GetTimeSeconds(), MaxPassivePulsesPerFrame);
+    }
+    INC_DWORD_STAT_BY(STAT_PredItem_NumPassivePulses, PassiveTicker.GetLastTickPulses());
+
+    // Let go of catalog snapshots replaced while a worker was picking one up.
+    FPredCatalogSnapshot::ReclaimRetiredSnapshots();
+
+    // Don't wait for the timer if the journal is filling up.
+    if (EconomyJournal.IsValid() && EconomyJournal->ShouldFlush())
+    {
+        EconomyJournal->FlushAsync();
+    }
+}
+
+void APredItemService::FlushEconomyJournal()
+{
+    if (EconomyJournal.IsValid())
+    {
+        EconomyJournal->FlushAsync();
+    }
 }
 
 void APredItemService::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
     Super::GetLifetimeReplicatedProps(OutLifetimeProps);
     DOREPLIFETIME(APredItemService, SortedItems);
+    DOREPLIFETIME(APredItemService, LiveOpsOverrides);
 }
 
 void APredItemService::PreInitializeComponents()
@@ -33,6 +139,14 @@ void APredItemService::PreInitializeComponents()
 
     if (HasAuthority())
     {
+        // Opened before anyone's inventory begins play, so every inventory's starting state makes it in.
+        if (bRecordInventoryOps)
+        {
+            // Several worlds can start on the same map within the same second, the process and world keep their recordings apart.
+            const FString FileName = FString::Printf(TEXT("%s_%s_%u_%u.pir"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId(), GetWorld()->GetUniqueID());
+            InventoryRecorder.Open(FPaths::ProjectSavedDir() / TEXT("InventoryRecordings") / FileName);
+        }
+
         UAssetManager* AssetManager = GEngine->AssetManager;
         TArray<FPrimaryAssetId> PrimaryAsset;
         AssetManager->GetPrimaryAssetIdList(UPredItemLibrary::PredItemAssetType, PrimaryAsset);
@@ -61,25 +175,46 @@ UPredItem* APredItemService::GetItemFromPrimaryID(FPrimaryAssetId AssetID)
 
 void APredItemService::Internal_NotifyItemsLoaded()
 {
+    PRED_ITEM_SCOPE(CatalogLoad, Stats);
+
     UAssetManager* AssetManager = GEngine->AssetManager;
 
     TArray<UObject*> Items;
     AssetManager->GetPrimaryAssetObjectList(UPredItemLibrary::PredItemAssetType, Items);
+
+    // Another match in this process already sorted and compiled these items, there is nothing left to do but take its catalog.
+    Catalog = FPredItemCatalog::FindSharedForItems(Items);
+    if (Catalog.IsValid())
+    {
+        SortedItems = Catalog->Items;
+        InventoryRecorder.SetCatalog(*Catalog);
+
+        TRACE(PredItemLog, Log, "Items loaded, sharing the catalog of %d items with another match.", Catalog->Num());
+        ProcessPendingAffordabilityRefreshes();
+        OnItemsLoaded.Broadcast();
+        return;
+    }
+
     for (UObject* Item : Items)
     {
         UPredItem* ItemAsPredItem = Cast<UPredItem>(Item);
-        LoadedItems.Add(ItemAsPredItem->GetPrimaryAssetId(), ItemAsPredItem);
         SortedItems.Add(ItemAsPredItem);
         TRACE(PredItemLog, Log, "%s Loaded.", *ItemAsPredItem->GetIdentifierString());
     }
 
-    // sort by total price
+    // sort by total price, each total worked out once
+    TMap<const UPredItem*, float> TotalItemCosts;
+    for (const UPredItem* Item : SortedItems)
+    {
+        TotalItemCosts.Add(Item, Item->GetTotalItemCost());
+    }
+
     int i, j;
     for (i = 0; i < SortedItems.Num(); i++)
     {
         for (j = 0; j < SortedItems.Num() - i - 1; j++)
         {
-            if (SortedItems[j]->GetTotalItemCost() > SortedItems[j + 1]->GetTotalItemCost())
+            if (TotalItemCosts[SortedItems[j]] > TotalItemCosts[SortedItems[j + 1]])
             {
                 UPredItem* Temp = SortedItems[j];
                 SortedItems[j] = SortedItems[j + 1];
@@ -88,6 +223,8 @@ void APredItemService::Internal_NotifyItemsLoaded()
         }
     }
 
+    CompileCatalog();
+
     // setup the builds-into sections.
     for (UPredItem* Item : SortedItems)
     {
@@ -98,10 +235,418 @@ void APredItemService::Internal_NotifyItemsLoaded()
     }
 
     TRACE(PredItemLog, Log, "Items loaded.");
+    ProcessPendingAffordabilityRefreshes();
     OnItemsLoaded.Broadcast();
 }
 
 void APredItemService::OnRep_SortedItems()
 {
+    PRED_ITEM_SCOPE(SortedItemsRep, Stats);
+
+    CompileCatalog();
     OnItemsLoaded.Broadcast();
 }
+
+void APredItemService::CompileCatalog()
+{
+    // Renumbering the items would pull them out from under every world still holding the other list. Only this world goes without
+    // a catalog, it keeps running on the items' own pricing, the same as items loaded outside the item service.
+    if (!FPredItemCatalog::CanAssignItemIndices(SortedItems))
+    {
+        TRACE(PredItemLog, Error, "%s loaded a different item list than another world in this process is running. Its items are left uncompiled, every world in a process has to run the same items.", *GetWorld()->GetMapName());
+        return;
+    }
+
+    // SortedItems is replicated in order, so clients end up with the same indices as the server.
+    for (int32 i = 0; i < SortedItems.Num(); i++)
+    {
+        if (SortedItems[i])
+        {
+            SortedItems[i]->ItemIndex = i;
+        }
+    }
+
+    // Items can replicate in before their assets have resolved, wait for the rest of them.
+    if (SortedItems.Contains(nullptr))
+    {
+        return;
+    }
+
+    Catalog = FPredItemCatalog::FindOrBuildShared(SortedItems);
+    InventoryRecorder.SetCatalog(*Catalog);
+
+    // Overrides can replicate in before the items do.
+    if (!HasAuthority())
+    {
+        FPredLiveOpsOverrides::ApplyReplicated(this);
+    }
+}
+
+void APredItemService::SwapCatalog(const TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe>& NewCatalog)
+{
+    check(Catalog.IsValid() && Catalog->Items == NewCatalog->Items);
+
+    // The recording's header describes the catalog it started with, the replay picks up the new prices from here on.
+    InventoryRecorder.RecordCatalogChange(*Catalog, *NewCatalog, (uint32)(GetWorld()->GetTimeSeconds() * 1000.0f));
+    Catalog = NewCatalog;
+}
+
+void APredItemService::AddLiveOpsOverrides(const TArray<FPredLiveOpsItemOverride>& Overrides)
+{
+    check(HasAuthority());
+
+    for (const FPredLiveOpsItemOverride& Override : Overrides)
+    {
+        FPredLiveOpsItemOverride* Applied = LiveOpsOverrides.FindByPredicate([&Override](const FPredLiveOpsItemOverride& Entry) { return Entry.ItemIndex == Override.ItemIndex; });
+        if (!Applied)
+        {
+            LiveOpsOverrides.Add(Override);
+            continue;
+        }
+
+        if (Override.bOverridesPrice)
+        {
+            Applied->bOverridesPrice = true;
+            Applied->Price = Override.Price;
+        }
+
+        for (const FPredLiveOpsModifierOverride& Modifier : Override.ModifierMagnitudes)
+        {
+            FPredLiveOpsModifierOverride* AppliedModifier = Applied->ModifierMagnitudes.FindByPredicate([&Modifier](const FPredLiveOpsModifierOverride& Entry) { return Entry.Modifier == Modifier.Modifier; });
+            if (AppliedModifier)
+            {
+                AppliedModifier->Magnitude = Modifier.Magnitude;
+            }
+            else
+            {
+                Applied->ModifierMagnitudes.Add(Modifier);
+            }
+        }
+    }
+}
+
+void APredItemService::OnRep_LiveOpsOverrides()
+{
+    FPredLiveOpsOverrides::ApplyReplicated(this);
+}
+
+void APredItemService::RegisterInventory(UPredInventoryComponent* Inventory)
+{
+    RegisteredInventories.AddUnique(Inventory);
+}
+
+void APredItemService::UnregisterInventory(UPredInventoryComponent* Inventory)
+{
+    if (InventoryRecorder.IsRecording() && RegisteredInventories.Contains(Inventory))
+    {
+        Inventory->RecordFinalInventoryState();
+    }
+
+    RegisteredInventories.RemoveSingleSwap(Inventory);
+    PendingAffordabilityRefreshes.RemoveSingleSwap(Inventory);
+}
+
+void APredItemService::GetRegisteredInventories(TArray<UPredInventoryComponent*>& OutInventories) const
+{
+    for (const TWeakObjectPtr<UPredInventoryComponent>& Inventory : RegisteredInventories)
+    {
+        if (Inventory.IsValid())
+        {
+            OutInventories.Add(Inventory.Get());
+        }
+    }
+}
+
+void APredItemService::SaveInventorySnapshot(const FString& PlayerKey, TArray<uint8>&& PackedSnapshot)
+{
+    SavedInventorySnapshots.Add(PlayerKey, MoveTemp(PackedSnapshot));
+}
+
+bool APredItemService::TakeInventorySnapshot(const FString& PlayerKey, TArray<uint8>& OutPackedSnapshot)
+{
+    return SavedInventorySnapshots.RemoveAndCopyValue(PlayerKey, OutPackedSnapshot);
+}
+
+void APredItemService::SetScoreboardViewer(UPredInventoryComponent* Viewer, bool bViewing)
+{
+    if (!bViewing)
+    {
+        ScoreboardViewers.Remove(Viewer);
+        if (ScoreboardViewers.Num() == 0)
+        {
+            GetWorldTimerManager().ClearTimer(ScoreboardRefreshTimer);
+        }
+        return;
+    }
+
+    // Whoever just opened their scoreboard gets everyone right away, only later changes wait on the refresh.
+    uint32& LastSentRevision = ScoreboardViewers.FindOrAdd(Viewer);
+    LastSentRevision = 0;
+    SendScoreboardUpdate(Viewer, LastSentRevision);
+
+    if (!GetWorldTimerManager().IsTimerActive(ScoreboardRefreshTimer))
+    {
+        GetWorldTimerManager().SetTimer(ScoreboardRefreshTimer, this, &APredItemService::SendScoreboardUpdates, ScoreboardRefreshInterval, true);
+    }
+}
+
+void APredItemService::SendScoreboardUpdates()
+{
+    for (auto It = ScoreboardViewers.CreateIterator(); It; ++It)
+    {
+        if (UPredInventoryComponent* Viewer = It.Key().Get())
+        {
+            SendScoreboardUpdate(Viewer, It.Value());
+        }
+        else
+        {
+            It.RemoveCurrent();
+        }
+    }
+
+    if (ScoreboardViewers.Num() == 0)
+    {
+        GetWorldTimerManager().ClearTimer(ScoreboardRefreshTimer);
+    }
+}
+
+void APredItemService::SendScoreboardUpdate(UPredInventoryComponent* Viewer, uint32& LastSentRevision)
+{
+    PRED_ITEM_SCOPE(ScoreboardSend, Stats);
+
+    TArray<FPredScoreboardEntry> Entries;
+    for (const TWeakObjectPtr<UPredInventoryComponent>& WeakInventory : RegisteredInventories)
+    {
+        const UPredInventoryComponent* Inventory = WeakInventory.Get();
+        if (!Inventory || Inventory == Viewer || Inventory->GetPublicSummaryRevision() <= LastSentRevision) { continue; }
+
+        // Rows are keyed by player state, pawns out of the viewer's sight don't exist on their end.
+        const APlayerState* Player = Inventory->GetOwnerPlayerState();
+        if (!Player) { continue; }
+
+        FPredScoreboardEntry& Entry = Entries.AddDefaulted_GetRef();
+        Entry.Player = Player;
+        Entry.Summary = Inventory->GetPublicSummary();
+    }
+
+    LastSentRevision = SummaryRevision;
+    if (Entries.Num() > 0)
+    {
+        Viewer->Client_ReceiveScoreboardSummaries(Entries);
+    }
+}
+
+void APredItemService::RecordInventoryTimeline(const UPredInventoryComponent* Inventory)
+{
+    FPredInventoryTimeline* Timeline = GetInventoryTimeline();
+
+    // Nothing is recorded before the slots are set up, nor before a player possesses the inventory's owner.
+    if (!Timeline || Inventory->GetOwnedItemIndices().Num() == 0) { return; }
+
+    const FString PlayerKey = Inventory->GetOwnerPlayerKey();
+    const APlayerState* PlayerState = Inventory->GetOwnerPlayerState();
+    if (PlayerKey.IsEmpty() || !PlayerState) { return; }
+
+    int32 Track = INDEX_NONE;
+    if (const int32* ExistingTrack = TimelineTracksByPlayer.Find(PlayerKey))
+    {
+        // Reconnecting players come back with a new player state.
+        Track = *ExistingTrack;
+        TimelineTrackInfos[Track].Player = PlayerState;
+    }
+    else
+    {
+        FPredTimelineTrackInfo& TrackInfo = TimelineTrackInfos.AddDefaulted_GetRef();
+        TrackInfo.Player = PlayerState;
+        TrackInfo.PlayerName = PlayerState->GetPlayerName();
+        Track = Timeline->AddTrack(TrackInfo.PlayerName);
+        TimelineTracksByPlayer.Add(PlayerKey, Track);
+    }
+
+    Timeline->Record(Track, (uint32)(GetWorld()->GetTimeSeconds() * 1000.0f), Inventory->GetOwnedItemIndices(), Inventory->GetSlotStackCounts(), Inventory->GetCachedGold());
+}
+
+void APredItemService::SetTimelineSubscriber(UPredTimelineStreamComponent* Subscriber, bool bSubscribed)
+{
+    if (!GetInventoryTimeline()) { return; }
+
+    // Paused subscribers keep their place, they still have everything sent so far and only need what came after.
+    if (!bSubscribed)
+    {
+        if (FPredTimelineStreamCursor* Cursor = TimelineSubscribers.Find(Subscriber))
+        {
+            Cursor->bStreaming = false;
+        }
+        return;
+    }
+
+    FPredTimelineStreamCursor& Cursor = TimelineSubscribers.FindOrAdd(Subscriber);
+    Cursor.bStreaming = true;
+    SendTimelineUpdate(Subscriber, Cursor);
+
+    if (!GetWorldTimerManager().IsTimerActive(TimelineStreamTimer))
+    {
+        GetWorldTimerManager().SetTimer(TimelineStreamTimer, this, &APredItemService::StreamInventoryTimeline, TimelineStreamInterval, true);
+    }
+}
+
+void APredItemService::StreamInventoryTimeline()
+{
+    PRED_ITEM_SCOPE(TimelineStream, Stats);
+
+    // Players who stopped changing would otherwise hold on to their last chunk until they change again.
+    InventoryTimeline.CloseStaleChunks((uint32)(GetWorld()->GetTimeSeconds() * 1000.0f));
+
+    bool bAnyStreaming = false;
+    for (auto It = TimelineSubscribers.CreateIterator(); It; ++It)
+    {
+        UPredTimelineStreamComponent* Subscriber = It.Key().Get();
+        if (!Subscriber)
+        {
+            It.RemoveCurrent();
+        }
+        else if (It.Value().bStreaming)
+        {
+            SendTimelineUpdate(Subscriber, It.Value());
+            bAnyStreaming = true;
+        }
+    }
+
+    if (!bAnyStreaming)
+    {
+        GetWorldTimerManager().ClearTimer(TimelineStreamTimer);
+    }
+}
+
+void APredItemService::SendTimelineUpdate(UPredTimelineStreamComponent* Subscriber, FPredTimelineStreamCursor& Cursor)
+{
+    TArray<FPredTimelineTrackInfo> NewTracks;
+    for (int32 Track = Cursor.NumChunksSent.Num(); Track < TimelineTrackInfos.Num(); Track++)
+    {
+        // Players that left but aren't collected yet go out as null, same as once they are.
+        FPredTimelineTrackInfo& TrackInfo = NewTracks.Add_GetRef(TimelineTrackInfos[Track]);
+        if (!IsValid(TrackInfo.Player))
+        {
+            TrackInfo.Player = nullptr;
+        }
+    }
+    Cursor.NumChunksSent.SetNumZeroed(TimelineTrackInfos.Num());
+
+    // Oldest chunk of any track first, so a subscriber catching up has every player filled in to the same point.
+    TArray<FPredTimelineChunk> Chunks;
+    int32 NumBytes = 0;
+    while (NumBytes < MaxTimelineStreamBytes)
+    {
+        int32 OldestTrack = INDEX_NONE;
+        uint32 OldestStartMs = MAX_uint32;
+        for (int32 Track = 0; Track < Cursor.NumChunksSent.Num(); Track++)
+        {
+            const TArrayView<const FPredTimelineChunk> TrackChunks = InventoryTimeline.GetClosedChunks(Track);
+            const int32 NextChunk = Cursor.NumChunksSent[Track];
+            if (NextChunk < TrackChunks.Num() && TrackChunks[NextChunk].StartTimeMs < OldestStartMs)
+            {
+                OldestTrack = Track;
+                OldestStartMs = TrackChunks[NextChunk].StartTimeMs;
+            }
+        }
+        if (OldestTrack == INDEX_NONE) { break; }
+
+        const FPredTimelineChunk& Chunk = InventoryTimeline.GetClosedChunks(OldestTrack)[Cursor.NumChunksSent[OldestTrack]++];
+        Chunks.Add(Chunk);
+        NumBytes += Chunk.Bytes.Num();
+    }
+
+    if (NewTracks.Num() > 0 || Chunks.Num() > 0)
+    {
+        Subscriber->Client_ReceiveTimeline(NewTracks, Chunks);
+    }
+}
+
+void APredItemService::RequestAffordabilityRefresh(UPredInventoryComponent* Inventory)
+{
+    if (PendingAffordabilityRefreshes.Num() == 0)
+    {
+        GetWorldTimerManager().SetTimerForNextTick(this, &APredItemService::ProcessPendingAffordabilityRefreshes);
+    }
+    PendingAffordabilityRefreshes.AddUnique(Inventory);
+}
+
+void APredItemService::ProcessPendingAffordabilityRefreshes()
+{
+    TArray<UPredInventoryComponent*> Inventories;
+    for (const TWeakObjectPtr<UPredInventoryComponent>& Inventory : PendingAffordabilityRefreshes)
+    {
+        if (Inventory.IsValid())
+        {
+            Inventories.Add(Inventory.Get());
+        }
+    }
+    PendingAffordabilityRefreshes.Reset();
+
+    RefreshInventoryAffordability(Inventories);
+}
+
+void APredItemService::RefreshAllInventoryAffordability()
+{
+    if (!HasAuthority()) { return; }
+
+    TArray<UPredInventoryComponent*> Inventories;
+    for (const TWeakObjectPtr<UPredInventoryComponent>& Inventory : RegisteredInventories)
+    {
+        if (Inventory.IsValid())
+        {
+            Inventories.Add(Inventory.Get());
+        }
+    }
+    PendingAffordabilityRefreshes.Reset();
+
+    RefreshInventoryAffordability(Inventories);
+}
+
+void APredItemService::RefreshInventoryAffordability(const TArray<UPredInventoryComponent*>& Inventories)
+{
+    PRED_ITEM_SCOPE(AffordabilityRefresh, Stats);
+
+    if (Inventories.Num() == 0) { return; }
+
+    // Nothing can be priced before the items are loaded. Keep them queued, Internal_NotifyItemsLoaded runs them once they are.
+    if (GetCatalog().Num() == 0)
+    {
+        for (UPredInventoryComponent* Inventory : Inventories)
+        {
+            PendingAffordabilityRefreshes.AddUnique(Inventory);
+        }
+        return;
+    }
+
+    // Snapshot everything pricing needs on the game thread, the workers only ever see plain data.
+    struct FInventoryPricingJob
+    {
+        TArray<uint16> OwnedItemCounts;
+        float Gold = 0.0f;
+        FPredPersonalizedPrices Prices;
+    };
+
+    TArray<FInventoryPricingJob> Jobs;
+    Jobs.SetNum(Inventories.Num());
+    for (int32 i = 0; i < Inventories.Num(); i++)
+    {
+        TArrayView<const uint16> OwnedItemCounts = Inventories[i]->GetOwnedItemCounts();
+        Jobs[i].OwnedItemCounts.Append(OwnedItemCounts.GetData(), OwnedItemCounts.Num());
+        Jobs[i].Gold = Inventories[i]->GetCachedGold();
+    }
+
+    const FPredItemCatalog& CatalogRef = *Catalog;
+    FPredItemStats& PricingStats = Stats;
+    ParallelFor(Jobs.Num(), [&CatalogRef, &Jobs, &PricingStats](int32 JobIdx)
+    {
+        FInventoryPricingJob& Job = Jobs[JobIdx];
+        Job.Prices.Build(CatalogRef, Job.OwnedItemCounts, Job.Gold, PricingStats);
+    });
+
+    // Publish everything at once, back on the game thread.
+    for (int32 i = 0; i < Inventories.Num(); i++)
+    {
+        Inventories[i]->ApplyPersonalizedPrices(MoveTemp(Jobs[i].Prices));
+    }
+}
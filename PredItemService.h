@@ -2,9 +2,18 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Info.h"
+#include "PredItemCatalog.h"
+#include "PredItemPassiveTicker.h"
+#include "PredInventoryRecorder.h"
+#include "PredInventoryTimeline.h"
+#include "PredItemLiveOps.h"
+#include "PredItemStats.h"
 #include "PredItemService.generated.h"
 
 class UPredItem;
+class UPredInventoryComponent;
+class UPredTimelineStreamComponent;
+class FPredEconomyJournal;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnItemsLoadedSignature);
 
@@ -39,16 +48,161 @@ public:
     UFUNCTION(BlueprintPure, Category = "PredItem")
     UPredItem* GetItemFromPrimaryID(FPrimaryAssetId AssetID);
 
+    /** Plain data version of the loaded items, empty until items are loaded */
+    const FPredItemCatalog& GetCatalog() const { return Catalog.IsValid() ? *Catalog : FPredItemCatalog::GetEmpty(); }
+
+    /** The catalog shared with every other world in the process running the same items, null until items are loaded */
+    TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> GetSharedCatalog() const { return Catalog; }
+
+    /**
+     * Moves us over to @NewCatalog, a copy of our catalog with a LiveOps override applied (see FPredLiveOpsOverrides).
+     * It has to hold the same items in the same order.
+     */
+    void SwapCatalog(const TSharedRef<const FPredItemCatalog, ESPMode::ThreadSafe>& NewCatalog);
+
+    /** Every LiveOps override applied to our items so far, one entry per item with its latest values */
+    const TArray<FPredLiveOpsItemOverride>& GetLiveOpsOverrides() const { return LiveOpsOverrides; }
+
+    /** Folds @Overrides, just applied to our catalog, into GetLiveOpsOverrides so they replicate. Server only. */
+    void AddLiveOpsOverrides(const TArray<FPredLiveOpsItemOverride>& Overrides);
+
+    /**
+     * Reprices every registered inventory against its current gold, spreading the work across worker threads,
+     * then publishes all of the results (and affordability changes) on the game thread in one go.
+     * Meant to be called after anything that changes everyone's gold at once, like passive income. Server only.
+     */
+    UFUNCTION(BlueprintCallable, Category = "PredItem")
+    void RefreshAllInventoryAffordability();
+
+    /** Inventories registered here are repriced by the batched affordability refresh. Server only. */
+    void RegisterInventory(UPredInventoryComponent* Inventory);
+    void UnregisterInventory(UPredInventoryComponent* Inventory);
+
+    /** Queues @Inventory to be repriced in next tick's batched affordability refresh */
+    void RequestAffordabilityRefresh(UPredInventoryComponent* Inventory);
+
+    /** Adds every inventory registered here that is still around to @OutInventories */
+    void GetRegisteredInventories(TArray<UPredInventoryComponent*>& OutInventories) const;
+
+    /**
+     * Holds on to the packed inventory snapshot (see FPredInventorySnapshot) of the player @PlayerKey until they come back,
+     * replacing any older one. Kept for the rest of the match. Server only.
+     */
+    void SaveInventorySnapshot(const FString& PlayerKey, TArray<uint8>&& PackedSnapshot);
+
+    /** Hands over (and forgets) the snapshot saved for @PlayerKey. Returns false if there is none. Server only. */
+    bool TakeInventorySnapshot(const FString& PlayerKey, TArray<uint8>& OutPackedSnapshot);
+
+    bool HasSavedInventorySnapshots() const { return SavedInventorySnapshots.Num() > 0; }
+
+    /**
+     * Starts or stops sending @Viewer's owner every other player's inventory summary, for their scoreboard. While viewing, the summaries
+     * that changed since the last send go out every ScoreboardRefreshInterval. Server only.
+     */
+    void SetScoreboardViewer(UPredInventoryComponent* Viewer, bool bViewing);
+
+    /** Returns a revision newer than any handed out before, stamped on inventory summaries as they change. Server only. */
+    uint32 NextSummaryRevision() { return ++SummaryRevision; }
+
+    /** Seconds between scoreboard updates sent to players with their scoreboard open */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 0.1))
+    float ScoreboardRefreshInterval = 1.0f;
+
+    /** Timeline of every player's items and gold over the match, null if we aren't recording one. Server only. */
+    FPredInventoryTimeline* GetInventoryTimeline() { return HasAuthority() && bRecordInventoryTimeline ? &InventoryTimeline : nullptr; }
+
+    /** Records @Inventory's slots and gold to its player's track of the inventory timeline, if we are recording one. Server only. */
+    void RecordInventoryTimeline(const UPredInventoryComponent* Inventory);
+
+    /**
+     * Starts or stops streaming the inventory timeline to @Subscriber's owner. Every TimelineStreamInterval they are sent the
+     * tracks and closed chunks they don't have yet, oldest first. Server only.
+     */
+    void SetTimelineSubscriber(UPredTimelineStreamComponent* Subscriber, bool bSubscribed);
+
+    /**
+     * Whether the server records a delta-compressed timeline of every player's items and gold, for spectators (see
+     * UPredTimelineStreamComponent) and post-match analysis. It is saved under Saved/InventoryTimelines when the match ends.
+     */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem")
+    bool bRecordInventoryTimeline = true;
+
+    /** Seconds between keyframes of the inventory timeline. Seeking decodes at most this much of a track, spectators trail by up to this much. */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 1.0, EditCondition = "bRecordInventoryTimeline"))
+    float TimelineKeyframeInterval = 10.0f;
+
+    /** Seconds between sends of the inventory timeline to its subscribers */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 0.1, EditCondition = "bRecordInventoryTimeline"))
+    float TimelineStreamInterval = 2.0f;
+
+    /** Most bytes of chunks sent to a subscriber at once. A subscriber catching up gets the rest over the following sends. */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 256, EditCondition = "bRecordInventoryTimeline"))
+    int32 MaxTimelineStreamBytes = 2048;
+
+    /** Pulses the periodic modifiers of every equipped item. Server only. */
+    FPredItemPassiveTicker& GetPassiveTicker() { return PassiveTicker; }
+
+    /**
+     * Most item passives pulsed in a single frame. Passives past this are pulsed late, on the following frames, with every period
+     * they missed.
+     */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 1))
+    int32 MaxPassivePulsesPerFrame = 512;
+
+    /** Journal economy events are recorded to, null if we aren't recording. Server only. */
+    FPredEconomyJournal* GetEconomyJournal() const { return EconomyJournal.Get(); }
+
+    /**
+     * Whether the server records buys, sells, consumed items and gold changes to a binary journal under Saved/EconomyJournal.
+     */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem")
+    bool bRecordEconomyJournal = true;
+
+    /**
+     * Seconds between flushes of the economy journal to disk. It is also flushed early whenever its buffer gets half full.
+     */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 0.1))
+    float EconomyJournalFlushInterval = 5.0f;
+
+    /** This world's hot path totals, see FPredItemStats */
+    FPredItemStats& GetStats() { return Stats; }
+
+    /** Inventory recording operations are recorded to, null if we aren't recording. Server only. */
+    FPredInventoryRecorder* GetInventoryRecorder() { return InventoryRecorder.IsRecording() ? &InventoryRecorder : nullptr; }
+
+    /**
+     * Whether the server records every inventory's buys, sells, equips and removals under Saved/InventoryRecordings,
+     * for replaying the match's workload headless with PredItem.ReplayInventoryOps.
+     */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem")
+    bool bRecordInventoryOps = false;
+
+    /**
+     * Whether the server watches LiveOpsOverrideFile for item price and modifier overrides, applying them as they change and
+     * replicating them to clients. Never in the editor. See FPredLiveOpsOverrides for the file's format.
+     */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem")
+    bool bWatchLiveOpsOverrides = false;
+
+    /** LiveOps override file, relative to the project's Saved directory */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (EditCondition = "bWatchLiveOpsOverrides"))
+    FString LiveOpsOverrideFile = TEXT("LiveOps/ItemOverrides.json");
+
+    /** Seconds between checks of the LiveOps override file. The file is only read when it changes. */
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "PredItem", meta = (ClampMin = 0.1, EditCondition = "bWatchLiveOpsOverrides"))
+    float LiveOpsPollInterval = 2.0f;
+
+    // AActor
+    virtual void Tick(float DeltaSeconds) override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    // ~AActor
+
 protected:
 
     // AInfo
     virtual void BeginPlay() override;
     // ~AInfo
 
-    /** Map containing all items loaded, only valid on server */
-    UPROPERTY()
-    TMap<FPrimaryAssetId, UPredItem*> LoadedItems;
-
     // TODO: investigate replicating FPrimaryAssetIds and not these pointers, need to change how buying/selling works in order to achieve this.
     UPROPERTY(ReplicatedUsing=OnRep_SortedItems)
     TArray<UPredItem*> SortedItems;
@@ -59,4 +213,83 @@ protected:
     UFUNCTION()
     void OnRep_SortedItems();
 
+    /** See GetLiveOpsOverrides. Clients apply whatever their catalog doesn't have yet, once their items are loaded. */
+    UPROPERTY(ReplicatedUsing=OnRep_LiveOpsOverrides)
+    TArray<FPredLiveOpsItemOverride> LiveOpsOverrides;
+
+    UFUNCTION()
+    void OnRep_LiveOpsOverrides();
+
+    /**
+     * Assigns each item its dense UPredItem::ItemIndex, which is its position in SortedItems, then picks up the catalog.
+     * Only the first world in the process to load these items builds it, the rest share it.
+     */
+    void CompileCatalog();
+
+    /** Plain data version of SortedItems, immutable and shared with the other worlds in the process (see FPredItemCatalog::FindOrBuildShared) */
+    TSharedPtr<const FPredItemCatalog, ESPMode::ThreadSafe> Catalog;
+
+    /** Inventories priced by RefreshAllInventoryAffordability */
+    TArray<TWeakObjectPtr<UPredInventoryComponent>> RegisteredInventories;
+
+    /** Inventories waiting on the next batched refresh, or on the items to load if they asked before then */
+    TArray<TWeakObjectPtr<UPredInventoryComponent>> PendingAffordabilityRefreshes;
+
+    /** Runs the queued refreshes */
+    void ProcessPendingAffordabilityRefreshes();
+
+    /** Reprices @Inventories in parallel and publishes the results */
+    void RefreshInventoryAffordability(const TArray<UPredInventoryComponent*>& Inventories);
+
+    FPredItemPassiveTicker PassiveTicker;
+
+    /** See GetEconomyJournal. Shared with its background flushes, which keep it alive until they are done. */
+    TSharedPtr<FPredEconomyJournal, ESPMode::ThreadSafe> EconomyJournal;
+
+    FTimerHandle EconomyJournalFlushTimer;
+
+    void FlushEconomyJournal();
+
+    /** See GetInventoryRecorder */
+    FPredInventoryRecorder InventoryRecorder;
+
+    /** See GetStats */
+    FPredItemStats Stats;
+
+    /** Packed inventory snapshots of disconnected players, by player key */
+    TMap<FString, TArray<uint8>> SavedInventorySnapshots;
+
+    /** Inventories whose owners have their scoreboard open, with the last summary revision sent to each */
+    TMap<TWeakObjectPtr<UPredInventoryComponent>, uint32> ScoreboardViewers;
+
+    /** Last revision handed out by NextSummaryRevision */
+    uint32 SummaryRevision = 0;
+
+    FTimerHandle ScoreboardRefreshTimer;
+
+    void SendScoreboardUpdates();
+
+    /** Sends @Viewer every summary newer than @LastSentRevision, bringing it up to date */
+    void SendScoreboardUpdate(UPredInventoryComponent* Viewer, uint32& LastSentRevision);
+
+    /** See GetInventoryTimeline */
+    FPredInventoryTimeline InventoryTimeline;
+
+    /** Track of each player in InventoryTimeline, by player key. Reconnecting players carry on with the same track. */
+    TMap<FString, int32> TimelineTracksByPlayer;
+
+    /** Who each track of InventoryTimeline belongs to. A UPROPERTY so players that left are nulled out rather than left dangling. */
+    UPROPERTY()
+    TArray<FPredTimelineTrackInfo> TimelineTrackInfos;
+
+    /** Subscribers to the timeline, with how far along each one is */
+    TMap<TWeakObjectPtr<UPredTimelineStreamComponent>, FPredTimelineStreamCursor> TimelineSubscribers;
+
+    FTimerHandle TimelineStreamTimer;
+
+    void StreamInventoryTimeline();
+
+    /** Sends @Subscriber the new tracks and as many unsent chunks as fit MaxTimelineStreamBytes, moving @Cursor along */
+    void SendTimelineUpdate(UPredTimelineStreamComponent* Subscriber, FPredTimelineStreamCursor& Cursor);
+
 };
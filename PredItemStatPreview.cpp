@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemStatPreview.h"
+#include "PredItemCatalog.h"
+#include "PredItemStats.h"
+#include "Async/ParallelFor.h"
+
+FPredStatPreview::FPredStatPreview(const FPredItemCatalog& InCatalog, FPredItemStats& InStats)
+    : Catalog(InCatalog)
+    , Stats(InStats)
+{
+    UnmodifiedBaseValues.SetNumZeroed(Catalog.ModifiedAttributes.Num());
+}
+
+void FPredStatPreview::SetCurrentBaseValues(TArrayView<const float> CurrentBaseValues)
+{
+    check(CurrentBaseValues.Num() == NumAttributes());
+
+    // Only the additive modifiers live in the base value, multipliers are separate effects.
+    TArray<float, TInlineAllocator<32>> Additive;
+    TArray<float, TInlineAllocator<32>> Multiplicative;
+    Additive.SetNumZeroed(NumAttributes());
+    Multiplicative.SetNumZeroed(NumAttributes());
+
+    for (const FPredStatPreviewSlot& Slot : Slots)
+    {
+        AccumulateSlot(Slot, Slot.ProvidedUniqueIdentifiers, Additive, Multiplicative);
+    }
+
+    for (int32 AttributeSlot = 0; AttributeSlot < NumAttributes(); AttributeSlot++)
+    {
+        UnmodifiedBaseValues[AttributeSlot] = CurrentBaseValues[AttributeSlot] - Additive[AttributeSlot];
+    }
+}
+
+void FPredStatPreview::EvaluateCurrent(TArrayView<float> OutValues) const
+{
+    Evaluate(Slots, INDEX_NONE, OutValues);
+}
+
+void FPredStatPreview::EvaluatePurchase(int32 ItemIndex, TArrayView<float> OutValues) const
+{
+    PRED_ITEM_SCOPE(StatPreview, Stats);
+
+    check(Catalog.ModifierOffsets.IsValidIndex(ItemIndex + 1));
+
+    TArray<FPredStatPreviewSlot, TInlineAllocator<8>> PreviewSlots(Slots);
+
+    // Work out which required items the purchase uses up, the same way it is priced.
+    TArray<uint16, TInlineAllocator<256>> RemainingCounts;
+    RemainingCounts.SetNumZeroed(Catalog.Num());
+    FMemory::Memcpy(RemainingCounts.GetData(), OwnedItemCounts.GetData(), FMath::Min(OwnedItemCounts.Num(), Catalog.Num()) * sizeof(uint16));
+    Catalog.GetItemCostFor(ItemIndex, RemainingCounts);
+
+    // Used up copies come out of the first slots holding them. A slot that empties gives up its unique identifiers.
+    for (FPredStatPreviewSlot& Slot : PreviewSlots)
+    {
+        if (Slot.IsEmpty() || !OwnedItemCounts.IsValidIndex(Slot.ItemIndex)) { continue; }
+
+        const int32 PendingCount = OwnedItemCounts[Slot.ItemIndex] - RemainingCounts[Slot.ItemIndex];
+        const int32 ConsumedCount = FMath::Min(PendingCount, Slot.StackCount);
+        if (ConsumedCount <= 0) { continue; }
+
+        RemainingCounts[Slot.ItemIndex] += ConsumedCount;
+        Slot.StackCount -= ConsumedCount;
+        if (Slot.StackCount == 0)
+        {
+            Slot = FPredStatPreviewSlot();
+        }
+    }
+
+    // Equip the purchase, topping up an existing stack before taking an empty slot.
+    int32 NewSlot = INDEX_NONE;
+    int32 FirstEmptySlot = INDEX_NONE;
+    bool bStacked = false;
+    for (int32 SlotIdx = 0; SlotIdx < PreviewSlots.Num(); SlotIdx++)
+    {
+        FPredStatPreviewSlot& Slot = PreviewSlots[SlotIdx];
+        if (Slot.ItemIndex == ItemIndex && Slot.StackCount < Catalog.GetMaxStackSize(ItemIndex))
+        {
+            Slot.StackCount++;
+            bStacked = true;
+            break;
+        }
+
+        if (Slot.IsEmpty() && FirstEmptySlot == INDEX_NONE)
+        {
+            FirstEmptySlot = SlotIdx;
+        }
+    }
+
+    if (!bStacked)
+    {
+        // A full inventory couldn't make the purchase, but previewing it anyway is more useful than nothing.
+        NewSlot = FirstEmptySlot != INDEX_NONE ? FirstEmptySlot : PreviewSlots.AddDefaulted();
+        PreviewSlots[NewSlot].ItemIndex = ItemIndex;
+        PreviewSlots[NewSlot].StackCount = 1;
+    }
+
+    Evaluate(PreviewSlots, NewSlot, OutValues);
+}
+
+void FPredStatPreview::EvaluateAllPurchases(TArray<float>& OutValues) const
+{
+    const int32 Stride = NumAttributes();
+    OutValues.SetNumUninitialized(Catalog.Num() * Stride);
+
+    ParallelFor(Catalog.Num(), [this, &OutValues, Stride](int32 ItemIndex)
+    {
+        EvaluatePurchase(ItemIndex, TArrayView<float>(OutValues.GetData() + ItemIndex * Stride, Stride));
+    });
+}
+
+void FPredStatPreview::Evaluate(TArrayView<const FPredStatPreviewSlot> PreviewSlots, int32 NewSlot, TArrayView<float> OutValues) const
+{
+    check(OutValues.Num() == NumAttributes());
+
+    // Current providers keep their unique identifiers.
+    FPredUniqueIdentifierMask ClaimedIdentifiers;
+    TArray<FPredUniqueIdentifierMask, TInlineAllocator<8>> SlotIdentifiers;
+    SlotIdentifiers.SetNum(PreviewSlots.Num());
+    for (int32 SlotIdx = 0; SlotIdx < PreviewSlots.Num(); SlotIdx++)
+    {
+        SlotIdentifiers[SlotIdx] = PreviewSlots[SlotIdx].ProvidedUniqueIdentifiers;
+        ClaimedIdentifiers.Append(SlotIdentifiers[SlotIdx]);
+    }
+
+    // Then whatever is left over is regenerated in slot order, and the newly equipped slot picks up what remains after that.
+    auto ClaimRemaining = [&](int32 SlotIdx)
+    {
+        const FPredStatPreviewSlot& Slot = PreviewSlots[SlotIdx];
+        if (Slot.IsEmpty()) { return; }
+
+        const FPredUniqueIdentifierMask Unclaimed = Catalog.GetUniqueIdentifierMask(Slot.ItemIndex).Without(ClaimedIdentifiers);
+        SlotIdentifiers[SlotIdx].Append(Unclaimed);
+        ClaimedIdentifiers.Append(Unclaimed);
+    };
+
+    for (int32 SlotIdx = 0; SlotIdx < PreviewSlots.Num(); SlotIdx++)
+    {
+        if (SlotIdx != NewSlot)
+        {
+            ClaimRemaining(SlotIdx);
+        }
+    }
+    if (PreviewSlots.IsValidIndex(NewSlot))
+    {
+        ClaimRemaining(NewSlot);
+    }
+
+    TArray<float, TInlineAllocator<32>> Additive;
+    TArray<float, TInlineAllocator<32>> Multiplicative;
+    Additive.SetNumZeroed(NumAttributes());
+    Multiplicative.SetNumZeroed(NumAttributes());
+
+    for (int32 SlotIdx = 0; SlotIdx < PreviewSlots.Num(); SlotIdx++)
+    {
+        AccumulateSlot(PreviewSlots[SlotIdx], SlotIdentifiers[SlotIdx], Additive, Multiplicative);
+    }
+
+    const float* RESTRICT BaseValues = UnmodifiedBaseValues.GetData();
+    const float* RESTRICT AdditiveValues = Additive.GetData();
+    const float* RESTRICT MultiplicativeValues = Multiplicative.GetData();
+    float* RESTRICT Values = OutValues.GetData();
+    for (int32 AttributeSlot = 0; AttributeSlot < NumAttributes(); AttributeSlot++)
+    {
+        Values[AttributeSlot] = (BaseValues[AttributeSlot] + AdditiveValues[AttributeSlot]) * (1.0f + MultiplicativeValues[AttributeSlot]);
+    }
+}
+
+void FPredStatPreview::AccumulateSlot(const FPredStatPreviewSlot& Slot, const FPredUniqueIdentifierMask& UniqueIdentifiers, TArrayView<float> Additive, TArrayView<float> Multiplicative) const
+{
+    if (Slot.IsEmpty()) { return; }
+
+    for (int32 ModIdx = Catalog.ModifierOffsets[Slot.ItemIndex]; ModIdx < Catalog.ModifierOffsets[Slot.ItemIndex + 1]; ModIdx++)
+    {
+        // Unique modifiers count once, and only from the slot providing them. The rest scale with the stack.
+        const int32 UniqueBit = Catalog.ModifierUniqueBits[ModIdx];
+        if (UniqueBit != INDEX_NONE && !UniqueIdentifiers.IsBitSet(UniqueBit))
+        {
+            continue;
+        }
+        const int32 ModifierStackCount = UniqueBit != INDEX_NONE ? 1 : Slot.StackCount;
+
+        // Multipliers are summed as offsets from 1, like the ASC's aggregator does.
+        const int32 AttributeSlot = Catalog.ModifierAttributeSlots[ModIdx];
+        const float Magnitude = Catalog.ModifierMagnitudes[ModIdx];
+        if (Catalog.ModifierIsMultiplicative[ModIdx])
+        {
+            Multiplicative[AttributeSlot] += (Magnitude - 1.0f) * ModifierStackCount;
+        }
+        else
+        {
+            Additive[AttributeSlot] += Magnitude * ModifierStackCount;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PredItem.h"
+
+struct FPredItemCatalog;
+class FPredItemStats;
+
+/**
+ * An inventory slot as the stat preview sees it.
+ */
+struct FPredStatPreviewSlot
+{
+    int32 ItemIndex = INDEX_NONE;
+    int32 StackCount = 0;
+
+    /** Unique identifiers this slot is currently the provider of */
+    FPredUniqueIdentifierMask ProvidedUniqueIdentifiers;
+
+    bool IsEmpty() const { return ItemIndex == INDEX_NONE; }
+};
+
+/**
+ * Copy of an inventory and its owner's attributes which purchases can be evaluated against without touching the owner's ASC.
+ * Attribute values are indexed by the catalog's attribute slots (FPredItemCatalog::ModifiedAttributes).
+ *
+ * Only item attribute modifiers are simulated, combined the way the ASC aggregates them: (Base + Additive) * (1 + Sum(Multiplier - 1)).
+ * Item effects and any other gameplay effect on the owner are not accounted for.
+ * Plain data only, so evaluating is safe from worker threads as long as the catalog isn't being rebuilt.
+ */
+struct PREDECESSOR_API FPredStatPreview
+{
+    /** Evaluations are timed into @InStats */
+    FPredStatPreview(const FPredItemCatalog& InCatalog, FPredItemStats& InStats);
+
+    /** Slots of the inventory, in inventory order */
+    TArray<FPredStatPreviewSlot, TInlineAllocator<8>> Slots;
+
+    /** How many of each item the inventory owns, indexed by item index */
+    TArray<uint16> OwnedItemCounts;
+
+    /**
+     * Sets the owner's attributes from their current base values. Item additive modifiers are applied to the base value,
+     * so the current items' are taken back out here. Slots must be filled in first.
+     */
+    void SetCurrentBaseValues(TArrayView<const float> CurrentBaseValues);
+
+    /** Places the attribute values of the inventory as it is in @OutValues */
+    void EvaluateCurrent(TArrayView<float> OutValues) const;
+
+    /**
+     * Places the attribute values after buying @ItemIndex in @OutValues. The required items the purchase would use up
+     * are removed first, and unique identifiers are handed out as the inventory would after the purchase.
+     */
+    void EvaluatePurchase(int32 ItemIndex, TArrayView<float> OutValues) const;
+
+    /**
+     * Evaluates buying every item in the catalog. Row i of @OutValues (one value per attribute slot) is the result of buying item i.
+     */
+    void EvaluateAllPurchases(TArray<float>& OutValues) const;
+
+    int32 NumAttributes() const { return UnmodifiedBaseValues.Num(); }
+
+protected:
+
+    /**
+     * Sums the modifiers of @PreviewSlots into @OutValues. Unique identifiers stay with their current providers, then go to the other slots in order.
+     * @NewSlot (if any) was filled by the purchase, and picks up unique identifiers last as it is equipped after the inventory regenerates.
+     */
+    void Evaluate(TArrayView<const FPredStatPreviewSlot> PreviewSlots, int32 NewSlot, TArrayView<float> OutValues) const;
+
+    /** Adds the modifiers of @Slot to @Additive and @Multiplicative, using the unique identifiers in @UniqueIdentifiers */
+    void AccumulateSlot(const FPredStatPreviewSlot& Slot, const FPredUniqueIdentifierMask& UniqueIdentifiers, TArrayView<float> Additive, TArrayView<float> Multiplicative) const;
+
+    const FPredItemCatalog& Catalog;
+
+    FPredItemStats& Stats;
+
+    /** Base value of each attribute slot without any item modifiers */
+    TArray<float> UnmodifiedBaseValues;
+};
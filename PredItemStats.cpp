@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredItemStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "PredLoggingLibrary.h"
+#include "PredItemService.h"
+#include "BasePredecessorGameState.h"
+
+DEFINE_STAT(STAT_PredItem_ItemCost);
+DEFINE_STAT(STAT_PredItem_PersonalizedPrices);
+DEFINE_STAT(STAT_PredItem_Purchase);
+DEFINE_STAT(STAT_PredItem_Sell);
+DEFINE_STAT(STAT_PredItem_ApplyEffects);
+DEFINE_STAT(STAT_PredItem_RemoveEffects);
+DEFINE_STAT(STAT_PredItem_RegenerateEffects);
+DEFINE_STAT(STAT_PredItem_CatalogLoad);
+DEFINE_STAT(STAT_PredItem_InventoryRep);
+DEFINE_STAT(STAT_PredItem_SortedItemsRep);
+DEFINE_STAT(STAT_PredItem_AffordabilityRefresh);
+DEFINE_STAT(STAT_PredItem_PassiveTick);
+DEFINE_STAT(STAT_PredItem_StatPreview);
+DEFINE_STAT(STAT_PredItem_LiveOpsApply);
+DEFINE_STAT(STAT_PredItem_ScoreboardSend);
+DEFINE_STAT(STAT_PredItem_TimelineStream);
+
+DEFINE_STAT(STAT_PredItem_NumPurchases);
+DEFINE_STAT(STAT_PredItem_NumSells);
+DEFINE_STAT(STAT_PredItem_NumPassivePulses);
+DEFINE_STAT(STAT_PredItem_NumSharedCatalogHits);
+
+static FAutoConsoleCommand DumpPredItemStatsCommand(
+    TEXT("PredItem.DumpStats"),
+    TEXT("Logs how often each item system hot path ran this match and how long it took, summed over every world."),
+    FConsoleCommandDelegate::CreateStatic(&FPredItemStats::Dump));
+
+FPredItemStats::FPredItemStats()
+{
+    FRegistry& Registry = GetRegistry();
+    FScopeLock Lock(&Registry.Lock);
+    Registry.Stats.Add(this);
+}
+
+FPredItemStats::~FPredItemStats()
+{
+    FRegistry& Registry = GetRegistry();
+    FScopeLock Lock(&Registry.Lock);
+    Registry.Stats.RemoveSwap(this);
+}
+
+FPredItemStats::FRegistry& FPredItemStats::GetRegistry()
+{
+    static FRegistry Registry;
+    return Registry;
+}
+
+FPredItemStats& FPredItemStats::GetProcessWide()
+{
+    // Registers after the registry is constructed, so it goes away before the registry does.
+    static FPredItemStats ProcessWide;
+    return ProcessWide;
+}
+
+FPredItemStats& FPredItemStats::Get(const UObject* WorldContextObject)
+{
+    // Looked up quietly, worlds without an item service (eg. editor preview worlds) are expected here.
+    const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+    const ABasePredecessorGameState* GameState = World ? World->GetGameState<ABasePredecessorGameState>() : nullptr;
+    APredItemService* ItemService = GameState ? GameState->GetItemService() : nullptr;
+    return ItemService ? ItemService->GetStats() : GetProcessWide();
+}
+
+void FPredItemStats::Record(EPredItemStat Stat, uint64 Cycles)
+{
+    FAggregate& Aggregate = Aggregates[(int32)Stat];
+    Aggregate.Count.fetch_add(1, std::memory_order_relaxed);
+    Aggregate.Cycles.fetch_add(Cycles, std::memory_order_relaxed);
+
+    uint64 MaxCycles = Aggregate.MaxCycles.load(std::memory_order_relaxed);
+    while (Cycles > MaxCycles && !Aggregate.MaxCycles.compare_exchange_weak(MaxCycles, Cycles, std::memory_order_relaxed))
+    {
+    }
+}
+
+void FPredItemStats::Reset()
+{
+    for (FAggregate& Aggregate : Aggregates)
+    {
+        Aggregate.Count.store(0, std::memory_order_relaxed);
+        Aggregate.Cycles.store(0, std::memory_order_relaxed);
+        Aggregate.MaxCycles.store(0, std::memory_order_relaxed);
+    }
+    StartTime = FPlatformTime::Seconds();
+}
+
+void FPredItemStats::Dump()
+{
+    uint64 Counts[(int32)EPredItemStat::Num] = {};
+    uint64 Cycles[(int32)EPredItemStat::Num] = {};
+    uint64 MaxCycles[(int32)EPredItemStat::Num] = {};
+    double FirstStartTime = FPlatformTime::Seconds();
+    int32 NumWorlds = 0;
+    {
+        FRegistry& Registry = GetRegistry();
+        FScopeLock Lock(&Registry.Lock);
+        for (const FPredItemStats* Stats : Registry.Stats)
+        {
+            for (int32 i = 0; i < (int32)EPredItemStat::Num; i++)
+            {
+                Counts[i] += Stats->Aggregates[i].Count.load(std::memory_order_relaxed);
+                Cycles[i] += Stats->Aggregates[i].Cycles.load(std::memory_order_relaxed);
+                MaxCycles[i] = FMath::Max(MaxCycles[i], Stats->Aggregates[i].MaxCycles.load(std::memory_order_relaxed));
+            }
+
+            // Only item services reset their totals, the process-wide ones and class defaults never start a match.
+            if (Stats->StartTime > 0.0)
+            {
+                FirstStartTime = FMath::Min(FirstStartTime, Stats->StartTime);
+                NumWorlds++;
+            }
+        }
+    }
+
+    const double MatchSeconds = FMath::Max(FPlatformTime::Seconds() - FirstStartTime, SMALL_NUMBER);
+
+    TRACESTATIC(PredItemLog, Log, "Item system totals of %d worlds over the last %.1fs:", NumWorlds, MatchSeconds);
+    TRACESTATIC(PredItemLog, Log, "%-22s %10s %12s %10s %10s %8s", TEXT("Stat"), TEXT("Count"), TEXT("Total ms"), TEXT("Avg us"), TEXT("Max us"), TEXT("% time"));
+
+    double TotalMs = 0.0;
+    for (int32 i = 0; i < (int32)EPredItemStat::Num; i++)
+    {
+        const uint64 Count = Counts[i];
+        const double StatMs = FPlatformTime::ToMilliseconds64(Cycles[i]);
+        const double MaxUs = FPlatformTime::ToMilliseconds64(MaxCycles[i]) * 1000.0;
+        const double AvgUs = Count > 0 ? StatMs * 1000.0 / Count : 0.0;
+        TotalMs += StatMs;
+
+        TRACESTATIC(PredItemLog, Log, "%-22s %10llu %12.3f %10.2f %10.2f %7.3f%%", GetStatName((EPredItemStat)i), Count, StatMs, AvgUs, MaxUs, StatMs / (MatchSeconds * 10.0));
+    }
+
+    // Scopes nest (a purchase applies effects), so the sum overstates the total a little.
+    TRACESTATIC(PredItemLog, Log, "Sum of all scopes: %.3fms, %.3f%% of the match.", TotalMs, TotalMs / (MatchSeconds * 10.0));
+}
+
+const TCHAR* FPredItemStats::GetStatName(EPredItemStat Stat)
+{
+    switch (Stat)
+    {
+    case EPredItemStat::ItemCost:               return TEXT("ItemCost");
+    case EPredItemStat::PersonalizedPrices:     return TEXT("PersonalizedPrices");
+    case EPredItemStat::Purchase:               return TEXT("Purchase");
+    case EPredItemStat::Sell:                   return TEXT("Sell");
+    case EPredItemStat::ApplyEffects:           return TEXT("ApplyEffects");
+    case EPredItemStat::RemoveEffects:          return TEXT("RemoveEffects");
+    case EPredItemStat::RegenerateEffects:      return TEXT("RegenerateEffects");
+    case EPredItemStat::CatalogLoad:            return TEXT("CatalogLoad");
+    case EPredItemStat::InventoryRep:           return TEXT("InventoryRep");
+    case EPredItemStat::SortedItemsRep:         return TEXT("SortedItemsRep");
+    case EPredItemStat::AffordabilityRefresh:   return TEXT("AffordabilityRefresh");
+    case EPredItemStat::PassiveTick:            return TEXT("PassiveTick");
+    case EPredItemStat::StatPreview:            return TEXT("StatPreview");
+    case EPredItemStat::LiveOpsApply:           return TEXT("LiveOpsApply");
+    case EPredItemStat::ScoreboardSend:         return TEXT("ScoreboardSend");
+    case EPredItemStat::TimelineStream:         return TEXT("TimelineStream");
+    default:                                    return TEXT("Unknown");
+    }
+}
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "PredItemLibrary.h"
+
+#include <atomic>
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Item Cost"), STAT_PredItem_ItemCost, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Personalized Prices"), STAT_PredItem_PersonalizedPrices, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Purchase"), STAT_PredItem_Purchase, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sell"), STAT_PredItem_Sell, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Effects"), STAT_PredItem_ApplyEffects, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Remove Effects"), STAT_PredItem_RemoveEffects, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Regenerate Effects"), STAT_PredItem_RegenerateEffects, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Catalog Load"), STAT_PredItem_CatalogLoad, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnRep Inventory"), STAT_PredItem_InventoryRep, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnRep Sorted Items"), STAT_PredItem_SortedItemsRep, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Affordability Refresh"), STAT_PredItem_AffordabilityRefresh, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Passive Tick"), STAT_PredItem_PassiveTick, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Stat Preview"), STAT_PredItem_StatPreview, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("LiveOps Apply"), STAT_PredItem_LiveOpsApply, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Scoreboard Send"), STAT_PredItem_ScoreboardSend, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Timeline Stream"), STAT_PredItem_TimelineStream, STATGROUP_PredItem, PREDECESSOR_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Purchases"), STAT_PredItem_NumPurchases, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sells"), STAT_PredItem_NumSells, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Passive Pulses"), STAT_PredItem_NumPassivePulses, STATGROUP_PredItem, PREDECESSOR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shared Catalog Hits"), STAT_PredItem_NumSharedCatalogHits, STATGROUP_PredItem, PREDECESSOR_API);
+
+/**
+ * Hot paths of the item system which are aggregated over the match, on top of the regular stats.
+ * Each one has a STAT_PredItem_ cycle stat of the same name.
+ */
+enum class EPredItemStat : uint8
+{
+    ItemCost,
+    PersonalizedPrices,
+    Purchase,
+    Sell,
+    ApplyEffects,
+    RemoveEffects,
+    RegenerateEffects,
+    CatalogLoad,
+    InventoryRep,
+    SortedItemsRep,
+    AffordabilityRefresh,
+    PassiveTick,
+    StatPreview,
+    LiveOpsApply,
+    ScoreboardSend,
+    TimelineStream,
+
+    Num
+};
+
+/**
+ * Match-wide totals of the item system's hot paths: how often they ran and how long they took.
+ * Unlike the stats system, these are always gathered (a handful of atomics per scope) and cover the whole match, not a capture.
+ * Each item service keeps its own, so worlds sharing a process (listen server, PIE, several matches per server) don't reset
+ * each other's. Work done once for every world, eg. applying LiveOps overrides, goes to the process-wide totals.
+ * The PredItem.DumpStats console command sums them all up.
+ */
+class PREDECESSOR_API FPredItemStats
+{
+public:
+
+    FPredItemStats();
+    ~FPredItemStats();
+
+    FPredItemStats(const FPredItemStats&) = delete;
+    FPredItemStats& operator=(const FPredItemStats&) = delete;
+
+    /** Adds a single run of @Stat taking @Cycles. Safe from any thread. */
+    void Record(EPredItemStat Stat, uint64 Cycles);
+
+    /** Starts a new match's totals */
+    void Reset();
+
+    /** Totals of @WorldContextObject's item service, the process-wide ones if its world has none */
+    static FPredItemStats& Get(const UObject* WorldContextObject);
+
+    /** Totals of work which isn't any one world's */
+    static FPredItemStats& GetProcessWide();
+
+    /** Writes the sum of every world's totals to the log, along with how much of the longest match's wall time each one accounts for */
+    static void Dump();
+
+    static const TCHAR* GetStatName(EPredItemStat Stat);
+
+private:
+
+    struct FAggregate
+    {
+        std::atomic<uint64> Count{ 0 };
+        std::atomic<uint64> Cycles{ 0 };
+        std::atomic<uint64> MaxCycles{ 0 };
+    };
+
+    FAggregate Aggregates[(int32)EPredItemStat::Num];
+
+    /** FPlatformTime::Seconds() of the last reset, 0 if never reset */
+    double StartTime = 0.0;
+
+    /** Every FPredItemStats alive, for Dump */
+    struct FRegistry
+    {
+        FCriticalSection Lock;
+        TArray<FPredItemStats*> Stats;
+    };
+
+    static FRegistry& GetRegistry();
+};
+
+/**
+ * Records the time spent in its scope to FPredItemStats.
+ */
+struct FPredItemStatScope
+{
+    FPredItemStatScope(FPredItemStats& InStats, EPredItemStat InStat)
+        : Stats(InStats)
+        , Stat(InStat)
+        , StartCycles(FPlatformTime::Cycles64())
+    {
+    }
+
+    ~FPredItemStatScope()
+    {
+        Stats.Record(Stat, FPlatformTime::Cycles64() - StartCycles);
+    }
+
+    FPredItemStats& Stats;
+    EPredItemStat Stat;
+    uint64 StartCycles;
+};
+
+/**
+ * Instruments the rest of the scope as @Name: its cycle stat, an Insights CPU trace scope, and the match totals in @Stats.
+ */
+#define PRED_ITEM_SCOPE(Name, Stats) \
+    SCOPE_CYCLE_COUNTER(STAT_PredItem_##Name); \
+    TRACE_CPUPROFILER_EVENT_SCOPE(PredItem_##Name); \
+    FPredItemStatScope PredItemStatScope_##Name(Stats, EPredItemStat::Name)
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PredTimelineStreamComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "PredItemCatalog.h"
+#include "PredItemLibrary.h"
+#include "PredItemService.h"
+#include "PredLoggingLibrary.h"
+
+UPredTimelineStreamComponent::UPredTimelineStreamComponent()
+{
+    PrimaryComponentTick.bCanEverTick = false;
+    SetIsReplicatedByDefault(true);
+}
+
+void UPredTimelineStreamComponent::SetStreaming(bool bStream)
+{
+    Server_SetStreaming(bStream);
+}
+
+void UPredTimelineStreamComponent::Server_SetStreaming_Implementation(bool bStream)
+{
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    if (ItemService)
+    {
+        ItemService->SetTimelineSubscriber(this, bStream);
+    }
+}
+
+bool UPredTimelineStreamComponent::Server_SetStreaming_Validate(bool bStream)
+{
+    return true;
+}
+
+void UPredTimelineStreamComponent::Client_ReceiveTimeline_Implementation(const TArray<FPredTimelineTrackInfo>& NewTracks, const TArray<FPredTimelineChunk>& Chunks)
+{
+    for (const FPredTimelineTrackInfo& TrackInfo : NewTracks)
+    {
+        Tracks.Add(TrackInfo);
+        Timeline.AddTrack(TrackInfo.PlayerName);
+    }
+
+    for (const FPredTimelineChunk& Chunk : Chunks)
+    {
+        FPredTimelineChunk ReceivedChunk = Chunk;
+        if (!Timeline.AddChunk(MoveTemp(ReceivedChunk)))
+        {
+            TRACE(PredItemLog, Warning, "Dropped a timeline chunk of track %d starting at %ums, it doesn't follow what we have.", Chunk.Track, Chunk.StartTimeMs);
+        }
+    }
+
+    OnTimelineUpdated.Broadcast();
+}
+
+APlayerState* UPredTimelineStreamComponent::GetTrackPlayer(int32 Track) const
+{
+    return Tracks.IsValidIndex(Track) && IsValid(Tracks[Track].Player) ? const_cast<APlayerState*>(Tracks[Track].Player) : nullptr;
+}
+
+bool UPredTimelineStreamComponent::GetTrackStateAt(int32 Track, float Time, TArray<UPredItem*>& OutItems, TArray<int32>& OutStackCounts, int32& OutGold) const
+{
+    OutItems.Reset();
+    OutStackCounts.Reset();
+    OutGold = 0;
+
+    FPredTimelineState State;
+    if (!Timeline.GetStateAt(Track, (uint32)FMath::Max(Time * 1000.0f, 0.0f), State)) { return false; }
+
+    APredItemService* ItemService = UPredItemLibrary::GetItemService(this);
+    const FPredItemCatalog& Catalog = ItemService ? ItemService->GetCatalog() : FPredItemCatalog::GetEmpty();
+    for (int32 Slot = 0; Slot < State.NumSlots(); Slot++)
+    {
+        const int32 ItemIndex = State.SlotItems[Slot];
+        OutItems.Add(Catalog.Items.IsValidIndex(ItemIndex) ? Catalog.Items[ItemIndex] : nullptr);
+        OutStackCounts.Add(State.SlotCounts[Slot]);
+    }
+    OutGold = State.Gold;
+    return true;
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "PredInventoryTimeline.h"
+
+#include "PredTimelineStreamComponent.generated.h"
+
+class APlayerState;
+class UPredItem;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnTimelineUpdatedSignature);
+
+/**
+ * Streams the server's inventory timeline (see FPredInventoryTimeline) to a spectator, for their item history UI and replay scrubber.
+ * Goes on the spectator's player controller, which is what gives the server a connection to send the timeline through.
+ *
+ * Only closed chunks are streamed, so what the spectator sees of the timeline trails the match by up to the item service's
+ * TimelineKeyframeInterval. Catching up on a match already under way is spread over several sends, see MaxTimelineStreamBytes.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class PREDECESSOR_API UPredTimelineStreamComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPredTimelineStreamComponent();
+
+    /**
+     * Fired on the owning client whenever more of the timeline came in.
+     */
+    UPROPERTY(BlueprintAssignable, Category = "PredTimelineStream")
+    FOnTimelineUpdatedSignature OnTimelineUpdated;
+
+    /**
+     * Asks the server to start (or stop) streaming us the timeline. Starting again after stopping picks up where the stream left off.
+     * Only called by the owning client.
+     */
+    UFUNCTION(BlueprintCallable, Category = "PredTimelineStream")
+    void SetStreaming(bool bStream);
+
+    /** Returns how many players the timeline we received has a track for */
+    UFUNCTION(BlueprintPure, Category = "PredTimelineStream")
+    int32 GetNumTracks() const { return Tracks.Num(); }
+
+    /** Returns the player of @Track, nullptr if they left */
+    UFUNCTION(BlueprintPure, Category = "PredTimelineStream")
+    APlayerState* GetTrackPlayer(int32 Track) const;
+
+    UFUNCTION(BlueprintPure, Category = "PredTimelineStream")
+    FString GetTrackPlayerName(int32 Track) const { return Tracks.IsValidIndex(Track) ? Tracks[Track].PlayerName : FString(); }
+
+    /** Returns the server world time, in seconds, the timeline we received runs up to */
+    UFUNCTION(BlueprintPure, Category = "PredTimelineStream")
+    float GetTimelineEndTime() const { return Timeline.GetEndTimeMs() / 1000.0f; }
+
+    /**
+     * Places what the player of @Track held at @Time (server world time, in seconds) in @OutItems, one per slot (nullptr for empty
+     * slots), their stack counts in @OutStackCounts and the player's gold in @OutGold. Returns false if their track has nothing yet at @Time.
+     */
+    UFUNCTION(BlueprintPure, Category = "PredTimelineStream")
+    bool GetTrackStateAt(int32 Track, float Time, TArray<UPredItem*>& OutItems, TArray<int32>& OutStackCounts, int32& OutGold) const;
+
+    /** Timeline rebuilt from the chunks received so far */
+    const FPredInventoryTimeline& GetTimeline() const { return Timeline; }
+
+    /** Hands the owning client the tracks added and chunks closed since the last send */
+    UFUNCTION(Client, Reliable)
+    void Client_ReceiveTimeline(const TArray<FPredTimelineTrackInfo>& NewTracks, const TArray<FPredTimelineChunk>& Chunks);
+
+protected:
+
+    UFUNCTION(Server, Reliable, WithValidation)
+    void Server_SetStreaming(bool bStream);
+
+    FPredInventoryTimeline Timeline;
+
+    /** Who each track of Timeline belongs to. A UPROPERTY so players that left are nulled out rather than left dangling. */
+    UPROPERTY()
+    TArray<FPredTimelineTrackInfo> Tracks;
+
+};